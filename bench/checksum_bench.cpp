@@ -0,0 +1,169 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+// Verifies the checksum kernel bit for bit against the original two pass one and times both
+//   Linux: ./build/bench/JsonTalkiePlayer_checksum_bench.out [iterations]
+#include "TalkieChecksum.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+
+
+// The original implementation, kept as the reference (messages of 256 bytes or more give 0)
+static uint16_t reference_checksum(const std::string& data) {
+    uint16_t checksum = 0;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.c_str());
+    size_t len = data.length();
+    if (len < 256) {
+        uint8_t data_bytes[256] = {0};
+        size_t data_bytes_i = 0;
+        bool at_c0 = false;
+        for (size_t i = 0; i < len; ++i) {
+            if (!at_c0 && i > 3 && bytes[i - 3] == 'c' && bytes[i - 1] == ':' && bytes[i - 4] == '"' && bytes[i - 2] == '"') {
+                at_c0 = true;
+                data_bytes[data_bytes_i++] = '0';
+                continue;
+            } else if (at_c0) {
+                if (bytes[i] < '0' || bytes[i] > '9') {
+                    at_c0 = false;
+                } else {
+                    continue;
+                }
+            }
+            data_bytes[data_bytes_i] = bytes[i];
+            data_bytes_i++;
+        }
+        len = data_bytes_i;
+        uint16_t chunk = 0;
+        for (size_t i = 0; i < len; i += 2) {
+            chunk = data_bytes[i] << 8;
+            if (i + 1 < len) {
+                chunk |= data_bytes[i + 1];
+            }
+            checksum ^= chunk;
+        }
+    }
+    return checksum & 0xFFFF;
+}
+
+
+// The same algorithm without the length limit, byte by byte, the reference for the longer messages
+static uint16_t unlimited_reference_checksum(const std::string& data) {
+    uint16_t checksum = 0;
+    size_t emitted = 0;
+    bool at_c0 = false;
+    for (size_t i = 0; i < data.size(); ++i) {
+        uint8_t byte = static_cast<uint8_t>(data[i]);
+        if (!at_c0 && i > 3 && data[i - 3] == 'c' && data[i - 1] == ':' && data[i - 4] == '"' && data[i - 2] == '"') {
+            at_c0 = true;
+            byte = '0';
+        } else if (at_c0) {
+            if (byte < '0' || byte > '9') {
+                at_c0 = false;
+            } else {
+                continue;
+            }
+        }
+        checksum ^= (emitted++ & 1) ? byte : static_cast<uint16_t>(byte << 8);
+    }
+    return checksum;
+}
+
+
+static std::vector<std::string> talkie_messages(std::mt19937 &generator, size_t total) {
+    static const char* names[] = {"ESP32", "Nano", "buzz", "on", "off", "bpm_10", "JsonMidiCreator"};
+    std::uniform_int_distribution<int> any(0, 100000);
+    std::vector<std::string> messages;
+    for (size_t message_i = 0; message_i < total; ++message_i) {
+        std::string message = "{\"c\":" + std::to_string(any(generator))
+            + ",\"f\":\"" + names[any(generator) % 7] + "\",\"i\":" + std::to_string(any(generator))
+            + ",\"m\":" + std::to_string(any(generator) % 9) + ",\"n\":\"" + names[any(generator) % 7]
+            + "\",\"t\":\"" + names[any(generator) % 7] + "\"";
+        if (message_i % 3 == 0)
+            message += ",\"v\":" + std::to_string(any(generator));
+        message += "}";
+        messages.push_back(message);
+    }
+    return messages;
+}
+
+
+// Random bytes biased towards the characters of the "c": pattern, to stress the state machine
+static std::vector<std::string> hostile_messages(std::mt19937 &generator, size_t total, size_t max_length) {
+    static const char alphabet[] = "\"c:0123456789\"c:,{}ab";
+    std::uniform_int_distribution<size_t> length(0, max_length);
+    std::uniform_int_distribution<size_t> letter(0, sizeof(alphabet) - 2);
+    std::vector<std::string> messages;
+    for (size_t message_i = 0; message_i < total; ++message_i) {
+        std::string message(length(generator), ' ');
+        for (auto &character : message)
+            character = alphabet[letter(generator)];
+        messages.push_back(message);
+    }
+    return messages;
+}
+
+
+template <typename Checksum>
+static double time_ns_per_message(const std::vector<std::string> &messages, size_t iterations, Checksum checksum) {
+    volatile uint16_t sink = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t iteration = 0; iteration < iterations; ++iteration)
+        for (const auto &message : messages)
+            sink = sink ^ checksum(message);
+    auto finish = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(finish - start).count() / (iterations * messages.size());
+}
+
+
+int main(int argc, char *argv[]) {
+
+    const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 200;
+    std::mt19937 generator(5005);
+
+    auto messages = talkie_messages(generator, 10000);
+    auto hostile = hostile_messages(generator, 100000, 255);
+    auto long_hostile = hostile_messages(generator, 10000, 4096);
+
+    size_t mismatches = 0;
+    for (const auto* message_set : {&messages, &hostile, &long_hostile}) {
+        for (const auto &message : *message_set) {
+            const uint16_t expected = message_set == &long_hostile
+                ? unlimited_reference_checksum(message) : reference_checksum(message);
+            if (calculate_checksum(message) != expected) {
+                if (mismatches++ < 10)
+                    std::cerr << "MISMATCH for: " << message << std::endl;
+            }
+        }
+    }
+    std::cout << "Verified " << messages.size() + hostile.size() + long_hostile.size() << " messages, "
+        << mismatches << " mismatches" << std::endl;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Talkie messages (ns/message):  reference " << std::setw(8)
+        << time_ns_per_message(messages, iterations, reference_checksum)
+        << "   single pass " << std::setw(8)
+        << time_ns_per_message(messages, iterations, [](const std::string &m) { return calculate_checksum(m); }) << std::endl;
+
+    std::vector<std::string> large(1000, std::string(1000, 'a') + "\"c\":12345}");
+    std::cout << "1 KB payloads (ns/message):    reference " << std::setw(8) << "n/a"
+        << "   single pass " << std::setw(8)
+        << time_ns_per_message(large, iterations, [](const std::string &m) { return calculate_checksum(m); }) << std::endl;
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,502 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+// Plays synthetic Json Midi Player files against in-process fake Talkie devices on the loopback and reports
+// the load time, peak RSS, the jitter seen by the devices and the CPU used, to catch regressions early
+//   Linux: ./build/bench/JsonTalkiePlayer_bench.out -p 20000 -r 1000 -d 4
+// SHALL E INCLUDED FIRST THAN EVERYTHING ELSE !!
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieSession.hpp"
+#include "TalkieChecksum.hpp"
+
+#include <fstream>
+#include <random>
+#include <limits>
+
+#ifdef _MSC_VER
+    #include <third_party/getopt.h>
+#else
+    #include <getopt.h>
+#endif
+
+#ifdef _WIN32
+    #include <psapi.h>
+    #pragma comment(lib, "psapi.lib")
+#else
+    #include <sys/resource.h>
+#endif
+
+
+#define BENCH_FIRST_PORT    (TALKIE_DEFAULT_PORT + 1)   // Each fake device listens on its own port
+#define BENCH_LEAD_IN_MS    500.0   // Before the first pin, time for the devices to be discovered
+
+
+struct BenchOptions {
+    size_t total_pins = 20000;
+    double pins_per_second = 1000.0;
+    size_t chord_pins = 1;          // Pins sharing the same time (a batch)
+    size_t total_devices = 4;
+    std::string file_path = "JsonTalkiePlayer_bench.json";
+    bool keep_file = false;
+    double loss_percent = 0.0;      // Of the arrivals the fake devices ignore, as a lossy network would
+};
+
+
+static long long steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Process wide, so it includes the fake devices too
+static double cpu_seconds() {
+#ifdef _WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time);
+    auto seconds = [](const FILETIME &file_time) {
+        return ((static_cast<unsigned long long>(file_time.dwHighDateTime) << 32) | file_time.dwLowDateTime) / 1e7;
+    };
+    return seconds(kernel_time) + seconds(user_time);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+
+static double peak_rss_mb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS memory_counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &memory_counters, sizeof(memory_counters));
+    return memory_counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;    // Kilobytes on Linux
+#endif
+}
+
+
+static std::string device_name(size_t device_i) {
+    return "bench_" + std::to_string(device_i);
+}
+
+
+// Pins go round robin through the devices, their "v" is their sequence in the device, so each arrival
+// can be matched with the time it was scheduled for
+static bool generate_file(const BenchOptions &options, std::vector<std::vector<double>> &device_times_ms) {
+    std::ofstream json_file(options.file_path);
+    if (!json_file) {
+        std::cerr << "Unable to write the bench file: " << options.file_path << std::endl;
+        return false;
+    }
+    device_times_ms.assign(options.total_devices, std::vector<double>());
+    std::mt19937 generator(5005);
+    std::uniform_int_distribution<int> any_name(0, 3);
+    static const char* names[] = {"on", "off", "buzz", "cc"};
+
+    json_file << "{\"filetype\": \"" << FILE_TYPE << "\", \"url\": \"" << FILE_URL << "\", \"content\": ["
+        << "{\"clock\": {}, \"tempo\": {\"f\": \"JsonMidiCreator\", \"bpm_10\": 1200}}";
+    const double gap_ms = 1000.0 * options.chord_pins / options.pins_per_second;
+    json_file << std::fixed << std::setprecision(3);
+    for (size_t pin_i = 0; pin_i < options.total_pins; ++pin_i) {
+        const double time_ms = BENCH_LEAD_IN_MS + (pin_i / options.chord_pins) * gap_ms;
+        const size_t device_i = pin_i % options.total_devices;
+        json_file << ", {\"time_ms\": " << time_ms << ", \"port\": " << BENCH_FIRST_PORT + device_i
+            << ", \"message\": {\"m\": 2, \"f\": \"JsonMidiCreator\", \"t\": \"" << device_name(device_i)
+            << "\", \"n\": \"" << names[any_name(generator)] << "\", \"v\": " << device_times_ms[device_i].size() << "}}";
+        device_times_ms[device_i].push_back(time_ms);
+    }
+    json_file << "]}" << std::endl;
+    return static_cast<bool>(json_file);
+}
+
+
+// Listens on its own port, announces itself to the player with a checksummed echo (as a device that
+// just joined does, unless it's left to be discovered) and echoes the first message and any probe,
+// then only timestamps what arrives. Acknowledging devices echo every message, as the reliable runs expect.
+class FakeDevice {
+private:
+    const std::string name;
+    const int port;
+    const bool announce;
+    const bool acknowledging;
+    const double loss_fraction;
+    int sockfd = -1;
+    std::thread device_thread;
+    std::atomic<bool> running{false};
+
+public:
+    std::vector<long long> arrivals_ns;     // By sequence, 0 if never arrived
+    size_t total_received = 0;
+    size_t total_duplicated = 0;
+    size_t checksum_failures = 0;
+
+    size_t total_ignored = 0;
+
+    FakeDevice(const std::string &name, int port, size_t total_pins, bool announce,
+            bool acknowledging = false, double loss_fraction = 0.0)
+        : name(name), port(port), announce(announce), acknowledging(acknowledging),
+          loss_fraction(loss_fraction), arrivals_ns(total_pins, 0) { }
+    ~FakeDevice() { stop(); }
+
+    FakeDevice(const FakeDevice&) = delete;
+    FakeDevice& operator=(const FakeDevice&) = delete;
+
+    bool start() {
+        sockfd = static_cast<int>(socket(AF_INET, SOCK_DGRAM, 0));
+        if (sockfd < 0) {
+            std::cerr << "Fake device socket creation failed" << std::endl;
+            return false;
+        }
+        int enable = 1;
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&enable), sizeof(enable));
+        struct sockaddr_in device_addr = {};
+        device_addr.sin_family = AF_INET;
+        device_addr.sin_port = htons(port);
+        device_addr.sin_addr.s_addr = INADDR_ANY;   // Broadcasts too, for the pins before the discovery
+        if (bind(sockfd, reinterpret_cast<struct sockaddr*>(&device_addr), sizeof(device_addr)) < 0) {
+            std::cerr << "Fake device bind failed on port " << port << std::endl;
+            close(sockfd);
+            sockfd = -1;
+            return false;
+        }
+        struct sockaddr_in player_addr = {};
+        player_addr.sin_family = AF_INET;
+        player_addr.sin_port = htons(TALKIE_DEFAULT_PORT);
+        inet_pton(AF_INET, "127.0.0.1", &player_addr.sin_addr);
+        if (announce)
+            sendEcho(player_addr, 0);
+        running = true;
+        device_thread = std::thread(&FakeDevice::receive, this);
+        return true;
+    }
+
+    void stop() {
+        running = false;
+        if (device_thread.joinable())
+            device_thread.join();
+        if (sockfd >= 0) {
+            close(sockfd);
+            sockfd = -1;
+        }
+    }
+
+private:
+    void sendEcho(const struct sockaddr_in &player_addr, uint32_t message_id) {
+        // The checksum is computed with "c":0, its digits count as a single '0'
+        const std::string echo_tail = ",\"f\":\"" + name + "\",\"i\":" + std::to_string(message_id) + ",\"m\":6}";
+        const std::string echo = "{\"c\":" + std::to_string(calculate_checksum("{\"c\":0" + echo_tail)) + echo_tail;
+        sendto(sockfd, echo.data(), static_cast<int>(echo.size()), 0,
+            reinterpret_cast<const struct sockaddr*>(&player_addr), sizeof(player_addr));
+    }
+
+    void receive() {
+        char buffer[1024];
+        bool echoed = false;
+        std::mt19937 generator(static_cast<unsigned>(port));
+        std::uniform_real_distribution<double> any_fraction(0.0, 1.0);
+        while (running) {
+            fd_set readfds;
+            FD_ZERO(&readfds);
+            FD_SET(sockfd, &readfds);
+            struct timeval timeout = {0, 50000};    // Checks running every 50 ms
+            if (select(sockfd + 1, &readfds, nullptr, nullptr, &timeout) <= 0)
+                continue;
+            struct sockaddr_in sender_addr = {};
+            socklen_t sender_length = sizeof(sender_addr);
+            const int received = recvfrom(sockfd, buffer, sizeof(buffer) - 1, 0,
+                reinterpret_cast<struct sockaddr*>(&sender_addr), &sender_length);
+            const long long arrival_ns = steady_ns();
+            if (received <= 0)
+                continue;
+            try {
+                nlohmann::json json_message = nlohmann::json::parse(buffer, buffer + received);
+                if (json_message.value("t", std::string()) != name)
+                    continue;   // The tempo broadcasts, for instance
+                if (json_message.value("m", -1) == MessageCode::talk) {
+                    sendEcho(sender_addr, json_message.value("i", 0u));   // A discovery probe
+                    continue;
+                }
+                if (loss_fraction > 0.0 && any_fraction(generator) < loss_fraction) {
+                    total_ignored++;
+                    continue;
+                }
+                if (json_message["c"].get<uint16_t>() != calculate_checksum(buffer, static_cast<size_t>(received)))
+                    checksum_failures++;
+                const size_t sequence = json_message["v"].get<size_t>();
+                if (sequence < arrivals_ns.size()) {
+                    if (arrivals_ns[sequence] != 0) {
+                        total_duplicated++;
+                    } else {
+                        arrivals_ns[sequence] = arrival_ns;
+                        total_received++;
+                    }
+                }
+                if (!echoed || acknowledging) {
+                    sendEcho(sender_addr, json_message.value("i", 0u));
+                    echoed = true;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Fake device " << name << " discarded a message: " << e.what() << std::endl;
+            }
+        }
+    }
+};
+
+
+void printUsage(const char *programName) {
+    std::cout << "Usage: " << programName << " [options]\n"
+              << "Options:\n"
+              << "  -h, --help       Show this help message and exit\n"
+              << "  -p, --pins N     Total pins to play (default 20000)\n"
+              << "  -r, --rate R     Pins per second, the density (default 1000)\n"
+              << "  -c, --chord C    Pins sharing each time (default 1)\n"
+              << "  -d, --devices D  Fake devices on the loopback (default 4)\n"
+              << "  -t, --timer M    Timer mode: hybrid (default), spin or sleep\n"
+              << "  -P, --policy MODE  Schedule policy: legacy-drag (default), slew or strict-grid\n"
+              << "  -n, --no-batch   Sends each pin on its own system call\n"
+              << "  -q, --queues     Sends each device from its own queue and thread\n"
+              << "  -L, --late-drop MS  Drops the queued pins later than MS milliseconds\n"
+              << "  -D, --discovery S  Probes the devices up to S seconds before playing\n"
+              << "  -I, --interfaces LIST  Plays through one socket per interface (lo for the loopback)\n"
+              << "  -Q, --rate-limit N  Sends at most N messages per second to each device, deferring the others\n"
+              << "  -a, --acks       Plays reliable runs, the fake devices echo every message\n"
+              << "  -x, --loss PCT   Percent of the arrivals the fake devices ignore (default 0)\n"
+              << "  -f, --file F     Where the generated file is written (default JsonTalkiePlayer_bench.json)\n"
+              << "  -k, --keep       Keeps the generated file\n";
+}
+
+
+int main(int argc, char *argv[]) {
+
+    BenchOptions bench_options;
+    PlayOptions play_options;
+
+    struct option long_options[] = {
+        {"help",        no_argument,        0, 'h'},
+        {"pins",        required_argument,  0, 'p'},
+        {"rate",        required_argument,  0, 'r'},
+        {"chord",       required_argument,  0, 'c'},
+        {"devices",     required_argument,  0, 'd'},
+        {"timer",       required_argument,  0, 't'},
+        {"policy",      required_argument,  0, 'P'},
+        {"no-batch",    no_argument,        0, 'n'},
+        {"queues",      no_argument,        0, 'q'},
+        {"late-drop",   required_argument,  0, 'L'},
+        {"discovery",   required_argument,  0, 'D'},
+        {"interfaces",  required_argument,  0, 'I'},
+        {"rate-limit",  required_argument,  0, 'Q'},
+        {"acks",        no_argument,        0, 'a'},
+        {"loss",        required_argument,  0, 'x'},
+        {"file",        required_argument,  0, 'f'},
+        {"keep",        no_argument,        0, 'k'},
+        {0, 0, 0, 0}
+    };
+    int option_index = 0;
+    int c;
+    while ((c = getopt_long(argc, argv, "hp:r:c:d:t:P:nqL:D:I:Q:ax:f:k", long_options, &option_index)) != -1) {
+        switch (c) {
+            case 'h':
+                printUsage(argv[0]);
+                return 0;
+            case 'p':
+                bench_options.total_pins = std::stoul(optarg);
+                break;
+            case 'r':
+                bench_options.pins_per_second = std::stod(optarg);
+                break;
+            case 'c':
+                bench_options.chord_pins = std::max<size_t>(1, std::stoul(optarg));
+                break;
+            case 'd':
+                bench_options.total_devices = std::max<size_t>(1, std::stoul(optarg));
+                break;
+            case 't':
+                if (!parseTimerMode(optarg, play_options.timer_mode)) {
+                    std::cerr << "Unknown timer mode: " << optarg << std::endl;
+                    return 1;
+                }
+                break;
+            case 'P':
+                if (!parseSchedulePolicy(optarg, play_options.schedule_policy)) {
+                    std::cerr << "Unknown schedule policy: " << optarg << std::endl;
+                    return 1;
+                }
+                break;
+            case 'n':
+                play_options.batch_sends = false;
+                break;
+            case 'q':
+                play_options.device_queues = true;
+                break;
+            case 'L':
+                play_options.late_drop_ms = std::stod(optarg);
+                break;
+            case 'D':
+                play_options.discovery_s = std::stod(optarg);
+                break;
+            case 'I':
+                play_options.interfaces = optarg;
+                break;
+            case 'Q':
+                play_options.rate_limit = std::stod(optarg);
+                break;
+            case 'a':
+                play_options.reliable_runs = true;
+                break;
+            case 'x':
+                bench_options.loss_percent = std::stod(optarg);
+                break;
+            case 'f':
+                bench_options.file_path = optarg;
+                break;
+            case 'k':
+                bench_options.keep_file = true;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+    if (bench_options.pins_per_second <= 0.0) {
+        std::cerr << "The rate must be positive" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<double>> device_times_ms;
+    if (!generate_file(bench_options, device_times_ms))
+        return 1;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Bench of " << bench_options.total_pins << " pins at " << bench_options.pins_per_second
+        << " pins/s (" << bench_options.chord_pins << " per time) on " << bench_options.total_devices
+        << " devices, " << timerModeName(play_options.timer_mode) << " timer, "
+        << schedulePolicyName(play_options.schedule_policy) << " policy" << std::endl;
+
+    int result = 1;
+    {
+        TalkieSession talkie_session(false, play_options);
+        if (!talkie_session.isReady()) {
+            std::cerr << "The player socket isn't ready (is port 5005 in use?)" << std::endl;
+            return 1;
+        }
+
+        const long long load_start_ns = steady_ns();
+        const bool loaded = talkie_session.loadFiles({bench_options.file_path}, 0);
+        const double load_ms = (steady_ns() - load_start_ns) / 1e6;
+        const double load_rss_mb = peak_rss_mb();
+
+        // Only started once loaded, so their announcing echoes find the devices already known
+        std::vector<std::unique_ptr<FakeDevice>> fake_devices;
+        bool devices_ready = loaded;
+        for (size_t device_i = 0; devices_ready && device_i < bench_options.total_devices; ++device_i) {
+            fake_devices.emplace_back(new FakeDevice(device_name(device_i),
+                static_cast<int>(BENCH_FIRST_PORT + device_i), device_times_ms[device_i].size(),
+                play_options.discovery_s <= 0.0, play_options.reliable_runs, bench_options.loss_percent / 100));
+            devices_ready = fake_devices.back()->start();
+        }
+
+        if (devices_ready) {
+            const double cpu_start_s = cpu_seconds();
+            const long long play_start_ns = steady_ns();
+            result = talkie_session.play();
+            const double play_s = (steady_ns() - play_start_ns) / 1e9;
+            const double cpu_s = cpu_seconds() - cpu_start_s;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));    // The last datagrams in flight
+            for (auto &fake_device : fake_devices)
+                fake_device->stop();
+
+            // The smallest latency is taken as the common epoch, jitter is how late each arrival is from it
+            long long epoch_ns = std::numeric_limits<long long>::max();
+            size_t total_received = 0, total_duplicated = 0, checksum_failures = 0, total_ignored = 0;
+            for (size_t device_i = 0; device_i < fake_devices.size(); ++device_i) {
+                const FakeDevice &fake_device = *fake_devices[device_i];
+                for (size_t sequence = 0; sequence < fake_device.arrivals_ns.size(); ++sequence) {
+                    if (fake_device.arrivals_ns[sequence] != 0)
+                        epoch_ns = std::min(epoch_ns, fake_device.arrivals_ns[sequence]
+                            - static_cast<long long>(device_times_ms[device_i][sequence] * 1e6));
+                }
+                total_received += fake_device.total_received;
+                total_duplicated += fake_device.total_duplicated;
+                checksum_failures += fake_device.checksum_failures;
+                total_ignored += fake_device.total_ignored;
+            }
+            TalkieStatistics jitter;
+            for (size_t device_i = 0; device_i < fake_devices.size(); ++device_i) {
+                const FakeDevice &fake_device = *fake_devices[device_i];
+                for (size_t sequence = 0; sequence < fake_device.arrivals_ns.size(); ++sequence) {
+                    if (fake_device.arrivals_ns[sequence] != 0)
+                        jitter.add((fake_device.arrivals_ns[sequence] - epoch_ns) / 1e6 - device_times_ms[device_i][sequence]);
+                }
+            }
+            const TalkieStatistics &delays = talkie_session.getReporting().delays;
+
+            std::cout << "Load time (ms):          " << std::setw(12) << load_ms << std::endl;
+            std::cout << "Peak RSS loaded (MB):    " << std::setw(12) << load_rss_mb << std::endl;
+            std::cout << "Peak RSS played (MB):    " << std::setw(12) << peak_rss_mb() << std::endl;
+            const DiscoveryReport &discovery = talkie_session.getReporting().discovery;
+            if (discovery.probed)
+                std::cout << "Discovery (ms):          " << std::setw(12) << discovery.discovery_ms << "   answered "
+                    << discovery.total_answered << " of " << discovery.total_probed << std::endl;
+            std::cout << "Play time (s):           " << std::setw(12) << play_s << std::endl;
+            std::cout << "CPU use (%):             " << std::setw(12) << 100.0 * cpu_s / play_s << std::endl;
+            std::cout << "Received / lost pins:    " << std::setw(12) << total_received << " / "
+                << bench_options.total_pins - total_received << std::endl;
+            std::cout << "Duplicated / bad pins:   " << std::setw(12) << total_duplicated << " / " << checksum_failures << std::endl;
+            std::cout << "Device jitter (ms):      " << "p50 " << std::setw(8) << jitter.getPercentile(0.5)
+                << "   p99 " << std::setw(8) << jitter.getPercentile(0.99)
+                << "   p99.9 " << std::setw(8) << jitter.getPercentile(0.999)
+                << "   max " << std::setw(8) << jitter.getMaximum() << std::endl;
+            std::cout << "Player delay (ms):       " << "p50 " << std::setw(8) << delays.getPercentile(0.5)
+                << "   p99 " << std::setw(8) << delays.getPercentile(0.99)
+                << "   p99.9 " << std::setw(8) << delays.getPercentile(0.999)
+                << "   max " << std::setw(8) << delays.getMaximum() << std::endl;
+            const PlayReporting &play_reporting = talkie_session.getReporting();
+            std::cout << "Late batches / drag (ms):" << std::setw(12) << play_reporting.late_batches << " / "
+                << play_reporting.maximum_drag << " maximum, " << play_reporting.total_drag << " final" << std::endl;
+            if (play_options.rate_limit > 0) {
+                size_t deferred = 0, late_drops = 0;
+                for (const auto &device : nlohmann::json::parse(talkie_session.getDevicesJson())) {
+                    deferred += device["deferred"].get<size_t>();
+                    late_drops += device["late_drops"].get<size_t>() + device["full_drops"].get<size_t>();
+                }
+                std::cout << "Deferred / dropped pins: " << std::setw(12) << deferred << " / " << late_drops << std::endl;
+            }
+            if (play_options.reliable_runs || total_ignored > 0) {
+                size_t tracked = 0, acknowledged = 0, retransmits = 0, lost = 0;
+                double round_trip_p99_ms = 0.0;
+                for (const auto &device : nlohmann::json::parse(talkie_session.getDevicesJson())) {
+                    tracked += device["tracked"].get<size_t>();
+                    acknowledged += device["acknowledged"].get<size_t>();
+                    retransmits += device["retransmits"].get<size_t>();
+                    lost += device["lost"].get<size_t>();
+                    round_trip_p99_ms = std::max(round_trip_p99_ms, device["round_trip_ms"]["p99"].get<double>());
+                }
+                std::cout << "Ignored arrivals:        " << std::setw(12) << total_ignored << std::endl;
+                std::cout << "Acked / tracked runs:    " << std::setw(12) << acknowledged << " / " << tracked
+                    << "   retransmits " << retransmits << "   lost " << lost
+                    << "   round trip p99 " << round_trip_p99_ms << " ms" << std::endl;
+            }
+            if (total_received != bench_options.total_pins || checksum_failures > 0)
+                result = 1;
+        }
+    }
+
+    if (!bench_options.keep_file)
+        std::remove(bench_options.file_path.c_str());
+    return result;
+}
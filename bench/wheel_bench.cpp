@@ -0,0 +1,195 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+// Verifies the timing wheel against a randomized (but seeded) run of out of order pins, on every level,
+// the overflow and behind the cursor, and times adding and taking a play list of pins
+//   Linux: ./build/bench/JsonTalkiePlayer_wheel_bench.out [rounds] [seed]
+#include "TalkieWheel.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+
+// The pin id is its device id, given in adding order, so same time pins are taken in id order
+struct AddedPin {
+    double time_ms;
+    bool late;          // Behind the cursor when added, taken first in the next batch
+    bool taken = false;
+};
+
+
+static std::string pin_message(uint32_t pin_id) {
+    std::string message = "{\"i\":" + std::to_string(pin_id) + "}";
+    if (pin_id % 97 == 0)
+        message.resize(SEND_MESSAGE_BYTES + pin_id % 300, 'x');    // A long one, kept apart by the wheel
+    return message;
+}
+
+
+static bool pin_before(const AddedPin &a, uint32_t a_id, const AddedPin &b, uint32_t b_id) {
+    return a.time_ms < b.time_ms || (a.time_ms == b.time_ms && a_id < b_id);
+}
+
+
+int main(int argc, char *argv[]) {
+
+    const size_t rounds = argc > 1 ? std::stoul(argv[1]) : 200000;
+    std::mt19937_64 generator(argc > 2 ? std::stoull(argv[2]) : 5005);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const double wheel_ms = static_cast<double>(int64_t(1) << (WHEEL_SLOT_BITS * WHEEL_LEVELS)) * WHEEL_TICK_MS;
+
+    TalkieWheel talkie_wheel;
+    TalkieSchedule batch;
+    std::vector<AddedPin> added_pins;
+    std::vector<double> recent_times;   // Reused for same time pins
+    size_t failures = 0;
+    auto fail = [&failures](const std::string &what) {
+        if (failures++ < 10)
+            std::cerr << "FAILED: " << what << std::endl;
+    };
+
+    auto add_pin = [&](double time_ms) {
+        const uint32_t pin_id = static_cast<uint32_t>(added_pins.size());
+        const bool late = std::floor(time_ms / WHEEL_TICK_MS) * WHEEL_TICK_MS < talkie_wheel.cursorMs();
+        added_pins.push_back({time_ms, late});
+        const std::string message = pin_message(pin_id);
+        talkie_wheel.add(time_ms, pin_id, message.data(), message.size());
+    };
+
+    size_t checked_pins = 0;
+    bool any_in_order = false;
+    uint32_t last_in_order = 0;     // The latest taken pin that wasn't late
+    auto check_taken = [&](size_t batch_begin, double limit_ms) {
+        const bool late_batch = added_pins[batch.getDeviceId(batch_begin)].late;
+        for (size_t pin_i = batch_begin; pin_i < batch.size(); ++pin_i) {
+            const uint32_t pin_id = batch.getDeviceId(pin_i);
+            AddedPin &added_pin = added_pins[pin_id];
+            checked_pins++;
+            if (added_pin.taken) {
+                fail("pin " + std::to_string(pin_id) + " taken twice");
+                continue;
+            }
+            added_pin.taken = true;
+            if (batch.getTime(pin_i) != added_pin.time_ms
+                    || std::string(batch.getMessage(pin_i), batch.getLength(pin_i)) != pin_message(pin_id))
+                fail("pin " + std::to_string(pin_id) + " changed");
+            if (added_pin.late != late_batch)
+                fail("pin " + std::to_string(pin_id) + " mixes late and in time pins in a batch");
+            if (pin_i > batch_begin && !pin_before(added_pins[batch.getDeviceId(pin_i - 1)], batch.getDeviceId(pin_i - 1),
+                    added_pin, pin_id))
+                fail("pin " + std::to_string(pin_id) + " out of order in its batch");
+            if (added_pin.late)
+                continue;
+            if (!(added_pin.time_ms < limit_ms))
+                fail("pin " + std::to_string(pin_id) + " taken past the limit");
+            if (std::floor(added_pin.time_ms / WHEEL_TICK_MS) != std::floor(batch.getTime(batch_begin) / WHEEL_TICK_MS))
+                fail("pin " + std::to_string(pin_id) + " not of the tick of its batch");
+            if (any_in_order && !pin_before(added_pins[last_in_order], last_in_order, added_pin, pin_id))
+                fail("pin " + std::to_string(pin_id) + " taken before " + std::to_string(last_in_order));
+            any_in_order = true;
+            last_in_order = pin_id;
+        }
+    };
+
+    auto take_all = [&](double limit_ms) {
+        size_t batch_begin = batch.size();
+        while (talkie_wheel.take(limit_ms, batch)) {
+            if (batch.size() == batch_begin) {
+                fail("empty batch taken");
+                continue;
+            }
+            check_taken(batch_begin, limit_ms);
+            batch_begin = batch.size();
+        }
+        batch.clear();
+        // Or the pins added up to the limit would be taken as late
+        if (talkie_wheel.cursorMs() > limit_ms)
+            fail("cursor past the limit of " + std::to_string(limit_ms) + " ms");
+    };
+
+    double limit_ms = 0.0;
+    for (size_t round = 0; round < rounds; ++round) {
+        const double cursor_ms = talkie_wheel.cursorMs();
+        const int total_adds = static_cast<int>(unit(generator) * 6);
+        for (int add_i = 0; add_i < total_adds; ++add_i) {
+            const double kind = unit(generator);
+            double time_ms;
+            if (kind < 0.15 && !recent_times.empty()) {
+                time_ms = recent_times[static_cast<size_t>(unit(generator) * recent_times.size())];
+            } else if (kind < 0.45) {
+                time_ms = cursor_ms + unit(generator) * WHEEL_SLOTS * WHEEL_TICK_MS;                // First level
+            } else if (kind < 0.65) {
+                time_ms = cursor_ms + unit(generator) * WHEEL_SLOTS * WHEEL_SLOTS * WHEEL_TICK_MS;  // Second level
+            } else if (kind < 0.78) {
+                time_ms = cursor_ms + unit(generator) * wheel_ms;                                   // Third level
+            } else if (kind < 0.88) {
+                time_ms = cursor_ms + wheel_ms * (1.0 + unit(generator) * 3.0);                     // Overflow
+            } else {
+                time_ms = cursor_ms - unit(generator) * 5000.0;                                     // Late
+            }
+            if (unit(generator) < 0.3)
+                time_ms = std::floor(time_ms);
+            add_pin(time_ms);
+            if (recent_times.size() < 64)
+                recent_times.push_back(time_ms);
+            else
+                recent_times[static_cast<size_t>(unit(generator) * recent_times.size())] = time_ms;
+        }
+        // Mostly a few ticks at a time, now and then a jump over hours of empty levels
+        const double step = unit(generator);
+        limit_ms += step < 0.9 ? unit(generator) * 4.0 : step < 0.999 ? unit(generator) * 3000.0 : unit(generator) * wheel_ms;
+        take_all(limit_ms);
+    }
+    take_all(std::numeric_limits<double>::infinity());
+
+    size_t total_late = 0;
+    for (size_t pin_id = 0; pin_id < added_pins.size(); ++pin_id) {
+        total_late += added_pins[pin_id].late;
+        if (!added_pins[pin_id].taken)
+            fail("pin " + std::to_string(pin_id) + " never taken");
+    }
+    if (talkie_wheel.size() != 0 || talkie_wheel.totalLate() != total_late)
+        fail("wheel counts don't match");
+    std::cout << "Verified " << added_pins.size() << " pins (" << total_late << " late, "
+        << checked_pins << " taken), " << failures << " failures" << std::endl;
+
+    // A play list fed in shuffled blocks of a second ahead, as the wheel stream does
+    const size_t total_pins = 1000000;
+    TalkieWheel timed_wheel;
+    std::vector<double> play_times(total_pins);
+    for (size_t pin_i = 0; pin_i < total_pins; ++pin_i)
+        play_times[pin_i] = static_cast<double>(pin_i) * 0.5 + unit(generator) * 1000.0;
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t fed_pins = 0;
+    for (double play_ms = 0.0; timed_wheel.size() > 0 || fed_pins < total_pins; play_ms += 100.0) {
+        for (; fed_pins < total_pins && play_times[fed_pins] < play_ms + 1000.0; ++fed_pins)
+            timed_wheel.add(play_times[fed_pins], 0, "{\"m\":2}", 7);
+        while (timed_wheel.take(fed_pins < total_pins ? play_ms : std::numeric_limits<double>::infinity(), batch)) { }
+        batch.clear();
+    }
+    auto finish = std::chrono::high_resolution_clock::now();
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Added and taken (ns/pin):      " << std::setw(8)
+        << std::chrono::duration<double, std::nano>(finish - start).count() / total_pins
+        << "   most held " << timed_wheel.maximumPins() << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
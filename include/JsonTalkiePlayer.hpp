@@ -20,7 +20,6 @@ https://github.com/ruiseixasm/JsonTalkiePlayer
 #include <string>
 #include <array>
 #include <vector>
-#include <list>
 #include <algorithm>
 #include <cmath>                // For std::round
 #include <cstdlib>
@@ -29,6 +28,9 @@ https://github.com/ruiseixasm/JsonTalkiePlayer
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
 #include <iomanip>              // For std::fixed and std::setprecision
 // Needed for UDP sockets
 #include <cstring>
@@ -46,18 +48,33 @@ https://github.com/ruiseixasm/JsonTalkiePlayer
     #include <pthread.h>
     #include <time.h>
     #include <arpa/inet.h>
+    #include <sys/socket.h>     // For sendmmsg
     #include <unistd.h>
 #endif
 
 // External libraries
 #include <nlohmann/json.hpp>    // Include the JSON library
 
+#include "TalkieSchedule.hpp"
+#include "TalkieTimer.hpp"
+#include "TalkieMessage.hpp"
+#include "TalkieStatistics.hpp"
+#include "TalkieCounters.hpp"
+#include "TalkieRegistry.hpp"
+#include "TalkieDiscovery.hpp"
+#include "TalkieCache.hpp"
+#include "TalkieInterfaces.hpp"
+#include "TalkieRealTime.hpp"
+#include "TalkieAcks.hpp"
+#include "TalkieSender.hpp"
+
 
-// #define DEBUGGING true
 #define FILE_TYPE "Json Midi Player"
 #define FILE_URL  "https://github.com/ruiseixasm/JsonMidiPlayer"
 #define VERSION   "1.0.0"
 #define DRAG_DURATION_MS (1000.0/((120/60)*24))
+#define TALKIE_DEFAULT_PORT 5005
+#define SLEW_DEFAULT_RATE 0.05      // Of the time between pins, so, 50 ms caught up per second
 
 
 enum MessageCode {
@@ -77,38 +94,118 @@ enum MessageCode {
 class TalkieDevice;
 
 
-class TalkieSocket {
-public:
-    // Intended to have their IPs updated based on the response (echo)
-    std::unordered_map<std::string, TalkieDevice> devices_by_name;
+// One ready to send message, same time pins are sent together as an array of these
+struct TalkieDatagram {
+    sockaddr_in target;
+    const char* message;
+    size_t length;
+    TalkieCounters* counters;   // Of the device it's sent to
+    bool unicast;
+    uint32_t endpoint_i;        // Of the unicast ones, broadcasts go out on every endpoint
+};
+
+
+// One bound socket, with the subnet it reaches by broadcast
+struct TalkieEndpoint {
+#ifdef _WIN32
+    SOCKET sockfd = INVALID_SOCKET;
+#else
+    int sockfd = -1;
+#endif
+    std::string name;           // Of the interface, "any" for the default socket
+    in_addr address{};
+    in_addr netmask{};
+    in_addr broadcast{};
+};
+
 
+class TalkieSocket {
 private:
     const bool verbose;
-    int sockfd = -1;  // ONE socket for everything
+    // Every device, the named ones have their IPs updated based on the response (echo), the channel
+    // ones are only reached by broadcast, all kept for as long as the socket (a whole session)
+    TalkieRegistry talkie_registry;
+    const int talkie_port;
+    // Empty for ONE socket bound to every interface, otherwise INTERFACES_ALL or a list of them
+    const std::string interface_selection;
+    std::vector<TalkieEndpoint> endpoints;
     bool socket_initialized = false;
-    static struct sockaddr_in server_addr;
     std::vector<std::pair<std::string, std::string>> received_messages;
-    unsigned int total_updates = 0;
+    std::vector<uint32_t> received_endpoints;   // Where each of the received messages arrived
+    std::atomic<unsigned int> total_updates{0};
+    // Echoes are processed away from the playing thread
+    std::thread receiver_thread;
+    std::atomic<bool> receiver_running{false};
+    // Guards the devices maps against the receiver while a streamed load adds devices
+    std::mutex devices_mutex;
+    TalkieAcks *talkie_acks = nullptr;  // Of the reliable messages being played, guarded by devices_mutex
+    TalkieMessageWriter tempo_writer;
     
 public:
-    TalkieSocket(bool verbose = false) : verbose(verbose) { }
+    TalkieSocket(bool verbose = false, int talkie_port = TALKIE_DEFAULT_PORT, const std::string &interfaces = "")
+        : verbose(verbose), talkie_registry(this, verbose), talkie_port(talkie_port), interface_selection(interfaces) { }
     ~TalkieSocket() { closeSocket(); }
     
-    // Explicitly delete copy assignment
+    // Use this class as non-copyable and non-movable (it owns the receiver thread)
+    TalkieSocket(const TalkieSocket&) = delete;
     TalkieSocket& operator=(const TalkieSocket&) = delete;
-    // Use this class as non-copyable but movable
-    TalkieSocket(TalkieSocket&&) = default;             // Move constructor OK
-    TalkieSocket& operator=(TalkieSocket&&) = default;  // Move assignment OK
 
     bool initialize();
-    bool sendToDevice(const std::string& ip, int port, const std::string& message);
-    bool sendBroadcast(int port, const std::string& message);
+    // The one the sockets are bound to, and so the one the tempos are broadcasted to
+    int getPort() const { return talkie_port; }
+    size_t totalEndpoints() const { return endpoints.size(); }
+    const TalkieEndpoint& getEndpoint(uint32_t endpoint_i) const { return endpoints[endpoint_i]; }
+    // The endpoint whose subnet has the address, the first one if none has
+    uint32_t routeTo(const in_addr& address) const;
+    // False if not initialized or if the system call failed
+    bool sendTo(const sockaddr_in& target, const char* message, size_t length, uint32_t endpoint_i = 0);
+    bool sendToDevice(const std::string& ip, int port, const char* message, size_t length);
+    bool sendToDevice(const std::string& ip, int port, const std::string& message) {
+        return sendToDevice(ip, port, message.data(), message.size());
+    }
+    // To the broadcast address of every endpoint, false only if none was sent
+    bool sendBroadcast(int port, const char* message, size_t length);
+    bool sendBroadcast(int port, const std::string& message) {
+        return sendBroadcast(port, message.data(), message.size());
+    }
+    // Sends all datagrams with as few system calls as possible (one per endpoint), returns how many sends
+    // succeeded, a broadcast is sent once per endpoint
+    size_t sendDatagrams(const TalkieDatagram* datagrams, size_t total_datagrams);
     bool broadcastTempo(const nlohmann::json &json_talkie_clock);
-    bool hasMessages();
+    // Finds or adds the device of a message target (a name or a channel), TALKIE_NO_DEVICE for any other
+    // target, safe to call while the receiver is running
+    uint32_t getDeviceId(const nlohmann::json &target, int target_port);
+    uint32_t getDeviceId(const std::string &name, int target_port);
+    uint32_t getDeviceId(uint8_t channel, int target_port);
+    // The device of the tempo broadcasts to the port
+    uint32_t getBroadcastId(int target_port);
+    TalkieDevice& getDevice(uint32_t device_id) const { return talkie_registry.getDevice(device_id); }
+    // Only to be walked while nothing is being loaded
+    const TalkieRegistry& getRegistry() const { return talkie_registry; }
+    // The id and name of every named device, safe to call while the receiver is running
+    std::vector<std::pair<uint32_t, std::string>> namedDevices();
+    bool hasMessages(long timeout_us = 0);
     std::vector<std::pair<std::string, std::string>> receiveMessages();
-    bool updateAddresses();
-    unsigned int totalUpdates() const { return total_updates; }
+    bool updateAddresses(long timeout_us = 0);
+    unsigned int totalUpdates() const { return total_updates.load(std::memory_order_relaxed); }
+    size_t totalDevices() {
+        std::lock_guard<std::mutex> lock(devices_mutex);
+        return talkie_registry.totalNamed();
+    }
+    // The counters of every device, readable at any time (even while playing)
+    nlohmann::json devicesJson();
+    // The echoes are matched and the retransmissions sent by the receiver while attached (nullptr detaches)
+    void setAcks(TalkieAcks *acks);
+    // The receiver only looks devices up, they are added by getDeviceId
+    bool startReceiver();
+    void stopReceiver();
     void closeSocket();
+
+private:
+    bool openEndpoint(TalkieEndpoint &endpoint);
+    // The first endpoint with data to read within the timeout, -1 if none
+    int readyEndpoint(long timeout_us);
+    void receiverLoop();
 };
 
 
@@ -118,128 +215,163 @@ class TalkieDevice {
     private:
         TalkieSocket * const talkie_socket = nullptr;
         const bool verbose;
-        // Socket variables
-        std::string target_ip;  // Default constructor makes it empty
+        const bool named;               // Answers by name, so its messages can be acknowledged
+        const bool broadcast;           // Only ever a broadcast to its port (the tempos), never answers
+        // Socket variables, resolved once so that sending needs no string parsing
         int target_port;
+        sockaddr_in broadcast_target;
+        sockaddr_in unicast_target;     // Written once by the receiver thread before being published
+        uint32_t unicast_endpoint = 0;  // Where the answer came from, written together with unicast_target
+        // Points to broadcast_target until the device answers, then to unicast_target
+        std::atomic<const sockaddr_in*> active_target;
+        mutable TalkieCounters counters;    // Atomics, bumped while sending even by const senders
     
         
     public:
-        TalkieDevice(TalkieSocket * const socket, int port = 5005, bool verbose = false)
-                    : talkie_socket(socket), target_port(port), verbose(verbose) { }
+        TalkieDevice(TalkieSocket * const socket, int port = TALKIE_DEFAULT_PORT, bool verbose = false, bool named = false,
+            bool broadcast = false);
 
-        // Explicitly delete copy assignment
+        // Use this class as non-copyable and non-movable (owned in place by the registry)
+        TalkieDevice(const TalkieDevice&) = delete;
         TalkieDevice& operator=(const TalkieDevice&) = delete;
-        // Use this class as non-copyable but movable
-        TalkieDevice(TalkieDevice&&) = default;             // Move constructor OK
-        TalkieDevice& operator=(TalkieDevice&&) = default;  // Move assignment OK
 
         TalkieSocket * const getSocket();
-        void setTargetIP(const std::string& ip) { target_ip = ip; }
-        std::string getTargetIP() const { return target_ip; }
+        // The first address wins, it's published with release so the sender sees it whole
+        void setTargetAddress(const in_addr& address, uint32_t endpoint_i);
+        // Routed through the endpoint of its subnet (a cached address, not an answer)
+        void setTargetIP(const std::string& ip);
+        bool hasTargetIP() const { return active_target.load(std::memory_order_acquire) == &unicast_target; }
+        std::string getTargetIP() const;
         int getTargetPort() const { return target_port; }
-        bool sendMessage(const std::string& talkie_message);
+        const sockaddr_in& getTarget() const { return *active_target.load(std::memory_order_acquire); }
+        uint32_t getEndpoint() const { return unicast_endpoint; }
+        bool isNamed() const { return named; }
+        bool isBroadcast() const { return broadcast; }
+        bool sendMessage(const char* talkie_message, size_t length);
+        // Fills the datagram the same way sendMessage would send it (unicast or broadcast)
+        void setDatagram(TalkieDatagram &datagram, const char* talkie_message, size_t length) const;
+        bool sendMessage(const std::string& talkie_message) {
+            return sendMessage(talkie_message.data(), talkie_message.size());
+        }
+        TalkieCounters& getCounters() const { return counters; }
         
 };
 
 
 
-class TalkiePin {
-private:
-    const double time_ms;
-    TalkieDevice * const talkie_device = nullptr;
-    std::string talkie_message;
-    // Auxiliary variable for the final playing loop!!
-    double delay_time_ms = -1;
-
-public:
-    // Pin DEFAULT constructor, no arguments,
-    // needed for emplace and insert of the std::unordered_map inside TalkieDevice class !!
-    TalkiePin()
-        : time_ms(0),                       // Default to 0
-        talkie_device(nullptr),             // Default to nullptr
-        talkie_message(),                   // Default to an empty vector
-        delay_time_ms(-1)
-    { }
-
-    // Pin constructor
-    TalkiePin(double time_milliseconds, TalkieDevice* talkie_device,
-        const std::string& json_talkie_message)
-            : time_ms(time_milliseconds),
-            talkie_device(talkie_device),
-            talkie_message(json_talkie_message)
-        { }
-
-    // Pin copy constructor
-    TalkiePin(const TalkiePin& other)
-        : time_ms(other.time_ms),                   // Copy the time_ms
-          talkie_device(other.talkie_device),       // Copy the pointer to the TalkieDevice
-          talkie_message(other.talkie_message),     // Copy the talkie_message vector
-          delay_time_ms(other.delay_time_ms)
-    { }
-
-    double getTime() const {
-        return time_ms;
-    }
-
-    TalkieDevice *getTalkieDevice() const {
-        return talkie_device;
-    }
-
-    void pluckTooth();
-
-    void setDelayTime(double delay_time_ms) {
-        this->delay_time_ms = delay_time_ms;
-    }
-
-    double getDelayTime() const {
-        return this->delay_time_ms;
-    }
-
-    std::string getMessage() const {
-        return this->talkie_message; // Returns a copy
-    }
-
-    void setStatusByte(unsigned char status_byte) {
-        this->talkie_message[0] = status_byte;
-    }
-
-    unsigned char getStatusByte() const {
-        return this->talkie_message[0];
-    }
-
-    void setDataByte(int nth_byte, unsigned char data_byte) {
-        this->talkie_message[nth_byte] = data_byte;
-    }
-
-    unsigned char getDataByte(int nth_byte = 1) const {
-        return this->talkie_message[nth_byte];
-    }
-
-    unsigned char getChannel() const {
-        return this->talkie_message[0] & 0x0F;
-    }
-
-    unsigned char getAction() const {
-        return this->talkie_message[0] & 0xF0;
-    }
-
-    TalkieDevice * const getDevice() const {
-        return this->talkie_device;
-    }
-
+// What a late pin does to the ones after it
+enum class SchedulePolicy {
+    strict_grid,    // Nothing, the later pins keep the original grid and the late ones are sent at once
+    slew,           // Drags them like legacy_drag and then catches up with the grid at a slew rate
+    legacy_drag     // Drags them by the delay above DRAG_DURATION_MS, for good
 };
 
+bool parseSchedulePolicy(const std::string &policy_name, SchedulePolicy &schedule_policy);
+const char* schedulePolicyName(SchedulePolicy schedule_policy);
+
+
+struct PlayOptions {
+    TimerMode timer_mode    = TimerMode::hybrid;
+    SchedulePolicy schedule_policy = SchedulePolicy::legacy_drag;
+    double slew_rate        = SLEW_DEFAULT_RATE;    // Fraction of the time between pins taken off the drag
+    // Pins keep the time of the score, these two only map it into the play time line when playing,
+    // the play functions set the delay from the one they are given
+    double delay_ms         = 0.0;
+    double time_scale       = 1.0;      // Above 1 plays slower, below 1 faster
+    bool batch_sends        = true;     // Same time pins go out in a single system call
+    double look_ahead_s     = 0.0;      // Starts playing once these seconds of play are loaded (0 loads everything first)
+    std::string report_path;            // Where the play statistics are written as JSON (none if empty)
+    bool device_queues      = false;    // Each device is sent from its own queue and thread, a slow one delays no other
+    double late_drop_ms     = 0.0;      // Queued pins later than this are dropped (0 never drops)
+    double discovery_s      = 0.0;      // Waits up to these seconds for the devices to answer before playing (0 skips it)
+    std::string address_cache;          // Where the discovered addresses are kept for the next start (none if empty)
+    std::string cache_dir;              // Where the played files are kept compiled for the next plays (none if empty)
+    size_t cache_mb         = CACHE_DEFAULT_MB;
+    int talkie_port         = TALKIE_DEFAULT_PORT;  // Where the player listens and the tempos are broadcasted
+    std::string interfaces;             // One socket each, INTERFACES_ALL or a list of them (one for all if empty)
+    RealTimeOptions realtime;           // Of the play thread
+    bool reliable_runs      = false;    // Run messages without echo are sent again, until echoed or out of budget
+    double ack_timeout_ms   = ACKS_DEFAULT_TIMEOUT_MS;
+    double ack_budget_ms    = ACKS_DEFAULT_BUDGET_MS;
+    double coalesce_ms      = 0.0;      // Set messages to the same device and "n" within it are collapsed (0 keeps all)
+    double rate_limit       = 0.0;      // Messages per second of each device, over it they are deferred (0 for none)
+    double rate_burst       = SEND_DEFAULT_BURST;
+    double wheel_ahead_s    = 0.0;      // Fed through a timing wheel only these seconds of play ahead (0 loads everything)
+
+    double playTime(double score_ms) const { return delay_ms + score_ms * time_scale; }
+    double scoreTime(double play_ms) const { return (play_ms - delay_ms) / time_scale; }
+    // The look ahead and wheel windows are seconds of play, their span in the score the pins are loaded in
+    double scoreSpan(double play_s) const { return play_s * 1000 / time_scale; }
+};
 
 
-    
+struct PlayReporting {
+    size_t json_processing  = 0;    // milliseconds
+    size_t total_validated  = 0;
+    size_t total_incorrect  = 0;
+    size_t total_coalesced  = 0;        // Superseded set messages removed when loaded
+    double total_drag       = 0.0;      // The shift of the pins still to play, never grows with strict_grid
+    SchedulePolicy schedule_policy = SchedulePolicy::legacy_drag;  // The one of the last play
+    size_t late_batches     = 0;        // More than DRAG_DURATION_MS late
+    double maximum_drag     = 0.0;      // The largest shift reached while playing
+    double total_slewed     = 0.0;      // Drag taken back while catching up with the grid
+    double maximum_lateness = 0.0;      // Of a pin against the original grid, drag included
+    TalkieStatistics delays;            // Of each played pin (ms), accumulated as it's sent
+    size_t total_batches    = 0;        // Groups of same time pins sent together
+    size_t largest_batch    = 0;
+    size_t skewed_batches   = 0;        // Batches of more than one pin
+    double maximum_skew     = 0.0;      // Time between the first and the last send of a batch (ms)
+    double average_skew     = 0.0;
+    DiscoveryReport discovery;          // Of the phase before playing, if any
+    std::vector<RealTimeStep> realtime; // Each real time step tried, applied or not
+};
 
 
 // Declare the function in the header file
 void disableBackgroundThrottling();
 
-void setRealTimeScheduling();
-void highResolutionSleep(long long microseconds, TalkieSocket * const talkie_socket);
-int PlayList(const char* json_str, const int delay_ms, bool verbose = false);
+// Plays the sorted schedules one after the other in a single time line of the (calibrated) timer, starting
+// at first_pin of the first one as if start_time_ms had just been reached, until next_schedule gives nullptr
+// or the timer is interrupted. Returns the first pin not played of the last schedule.
+size_t playSchedules(TalkieSocket &talkie_socket, TalkieTimer &talkie_timer, const std::function<TalkieSchedule*()> &next_schedule,
+        const PlayOptions &play_options, PlayReporting &play_reporting, bool verbose = false,
+        size_t first_pin = 0, double start_time_ms = 0.0);
+// The tempos are played in the time line, this one sends the tempo in effect just before start_time_ms
+// (of the score), its bpm_10 scaled like the played ones
+void broadcastStartTempo(TalkieSocket &talkie_socket, const TalkieSchedule &tempo_pins, double start_time_ms,
+    double time_scale = 1.0);
+void reportData(const PlayReporting &play_reporting, size_t total_pins, bool verbose);
+void reportPlay(const PlayReporting &play_reporting, bool verbose);
+// The same statistics as machine readable JSON
+nlohmann::json reportJson(const PlayReporting &play_reporting);
+// Both the play statistics and the devices counters
+bool writeReport(const PlayReporting &play_reporting, TalkieSocket &talkie_socket, const std::string &report_path);
+void reportDevices(TalkieSocket &talkie_socket, bool verbose);
+
+// Also unpins the calling thread, see TalkieRealTime
+void setBackgroundScheduling();
+void highResolutionSleep(long long microseconds);
+// Parses the concatenated Json Midi Player files into time sorted pins, tempo messages are collected apart
+bool loadJsonPins(const char* json_str, TalkieSocket &talkie_socket,
+        TalkieSchedule &talkie_pins, TalkieSchedule &tempo_pins, PlayReporting &play_reporting, bool verbose = false);
+// Same as loadJsonPins but streamed straight from the files, never holding their whole text,
+// each file on its own worker thread with their sorted pins merged at the end
+bool loadJsonFiles(const std::vector<std::string> &json_paths, TalkieSocket &talkie_socket,
+        TalkieSchedule &talkie_pins, TalkieSchedule &tempo_pins, PlayReporting &play_reporting, bool verbose = false);
+int PlayList(const char* json_str, const int delay_ms, bool verbose = false, const PlayOptions &play_options = PlayOptions());
+// Same as PlayList parsing the given bytes in place, without needing them NUL terminated
+int PlayBuffer(const char* json_data, size_t json_length, const int delay_ms, bool verbose = false,
+        const PlayOptions &play_options = PlayOptions());
+// Plays the Json Midi Player files, with a look ahead a single file starts playing while still loading
+int PlayFiles(const std::vector<std::string> &json_paths, const int delay_ms, bool verbose = false,
+        const PlayOptions &play_options = PlayOptions());
+// Plays a play list previously compiled with CompileList (see TalkieCompiled.hpp), its delay is
+// added to the one of the options
+int PlayCompiled(const char* compiled_path, bool verbose = false, const PlayOptions &play_options = PlayOptions());
+// Compiles the concatenated Json Midi Player files into a binary play list ready to be memory mapped
+int CompileList(const char* json_str, const int delay_ms, const char* compiled_path, bool verbose = false);
+int CompileBuffer(const char* json_data, size_t json_length, const int delay_ms, const char* compiled_path, bool verbose = false);
+int CompileFiles(const std::vector<std::string> &json_paths, const int delay_ms, const char* compiled_path, bool verbose = false);
 
 
 #endif // JSON_TALKIE_PLAYER_HPP
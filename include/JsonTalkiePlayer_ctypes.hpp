@@ -27,6 +27,58 @@ https://github.com/ruiseixasm/JsonTalkiePlayer
 
 extern "C" {    // Needed for Python ctypes
     DLL_EXPORT int PlayList_ctypes(const char* json_str, const int delay_ms, int verbose);
+    DLL_EXPORT int PlayCompiled_ctypes(const char* compiled_path, int verbose);
+    DLL_EXPORT int CompileList_ctypes(const char* json_str, const int delay_ms, const char* compiled_path, int verbose);
+    // Zero copy, the bytes are parsed in place and don't need to be NUL terminated
+    DLL_EXPORT int PlayBuffer_ctypes(const char* json_data, size_t json_length, const int delay_ms, int verbose);
+    DLL_EXPORT int CompileBuffer_ctypes(const char* json_data, size_t json_length, const int delay_ms,
+        const char* compiled_path, int verbose);
+    // Each Json Midi Player file is memory mapped and parsed in place, no joining of them needed
+    DLL_EXPORT int PlayFiles_ctypes(const char** file_paths, int total_files, const int delay_ms, int verbose);
+    // Same as above keeping them compiled in cache_dir (capped at cache_mb, 0 for the default) for the next plays
+    DLL_EXPORT int PlayFilesCached_ctypes(const char** file_paths, int total_files, const int delay_ms,
+        const char* cache_dir, int cache_mb, int verbose);
+    // Plays either a compiled play list or a Json Midi Player file given by its path
+    DLL_EXPORT int PlayFile_ctypes(const char* file_path, const int delay_ms, int verbose);
+    // A persistent session keeps the socket, the devices IPs and the timer calibration between plays
+    DLL_EXPORT void* SessionCreate_ctypes(int verbose);     // NULL if the socket can't be initialized
+    // On another port and/or with one socket per interface ("all" or a comma list, NULL for one socket)
+    DLL_EXPORT void* SessionCreateOn_ctypes(int verbose, int talkie_port, const char* interfaces);
+    DLL_EXPORT int SessionLoad_ctypes(void* session, const char* json_str, const int delay_ms);
+    // Either a compiled play list or a Json Midi Player file given by its path
+    DLL_EXPORT int SessionLoadFile_ctypes(void* session, const char* file_path, const int delay_ms);
+    DLL_EXPORT int SessionLoadBuffer_ctypes(void* session, const char* json_data, size_t json_length, const int delay_ms);
+    DLL_EXPORT int SessionLoadFiles_ctypes(void* session, const char** file_paths, int total_files, const int delay_ms);
+    DLL_EXPORT int SessionPlay_ctypes(void* session);       // Blocks until the end or a stop
+    // Non blocking transport, playing on its own thread
+    DLL_EXPORT int SessionStart_ctypes(void* session);      // Also resumes when paused
+    DLL_EXPORT void SessionPause_ctypes(void* session);
+    DLL_EXPORT void SessionSeek_ctypes(void* session, double time_ms);
+    DLL_EXPORT void SessionStop_ctypes(void* session);      // Rewinds to the start
+    DLL_EXPORT void SessionWait_ctypes(void* session);      // Blocks until stopped
+    DLL_EXPORT double SessionPosition_ctypes(void* session);    // Milliseconds
+    DLL_EXPORT void SessionSetDelay_ctypes(void* session, double delay_ms);   // From the next start, resume or seek
+    DLL_EXPORT void SessionSeekBeat_ctypes(void* session, double beat);
+    DLL_EXPORT double SessionBeat_ctypes(void* session);    // Along the tempo map
+    DLL_EXPORT double SessionBpm_ctypes(void* session);     // Of the tempo at the position
+    DLL_EXPORT int SessionState_ctypes(void* session);      // 0 stopped, 1 playing, 2 paused
+    // Statistics of the last play as JSON, valid until the next call from the same thread
+    DLL_EXPORT const char* SessionReport_ctypes(void* session);
+    // Counters of each device as JSON, can be called while playing, valid as the one above
+    DLL_EXPORT const char* SessionDevices_ctypes(void* session);
+    DLL_EXPORT void SessionDestroy_ctypes(void* session);
+    // Live play of the batches pushed here or received on control_port (TCP and UDP), see TalkieLive.hpp
+    DLL_EXPORT void* LiveCreate_ctypes(int verbose, int control_port);     // NULL if it can't be started
+    // A compiled play list or Json Midi Player content, its times of the live time line, returns the pins accepted
+    DLL_EXPORT int LivePush_ctypes(void* live, const char* batch_data, size_t batch_length);
+    DLL_EXPORT double LivePosition_ctypes(void* live);  // Milliseconds since it was created
+    DLL_EXPORT int LivePending_ctypes(void* live);
+    DLL_EXPORT void LiveStop_ctypes(void* live);
+    DLL_EXPORT void LiveWait_ctypes(void* live);        // Blocks until stopped, by LiveStop or by a client
+    DLL_EXPORT void LiveDestroy_ctypes(void* live);
+    // Traces the loading and playing (of any of the above) into a ring buffer of the given events (0 for the default)
+    DLL_EXPORT void TraceEnable_ctypes(int capacity_events);
+    DLL_EXPORT int TraceWrite_ctypes(const char* trace_path);   // As a Chrome trace JSON file
     DLL_EXPORT int add_ctypes(int a, int b);
 }
 
@@ -0,0 +1,84 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_ACKS_HPP
+#define TALKIE_ACKS_HPP
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <cstdint>
+
+
+#define ACKS_DEFAULT_TIMEOUT_MS 30.0    // Without an echo for this long the message is sent again
+#define ACKS_DEFAULT_BUDGET_MS  200.0   // Since the first send, after it the message is given up as lost
+#define ACKS_TABLE_BITS         12      // 4096 slots, up to 3/4 of them outstanding
+#define ACKS_RECEIVE_TIMEOUT_US 5000    // How often the receiver checks for the retransmissions
+#define ACKS_MESSAGE_BYTES      240     // Longer run messages aren't tracked
+
+
+class TalkieSocket;
+
+
+// The reliable messages sent and not yet echoed, in an open addressing table keyed by the device and the
+// message "i". The playing thread only adds to it, the echoes are matched and the retransmissions are sent
+// from the receiver thread, so the time line never waits for any of them.
+class TalkieAcks {
+private:
+    struct Outstanding {
+        uint64_t key;           // Device id and "i", 0 when the slot is empty
+        long long first_send_ns;
+        long long last_send_ns;
+        uint32_t length;
+        uint32_t retransmits;
+        char message[ACKS_MESSAGE_BYTES];   // Copied, a streamed block is released once played
+    };
+
+    TalkieSocket &talkie_socket;
+    const long long timeout_ns;
+    const long long budget_ns;
+    std::vector<Outstanding> table;
+    size_t total_outstanding = 0;
+    std::mutex table_mutex;     // Held only to add, match or walk, never while sending
+
+public:
+    TalkieAcks(TalkieSocket &socket, double timeout_ms = ACKS_DEFAULT_TIMEOUT_MS, double budget_ms = ACKS_DEFAULT_BUDGET_MS);
+
+    // Use this class as non-copyable (the receiver thread points to it)
+    TalkieAcks(const TalkieAcks&) = delete;
+    TalkieAcks& operator=(const TalkieAcks&) = delete;
+
+    // Adds a just sent message, only the ones of the run code are tracked, false if the table was full
+    // or the message too long
+    bool track(uint32_t device_id, const char* message, size_t length, long long send_ns);
+    // An echo of the device, the matching message isn't sent again
+    void acknowledge(uint32_t device_id, uint32_t message_id, long long echo_ns);
+    // Sends again the ones without echo for longer than the timeout and gives up the ones out of budget
+    void retransmit(long long now_ns);
+    size_t outstanding();
+    // Waits for the last ones to be echoed or given up, so the end of a play still gets its retransmissions
+    void drain();
+
+private:
+    static uint64_t messageKey(uint32_t device_id, uint32_t message_id) {
+        return (static_cast<uint64_t>(device_id) + 1) << 32 | message_id;   // Never 0
+    }
+    size_t slotOf(uint64_t key) const;
+    // Backward shift, so that the table never needs tombstones
+    void erase(size_t slot_i);
+};
+
+
+#endif // TALKIE_ACKS_HPP
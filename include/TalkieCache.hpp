@@ -0,0 +1,51 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_CACHE_HPP
+#define TALKIE_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+#define CACHE_DEFAULT_MB    256         // Size cap of the cache directory
+#define CACHE_EXTENSION     ".jtpc"
+
+
+// Directory of compiled play lists named by the hash of the JSON files content, so replaying
+// the same export maps the compiled one instead of parsing, encoding and sorting it all over again.
+// The least recently used compiled play lists are evicted once the directory exceeds its size cap.
+class TalkieCache {
+private:
+    const std::string cache_dir;
+    const uint64_t maximum_bytes;
+    const bool verbose;
+
+public:
+    TalkieCache(const std::string &cache_dir, size_t maximum_mb = CACHE_DEFAULT_MB, bool verbose = false);
+
+    // The compiled play list of these files, compiled (without delay) and stored first on a miss,
+    // empty if the files can't be read or compiled
+    std::string compiledPath(const std::vector<std::string> &json_paths);
+
+private:
+    bool hashFiles(const std::vector<std::string> &json_paths, uint64_t &content_hash) const;
+    // Removes the oldest used ones until the cap is met, never the one just stored
+    void evict(const std::string &kept_path) const;
+};
+
+
+#endif // TALKIE_CACHE_HPP
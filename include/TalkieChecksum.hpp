@@ -0,0 +1,34 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_CHECKSUM_HPP
+#define TALKIE_CHECKSUM_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+// JsonTalkie checksum: XOR of the message as big endian 16 bits chunks, computed as if the
+// digits of the first "c": value (and of any later one) were a single '0'.
+// Single pass over the message of any length, 8 bytes at a time away from any '"'.
+uint16_t calculate_checksum(const char* data, size_t length);
+
+inline uint16_t calculate_checksum(const std::string& data) {
+    return calculate_checksum(data.data(), data.size());
+}
+
+
+#endif // TALKIE_CHECKSUM_HPP
@@ -0,0 +1,143 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_COMPILED_HPP
+#define TALKIE_COMPILED_HPP
+
+#include "JsonTalkiePlayer.hpp"
+
+#include <cstdint>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+
+// Binary play list layout (native little endian, all sections 8 bytes aligned):
+//     CompiledHeader | CompiledDevice[device_count] | CompiledPin[pin_count] | CompiledPin[tempo_count] | payload
+// Pins are already sorted by time and their messages already carry the final "i" and "c" values,
+// so, playing them requires no parsing, no encoding, no checksum and no sorting at all.
+// Times are of the score, the delay given when compiling is only kept in the header and added at play time.
+// The tempos are pins of a broadcast device too, the tempo pins are only their map.
+#define COMPILED_MAGIC      "JTPC"
+#define COMPILED_VERSION    3
+#define COMPILED_NO_DEVICE  0xFFFFFFFFu     // Tempo map pins, not played as such
+#define COMPILED_NO_CHANNEL -1              // Devices targeted by name
+#define COMPILED_BROADCAST  -2              // Devices only reached by broadcast to their port (the tempos)
+
+
+struct CompiledHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t device_count;
+    uint32_t pin_count;
+    uint32_t tempo_count;
+    int32_t  delay_ms;      // Of the compiling, added to the one given when playing
+    uint64_t payload_size;
+};
+
+struct CompiledDevice {
+    uint32_t port;
+    int32_t  channel;       // COMPILED_NO_CHANNEL for named devices, COMPILED_BROADCAST for the tempos
+    uint32_t name_offset;   // Name bytes in the payload (empty for channel devices)
+    uint32_t name_length;
+};
+
+struct CompiledPin {
+    double   time_ms;
+    uint32_t device;        // Index in the devices table or COMPILED_NO_DEVICE
+    uint32_t length;        // Message bytes in the payload
+    uint64_t offset;
+};
+
+static_assert(sizeof(CompiledHeader) == 32, "CompiledHeader must be packed as 32 bytes");
+static_assert(sizeof(CompiledDevice) == 16, "CompiledDevice must be packed as 16 bytes");
+static_assert(sizeof(CompiledPin) == 24, "CompiledPin must be packed as 24 bytes");
+
+
+
+// Read only memory mapping of a whole file
+class MappedFile {
+private:
+    const char* file_data = nullptr;
+    size_t file_size = 0;
+#ifdef _WIN32
+    HANDLE file_handle = INVALID_HANDLE_VALUE;
+    HANDLE mapping_handle = nullptr;
+#endif
+
+public:
+    MappedFile() { }
+    ~MappedFile() { unmap(); }
+
+    // Use this class as non-copyable and non-movable (the mapping is owned)
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool map(const char* path);
+    void unmap();
+    const char* data() const { return file_data; }
+    size_t size() const { return file_size; }
+};
+
+
+// Validated view over a memory mapped compiled play list, or over one already in memory
+class CompiledPlayList {
+private:
+    MappedFile mapped_file;
+    const char* compiled_data = nullptr;
+    const CompiledHeader* compiled_header = nullptr;
+
+public:
+    bool open(const char* path, bool verbose = false);
+    // The bytes aren't copied, so they must outlive the view (and the schedules loaded from it)
+    bool attach(const char* data, size_t size, bool verbose = false);
+    void close();
+
+    const CompiledHeader* header() const { return compiled_header; }
+    const CompiledDevice* devices() const;
+    const CompiledPin* pins() const;
+    const CompiledPin* tempos() const;
+    const char* payload() const;
+    bool inPayload(uint64_t offset, uint64_t length) const;
+    // Drops the pages already read between the two from memory (mapped files only), so a long play list
+    // played front to back never stays resident as a whole
+    void releasePages(const char* begin, const char* end) const;
+};
+
+
+// Checks the magic bytes without mapping the whole file
+bool isCompiledFile(const char* path);
+// Encodes the sorted pins and their devices (every device of the given socket) as a compiled play list
+bool encodeCompiledPlayList(std::string &compiled, const TalkieSocket &talkie_socket,
+        const TalkieSchedule &talkie_pins, const TalkieSchedule &tempo_pins, int delay_ms = 0);
+// The same into a file
+bool writeCompiledPlayList(const char* path, const TalkieSocket &talkie_socket,
+        const TalkieSchedule &talkie_pins, const TalkieSchedule &tempo_pins, int delay_ms = 0, bool verbose = false);
+// Recreates the devices inside the socket, device_ids maps the devices table into their socket ids
+bool loadCompiledDevices(const CompiledPlayList &compiled, TalkieSocket &talkie_socket,
+        std::vector<uint32_t> &device_ids, bool verbose = false);
+// Checks the message bounds and the device of a pin, resolving it to its socket id
+bool compiledPinDevice(const CompiledPlayList &compiled, const CompiledPin &compiled_pin,
+        const std::vector<uint32_t> &device_ids, uint32_t &device_id, bool verbose = false);
+// Recreates the devices inside the socket and fills the given (empty) schedules without copying any message,
+// so the compiled play list has to stay open while the schedules are played
+bool loadCompiledPins(const CompiledPlayList &compiled, TalkieSocket &talkie_socket,
+        TalkieSchedule &talkie_pins, TalkieSchedule &tempo_pins, bool verbose = false);
+
+
+#endif // TALKIE_COMPILED_HPP
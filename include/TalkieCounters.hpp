@@ -0,0 +1,102 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_COUNTERS_HPP
+#define TALKIE_COUNTERS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+#define COUNTERS_MINIMUM_NS         64      // The first bucket edge of the send call durations
+#define COUNTERS_BUCKETS_PER_OCTAVE 4       // Each bucket is about 19% wide
+#define COUNTERS_OCTAVES            24      // Up to about 1 s, beyond it all goes in the last bucket
+#define COUNTERS_BUCKETS            (1 + COUNTERS_OCTAVES * COUNTERS_BUCKETS_PER_OCTAVE)
+
+
+// Lock free counters of a single device, bumped by the playing and the receiver threads with relaxed atomics,
+// so they can be left on while playing and read at any moment from any other thread (each reading is exact,
+// all together they are a close snapshot)
+class TalkieCounters {
+private:
+    std::atomic<uint64_t> unicast_sends{0};
+    std::atomic<uint64_t> broadcast_sends{0};
+    std::atomic<uint64_t> send_errors{0};
+    std::atomic<uint64_t> checksum_failures{0};
+    std::atomic<uint64_t> late_drops{0};        // Queued too long to be still worth sending
+    std::atomic<uint64_t> full_drops{0};        // Found the send queue full
+    std::atomic<long long> first_send_ns{0};    // Steady clock, 0 until the first send
+    std::atomic<long long> discovered_ns{0};    // Steady clock, 0 until the first valid echo
+    std::array<std::atomic<uint64_t>, COUNTERS_BUCKETS> send_buckets{};     // Durations of the send calls
+    // Of the reliable messages, sent until echoed or out of their deadline budget
+    std::atomic<uint64_t> tracked_messages{0};
+    std::atomic<uint64_t> acknowledged{0};
+    std::atomic<uint64_t> retransmits{0};
+    std::atomic<uint64_t> lost_messages{0};
+    std::atomic<uint64_t> untracked{0};         // Found the table of the outstanding ones full
+    std::array<std::atomic<uint64_t>, COUNTERS_BUCKETS> round_trip_buckets{};   // Of the ones echoed at the first send
+    std::atomic<uint64_t> coalesced{0};         // Set messages superseded by a later one when loaded
+    std::atomic<uint64_t> deferred{0};          // Held back by the rate limit until the device had room
+
+public:
+    TalkieCounters() { }
+
+    // Use this class as non-copyable (it's made of atomics)
+    TalkieCounters(const TalkieCounters&) = delete;
+    TalkieCounters& operator=(const TalkieCounters&) = delete;
+
+    static long long clockNs();     // Steady clock nanoseconds, the time base of all the counters
+
+    void countSend(bool unicast, bool sent, long long send_start_ns, long long send_finish_ns);
+    void countChecksumFailure() { checksum_failures.fetch_add(1, std::memory_order_relaxed); }
+    void countLateDrop() { late_drops.fetch_add(1, std::memory_order_relaxed); }
+    void countFullDrop() { full_drops.fetch_add(1, std::memory_order_relaxed); }
+    void markDiscovered(long long discovered_time_ns);
+    void countTracked() { tracked_messages.fetch_add(1, std::memory_order_relaxed); }
+    void countAcknowledged(long long round_trip_ns, bool retransmitted);
+    void countRetransmit() { retransmits.fetch_add(1, std::memory_order_relaxed); }
+    void countLost() { lost_messages.fetch_add(1, std::memory_order_relaxed); }
+    void countUntracked() { untracked.fetch_add(1, std::memory_order_relaxed); }
+    void countCoalesced() { coalesced.fetch_add(1, std::memory_order_relaxed); }
+    void countDeferred() { deferred.fetch_add(1, std::memory_order_relaxed); }
+
+    uint64_t unicastSends() const { return unicast_sends.load(std::memory_order_relaxed); }
+    uint64_t broadcastSends() const { return broadcast_sends.load(std::memory_order_relaxed); }
+    uint64_t sendErrors() const { return send_errors.load(std::memory_order_relaxed); }
+    uint64_t checksumFailures() const { return checksum_failures.load(std::memory_order_relaxed); }
+    uint64_t lateDrops() const { return late_drops.load(std::memory_order_relaxed); }
+    uint64_t fullDrops() const { return full_drops.load(std::memory_order_relaxed); }
+    // From the first send (a broadcast) to its first valid echo, negative until discovered
+    double discoveryMs() const;
+    uint64_t trackedMessages() const { return tracked_messages.load(std::memory_order_relaxed); }
+    uint64_t acknowledgedMessages() const { return acknowledged.load(std::memory_order_relaxed); }
+    uint64_t totalRetransmits() const { return retransmits.load(std::memory_order_relaxed); }
+    uint64_t lostMessages() const { return lost_messages.load(std::memory_order_relaxed); }
+    uint64_t untrackedMessages() const { return untracked.load(std::memory_order_relaxed); }
+    uint64_t coalescedMessages() const { return coalesced.load(std::memory_order_relaxed); }
+    uint64_t deferredMessages() const { return deferred.load(std::memory_order_relaxed); }
+    // Send call duration not exceeded by the given fraction of the sends, upper edge of its bucket
+    double sendPercentileUs(double fraction) const;
+    // The same of the round trips, only the ones not retransmitted (an echo of a retransmit is ambiguous)
+    double roundTripPercentileMs(double fraction) const;
+
+private:
+    static void addDuration(std::array<std::atomic<uint64_t>, COUNTERS_BUCKETS> &buckets, long long duration_ns);
+    static double percentileNs(const std::array<std::atomic<uint64_t>, COUNTERS_BUCKETS> &buckets, double fraction);
+};
+
+
+#endif // TALKIE_COUNTERS_HPP
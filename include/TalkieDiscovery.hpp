@@ -0,0 +1,53 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_DISCOVERY_HPP
+#define TALKIE_DISCOVERY_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+
+#define DISCOVERY_PROBE_MS  250     // The devices still without an answer are probed again at this interval
+#define DISCOVERY_POLL_MS   2
+
+
+class TalkieSocket;
+
+
+struct DiscoveryReport {
+    bool probed             = false;    // The discovery phase took place
+    double discovery_ms     = 0.0;
+    size_t total_probed     = 0;        // Named devices still without an address when it started
+    size_t total_answered   = 0;
+    size_t total_cached     = 0;        // Never answered, not even at their cached address (played by broadcast)
+    std::vector<std::string> unanswered;    // Names of the devices that never answered
+};
+
+
+// Probes the named devices without an address (by unicast to their cached address, if any, and by
+// broadcast otherwise) and waits for their echoes until all answered or timeout_s is over. The ones that
+// never answered are played by broadcast until they do, as a cached address may be stale, and the answered
+// ones update the cache (if a path is given).
+DiscoveryReport discoverDevices(TalkieSocket &talkie_socket, double timeout_s, const std::string &cache_path, bool verbose = false);
+
+// The cache is a JSON object of {"name": {"ip": "...", "port": 5005}}, a missing file is just empty
+bool loadAddressCache(const std::string &cache_path, std::unordered_map<std::string, std::string> &cached_ips);
+// Merges the addresses known by the socket into the cache file
+bool saveAddressCache(const std::string &cache_path, TalkieSocket &talkie_socket);
+
+
+#endif // TALKIE_DISCOVERY_HPP
@@ -0,0 +1,56 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_INTERFACES_HPP
+#define TALKIE_INTERFACES_HPP
+
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX    // disables the definition of min and max macros.
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <winsock2.h>
+#else
+    #include <netinet/in.h>
+#endif
+
+
+#define INTERFACES_ALL  "all"   // Every interface able to broadcast, the loopback excluded
+
+
+// An IPv4 interface that is up, with the directed broadcast address of its subnet
+struct TalkieInterface {
+    std::string name;           // As the system calls it (an adapter name on Windows)
+    in_addr address;
+    in_addr netmask;
+    in_addr broadcast;
+    bool loopback;
+};
+
+
+std::vector<TalkieInterface> listInterfaces();
+// From INTERFACES_ALL or a comma separated list of names and addresses, false if any of them isn't found
+bool selectInterfaces(const std::string &selection, std::vector<TalkieInterface> &selected_interfaces,
+        bool verbose = false);
+// Whether the address is in the subnet of the interface
+bool inSubnet(const TalkieInterface &talkie_interface, const in_addr &address);
+
+
+#endif // TALKIE_INTERFACES_HPP
@@ -0,0 +1,170 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_LIVE_HPP
+#define TALKIE_LIVE_HPP
+
+#include "JsonTalkiePlayer.hpp"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+
+
+#define LIVE_HORIZON_MS         5.0         // Pins this close to being due are handed over to the play thread
+#define LIVE_MAXIMUM_PENDING    (1 << 20)   // Pins waiting to be played, the ones beyond are refused
+#define LIVE_MAXIMUM_FRAME      (64 << 20)  // Bytes of a single batch sent over TCP
+#define LIVE_POLL_MS            50          // Bounds how long stop() waits for the control thread
+#define LIVE_STOP_COMMAND       "stop"      // A frame (or datagram) of just this ends the live play
+
+#ifdef _WIN32
+    typedef SOCKET LiveSocket;
+    #define LIVE_NO_SOCKET INVALID_SOCKET
+#else
+    typedef int LiveSocket;
+    #define LIVE_NO_SOCKET -1
+#endif
+
+
+struct LiveReport {
+    size_t total_batches    = 0;
+    size_t invalid_batches  = 0;        // Neither a compiled play list nor a Json Midi Player content
+    size_t accepted_pins    = 0;
+    size_t refused_pins     = 0;        // Messages too long to be kept or beyond LIVE_MAXIMUM_PENDING
+    size_t late_pins        = 0;        // Already behind the position when they arrived, played at once
+    size_t maximum_pending  = 0;
+};
+
+// What a batch got, also the answer sent back to the client as a JSON line
+struct LiveAnswer {
+    bool valid              = false;
+    size_t accepted         = 0;
+    size_t refused          = 0;
+    double position_ms      = 0.0;      // Of the live time line when it was merged
+    size_t pending          = 0;
+};
+
+
+// Plays a time line that keeps growing while it's played. Time stamped batches of pins arrive from a
+// control port (or from push), are loaded away from the play thread and merged into a min-heap of
+// pending pins (O(log n) each), from which the play thread takes the ones about to be due, so a
+// generator can stream ahead of the playhead while the socket and the devices stay warm.
+// Control port, TCP and UDP on the same number:
+//   TCP frames are a little endian uint32 length followed by that many bytes, each UDP datagram is one;
+//   a batch is either a compiled play list (its delay is added to its times) or Json Midi Player content,
+//   its times in milliseconds of the live time line, which starts with start();
+//   an empty one just asks for the position, and LIVE_STOP_COMMAND ends the live play;
+//   each one is answered with a JSON line of the LiveAnswer.
+// The time line is never dragged (strict grid), late pins are sent at once.
+class TalkieLive {
+private:
+    // The message is copied in, so it doesn't depend on the batch it came from
+    struct Slot {
+        uint32_t device_id;
+        uint32_t length;
+        char message[SEND_MESSAGE_BYTES];
+    };
+    struct PendingPin {
+        double time_ms;
+        uint64_t sequence;      // Same time pins keep their arrival order
+        uint32_t slot_i;
+        bool operator>(const PendingPin &other) const {
+            return time_ms > other.time_ms || (time_ms == other.time_ms && sequence > other.sequence);
+        }
+    };
+    struct Client {
+        LiveSocket sockfd;
+        std::vector<char> received;     // A partial frame, until it's whole
+    };
+
+    const bool verbose;
+    const PlayOptions play_options;
+    const int control_port;
+    TalkieSocket talkie_socket;
+    TalkieTimer talkie_timer;           // Calibrated once
+    bool socket_ready = false;
+
+    // Guards everything pending, the play thread only holds it while taking the due pins
+    std::mutex pending_mutex;
+    std::condition_variable pending_condition;
+    std::vector<PendingPin> pending_pins;   // Min-heap by time
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    uint64_t next_sequence = 0;
+    bool stop_requested = false;
+    bool playing = false;
+    std::chrono::steady_clock::time_point live_origin;  // Time zero of the live time line
+    LiveReport live_report;
+    TalkieSchedule live_batch;          // Only touched by the play thread
+
+    LiveSocket tcp_socket = LIVE_NO_SOCKET;
+    LiveSocket udp_socket = LIVE_NO_SOCKET;
+    std::vector<Client> clients;        // Only touched by the control thread
+    std::atomic<bool> control_running{false};
+    std::thread control_thread;
+    std::thread play_thread;
+    PlayReporting play_reporting;       // Of the play thread, read it once stopped
+
+public:
+    TalkieLive(int control_port, bool verbose = false, const PlayOptions &play_options = PlayOptions());
+    ~TalkieLive();
+
+    // Use this class as non-copyable and non-movable (it owns the sockets and their threads)
+    TalkieLive(const TalkieLive&) = delete;
+    TalkieLive& operator=(const TalkieLive&) = delete;
+
+    bool isReady() const { return socket_ready; }
+
+    // Starts the live time line and the control port, false if they can't be
+    bool start();
+    // Loads a batch and merges its pins into the pending ones, from any thread
+    LiveAnswer push(const char* data, size_t length);
+    // Ends the play at once, whatever is still pending is dropped
+    void stop();
+    // Blocks until stopped (by stop() or by a client)
+    void wait();
+
+    // Milliseconds of the live time line, 0 before start()
+    double getPosition();
+    size_t totalPending();
+    LiveReport getLiveReport();
+    // Statistics of the play, read them once stopped
+    const PlayReporting& getReporting() const { return play_reporting; }
+
+private:
+    bool openControl();
+    void closeControl();
+    void controlLoop();
+    // False once the client is to be closed
+    bool readClient(Client &client);
+    void answer(const LiveAnswer &live_answer, LiveSocket sockfd, const sockaddr_in *udp_source = nullptr);
+    // Called holding the pending_mutex
+    double positionMs() const;
+    // The play thread waits in here for the next pins to be due, nullptr once stopped
+    TalkieSchedule* nextBatch();
+    void playLive();
+};
+
+
+// Answers with the position and how much is pending
+std::string liveAnswerJson(const LiveAnswer &live_answer);
+nlohmann::json liveReportJson(const LiveReport &live_report);
+
+
+#endif // TALKIE_LIVE_HPP
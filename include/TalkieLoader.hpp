@@ -0,0 +1,138 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_LOADER_HPP
+#define TALKIE_LOADER_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <nlohmann/json.hpp>    // Include the JSON library
+#include "TalkieSchedule.hpp"
+#include "TalkieMessage.hpp"
+
+
+#define STREAM_BLOCK_PINS   4096    // Pins per handed over block, same time pins are never split
+
+
+class TalkieSocket;
+struct PlayReporting;
+
+
+// Turns Json Midi Player files into pins while they are parsed (SAX), building the DOM of just
+// one element at a time, so neither a copy of the whole text nor its whole DOM is ever kept in memory
+class TalkieLoader {
+private:
+    TalkieSocket &talkie_socket;
+    const bool verbose;
+    PlayReporting &play_reporting;
+    TalkieSchedule *talkie_pins;
+    TalkieSchedule *tempo_pins;
+    TalkieMessageWriter message_writer;
+    std::function<bool(double)> before_pin;
+
+public:
+    // Pins keep the time of the score, the delay is only applied when they are played
+    TalkieLoader(TalkieSocket &talkie_socket, TalkieSchedule &talkie_pins, TalkieSchedule &tempo_pins,
+        PlayReporting &play_reporting, bool verbose = false);
+
+    // Use this class as non-copyable (other threads may reference it)
+    TalkieLoader(const TalkieLoader&) = delete;
+    TalkieLoader& operator=(const TalkieLoader&) = delete;
+
+    // A Json Midi Player file or an array of them (as joined by the callers), pins come unsorted
+    bool loadString(const char* json_str);
+    // Parsed in place, the buffer doesn't need to be NUL terminated
+    bool loadBuffer(const char* json_data, size_t json_length);
+    // Memory mapped and parsed in place, streamed instead if it can't be mapped (pipes)
+    bool loadFile(const char* json_path);
+    // Each file is loaded and sorted on its own worker thread, then they are k-way merged in file order
+    bool loadFiles(const std::vector<std::string> &json_paths);
+    // One element of a file content, either a Talkie message or a tempo, false once the load is stopped
+    bool loadElement(const nlohmann::json &json_element);
+
+    // Redirects the next pins, the streaming hands the loaded ones over block by block this way
+    void setSchedules(TalkieSchedule &talkie_pins, TalkieSchedule &tempo_pins);
+    // Called with the time of each Talkie pin right before it's added, returning false stops the load there
+    // (the parse is aborted, so the load returns false too)
+    void setBeforePin(std::function<bool(double)> callback) { before_pin = std::move(callback); }
+    bool isVerbose() const { return verbose; }
+};
+
+
+// Loads on a background thread while the first blocks are already playing, so playing starts as soon
+// as the look ahead window is loaded. Intended for time ordered files (as exported by Json Midi Creator),
+// pins out of order across blocks can only be played late.
+class TalkieStream {
+public:
+    struct Block {
+        TalkieSchedule talkie_pins;
+        TalkieSchedule tempo_pins;
+    };
+
+private:
+    std::unique_ptr<Block> loading_block;   // Only touched by the loader thread
+    TalkieLoader talkie_loader;
+    TalkieSocket &talkie_socket;
+    PlayReporting &play_reporting;
+    const double look_ahead_ms;
+    const double coalesce_ms;       // Each block is coalesced on its own, 0 for none
+    std::mutex blocks_mutex;
+    std::condition_variable blocks_condition;
+    std::deque<std::unique_ptr<Block>> loaded_blocks;
+    std::unique_ptr<Block> playing_block;   // Released as soon as the next one is taken
+    std::thread loader_thread;
+    double first_time_ms = 0.0;
+    double handed_time_ms = 0.0;    // Last pin time handed over so far
+    bool any_handed = false;
+    bool finished = false;
+    bool loaded = false;
+    size_t total_unordered = 0;
+    size_t total_underruns = 0;
+    size_t loading_time_ms = 0;
+
+public:
+    TalkieStream(TalkieSocket &talkie_socket, double look_ahead_ms, double coalesce_ms,
+        PlayReporting &play_reporting, bool verbose = false);
+    ~TalkieStream();
+
+    // Use this class as non-copyable and non-movable (it owns the loader thread)
+    TalkieStream(const TalkieStream&) = delete;
+    TalkieStream& operator=(const TalkieStream&) = delete;
+
+    void start(std::function<bool(TalkieLoader&)> load);
+    // Blocks until the look ahead window (or everything) is loaded, false if there is nothing to play
+    bool waitLookAhead();
+    // The next block to be played, waited for if still loading (an underrun), nullptr once all was played,
+    // the previous one is released
+    Block* nextBlock();
+    // Waits for the loading to finish, returns if it succeeded
+    bool join();
+
+    size_t totalUnordered() const { return total_unordered; }
+    size_t totalUnderruns() const { return total_underruns; }
+    size_t loadingTime() const { return loading_time_ms; }
+
+private:
+    void handOver();    // Called by the loader thread
+};
+
+
+#endif // TALKIE_LOADER_HPP
@@ -0,0 +1,61 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_MESSAGE_HPP
+#define TALKIE_MESSAGE_HPP
+
+#include <string>
+#include <cstdint>
+#include <nlohmann/json.hpp>    // Include the JSON library
+
+
+// Serializes Talkie messages straight into a reused buffer, byte for byte as nlohmann's dump()
+// (keys sorted), with "i" set and the checksum patched into the "c" digits of the same buffer.
+// The usual m, f, t, n, v values are written directly, anything else falls back to dump().
+class TalkieMessageWriter {
+private:
+    std::string buffer;
+    size_t checksum_position = 0;   // Of the "c" placeholder digit
+
+public:
+    TalkieMessageWriter() { buffer.reserve(128); }
+
+    // Element message, its own "i" and "c" (if any) are replaced
+    const std::string& write(const nlohmann::json& talkie_message, uint32_t message_id);
+    // Tempo message {"c","f","i":0,"m":set,"n":"bpm_10","v"} from a Json Midi Creator clock
+    const std::string& writeTempo(const nlohmann::json& json_talkie_clock);
+    // The same tempo of a written one with its bpm_10 divided by time_scale, so it beats along a scaled play
+    // (throws nlohmann::json::exception if it isn't a tempo)
+    const std::string& writeTempo(const char* tempo_message, size_t length, double time_scale);
+
+private:
+    void begin();
+    void writeKey(const std::string& key);
+    void writeKey(const char* key, size_t length);
+    void writeValue(const nlohmann::json& value);
+    void writeNumber(uint64_t number);
+    void writeNumber(int64_t number);
+    void writeChecksum();
+    const std::string& finish();
+};
+
+
+// Reads the "m" and "i" numbers of a written message without parsing it, false if any is missing
+bool peekMessage(const char* talkie_message, size_t length, uint32_t &message_code, uint32_t &message_id);
+// The same of the "n" string, pointed in place without its quotes, false if missing or escaped
+bool peekName(const char* talkie_message, size_t length, const char* &name, size_t &name_length);
+
+
+#endif // TALKIE_MESSAGE_HPP
@@ -0,0 +1,113 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_REAL_TIME_HPP
+#define TALKIE_REAL_TIME_HPP
+
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX    // disables the definition of min and max macros.
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <Windows.h>
+#else
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+
+#define REALTIME_DEFAULT_PRIORITY   40      // SCHED_FIFO, below the kernel threaded IRQs (50)
+#define REALTIME_NO_CPU             -1      // The play thread isn't pinned
+#define REALTIME_AUTO_CPU           -2      // Pinned to the last isolated core, or to the last one if none
+#define REALTIME_STACK_PREFAULT_KB  256
+
+
+class TalkieSchedule;
+
+
+// Each step is optional, the defaults are the ones safe to try anywhere
+struct RealTimeOptions {
+    int cpu             = REALTIME_NO_CPU;
+    int priority        = REALTIME_DEFAULT_PRIORITY;    // 0 keeps the normal scheduling
+    bool lock_memory    = false;    // mlockall of the loaded schedules, after pre-faulting them and the stack
+    bool low_latency    = true;     // Linux: holds /dev/cpu_dma_latency at 0, keeping the cores out of deep sleep
+    bool timer_period   = true;     // Windows: timeBeginPeriod(1)
+    bool mmcss          = true;     // Windows: registers the play thread as a "Pro Audio" MMCSS task
+};
+
+
+struct RealTimeStep {
+    std::string name;
+    bool applied;
+    std::string detail;     // What was set, or why it failed
+};
+
+
+// Sets up the thread it's applied from (the play thread) and undoes it once destroyed, so it shall be
+// destroyed by that same thread. Every step is reported, none of them failing stops the playing.
+class TalkieRealTime {
+private:
+    const RealTimeOptions options;
+    const bool verbose;
+    std::vector<RealTimeStep> steps;
+    bool memory_locked = false;
+    // What the thread had before apply(), given back once destroyed
+    bool affinity_saved = false;
+    bool priority_saved = false;
+#ifdef _WIN32
+    DWORD_PTR saved_affinity = 0;
+    int saved_priority = THREAD_PRIORITY_NORMAL;
+    bool timer_period_set = false;
+    HANDLE mmcss_task = nullptr;
+#else
+    cpu_set_t saved_cpus;
+    int saved_policy = SCHED_OTHER;
+    struct sched_param saved_param = { };
+    int latency_fd = -1;    // The request lasts as long as it's kept open
+#endif
+
+public:
+    TalkieRealTime(const RealTimeOptions &options, bool verbose = false) : options(options), verbose(verbose) { }
+    ~TalkieRealTime();
+
+    // Use this class as non-copyable (it owns what it has set up)
+    TalkieRealTime(const TalkieRealTime&) = delete;
+    TalkieRealTime& operator=(const TalkieRealTime&) = delete;
+
+    // The affinity, priority and timer steps, on the calling thread, false if any requested one failed
+    bool apply();
+    // Once loaded, faults in and locks the schedules memory, so plucking them never page faults
+    bool lockMemory(const std::vector<const TalkieSchedule*> &talkie_schedules);
+
+    const std::vector<RealTimeStep>& getSteps() const { return steps; }
+
+private:
+    void addStep(const std::string &name, bool applied, const std::string &detail);
+};
+
+
+// The last isolated (isolcpus) core if any, the last core otherwise
+int chooseRealTimeCpu();
+// The threads created by a pinned one inherit its core (Linux), this gives the calling thread back the
+// cores it had before the pinning, so helper threads never compete with the play thread
+void unpinThread();
+
+
+#endif // TALKIE_REAL_TIME_HPP
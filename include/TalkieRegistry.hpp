@@ -0,0 +1,97 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_REGISTRY_HPP
+#define TALKIE_REGISTRY_HPP
+
+#include <string>
+#include <array>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+
+
+#define TALKIE_NO_DEVICE            0xFFFFFFFFu     // Pins without a device (tempos), sent as broadcast
+#define REGISTRY_CHUNK_DEVICES      64
+#define REGISTRY_MAXIMUM_CHUNKS     1024            // Up to 65536 devices
+#define REGISTRY_NAMED              -1              // Kinds of device kept with the channels
+#define REGISTRY_BROADCAST          -2
+
+
+class TalkieSocket;
+class TalkieDevice;
+
+
+// Owns every device, named, by channel or just a broadcast port (the tempos), and hands out compact ids
+// in the order they were added.
+// Devices never move once added, so an id resolves to its device, name and kind by plain indexing, without
+// any lock, even while another thread adds more. Finding and adding must be serialized by the owner (the socket).
+class TalkieRegistry {
+private:
+    TalkieSocket * const talkie_socket;
+    const bool verbose;
+    // Written whole before its id is published, and never again
+    struct DeviceSlot {
+        std::unique_ptr<TalkieDevice> device;
+        const std::string* name = nullptr;  // Interned key of ids_by_name, nullptr for the not named devices
+        int channel = REGISTRY_NAMED;       // REGISTRY_NAMED or REGISTRY_BROADCAST if not a channel
+    };
+
+    std::unordered_map<std::string, uint32_t> ids_by_name;
+    std::array<uint32_t, 256> ids_by_channel;
+    std::unordered_map<int, uint32_t> ids_by_broadcast_port;
+    size_t total_named = 0;
+    // Chunks of device slots, a chunk is never reallocated
+    std::array<std::unique_ptr<DeviceSlot[]>, REGISTRY_MAXIMUM_CHUNKS> device_chunks;
+    std::atomic<uint32_t> total_devices{0};
+
+public:
+    TalkieRegistry(TalkieSocket * const socket, bool verbose = false);
+    ~TalkieRegistry();
+
+    // Use this class as non-copyable and non-movable (the devices are referenced by address)
+    TalkieRegistry(const TalkieRegistry&) = delete;
+    TalkieRegistry& operator=(const TalkieRegistry&) = delete;
+
+    // Finds or adds the device, TALKIE_NO_DEVICE once the registry is full
+    uint32_t addName(const std::string &name, int target_port);
+    uint32_t addChannel(uint8_t channel, int target_port);
+    // Always sent as broadcast to the port, one device per port
+    uint32_t addBroadcast(int target_port);
+    // TALKIE_NO_DEVICE if not added yet
+    uint32_t findName(const std::string &name) const;
+    uint32_t findChannel(uint8_t channel) const { return ids_by_channel[channel]; }
+
+    // Any id handed out resolves, from any thread
+    TalkieDevice& getDevice(uint32_t device_id) const { return *getSlot(device_id).device; }
+    size_t size() const { return total_devices.load(std::memory_order_acquire); }
+    size_t totalNamed() const { return total_named; }
+
+    bool isNamed(uint32_t device_id) const { return getSlot(device_id).name != nullptr; }
+    bool isChannel(uint32_t device_id) const { return getSlot(device_id).channel >= 0; }
+    bool isBroadcast(uint32_t device_id) const { return getSlot(device_id).channel == REGISTRY_BROADCAST; }
+    const std::string& getName(uint32_t device_id) const { return *getSlot(device_id).name; }
+    uint8_t getChannel(uint32_t device_id) const { return static_cast<uint8_t>(getSlot(device_id).channel); }
+
+private:
+    const DeviceSlot& getSlot(uint32_t device_id) const {
+        return device_chunks[device_id / REGISTRY_CHUNK_DEVICES][device_id % REGISTRY_CHUNK_DEVICES];
+    }
+    uint32_t add(int target_port, const std::string* name, int channel);
+};
+
+
+#endif // TALKIE_REGISTRY_HPP
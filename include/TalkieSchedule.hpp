@@ -0,0 +1,100 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_SCHEDULE_HPP
+#define TALKIE_SCHEDULE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+class TalkieRegistry;
+
+
+#define SCHEDULE_PAGE_BYTES 4096
+
+
+// Flat time line of pins kept as struct-of-arrays, with all the messages in a single arena.
+// It's sorted once before playing and then walked by index, so plucking a pin touches no allocator.
+class TalkieSchedule {
+private:
+    std::vector<double> times_ms;
+    std::vector<uint32_t> device_ids;         // Of the socket registry, TALKIE_NO_DEVICE for tempos
+    std::vector<uint64_t> message_offsets;
+    std::vector<uint32_t> message_lengths;
+    // Owned messages, unless an external arena (like a mapped compiled file) is attached
+    std::string messages_arena;
+    const char* external_arena = nullptr;
+    size_t external_size = 0;
+
+public:
+    TalkieSchedule() { }
+
+    // Explicitly delete copy assignment
+    TalkieSchedule(const TalkieSchedule&) = delete;
+    TalkieSchedule& operator=(const TalkieSchedule&) = delete;
+    // Use this class as non-copyable but movable
+    TalkieSchedule(TalkieSchedule&&) = default;             // Move constructor OK
+    TalkieSchedule& operator=(TalkieSchedule&&) = default;  // Move assignment OK
+
+    void reserve(size_t total_pins, size_t total_bytes = 0);
+    void clear();
+
+    // Copies the message into the owned arena
+    void add(double time_ms, uint32_t device_id, const char* message, size_t length);
+    void add(double time_ms, uint32_t device_id, const std::string& message) {
+        add(time_ms, device_id, message.data(), message.size());
+    }
+    // References messages already present in an arena that outlives the schedule (zero copy)
+    void attachArena(const char* arena, size_t size);
+    void addOffset(double time_ms, uint32_t device_id, uint64_t offset, uint32_t length);
+
+    // Stable sort by time, skipped if already sorted (compiled play lists)
+    void sort();
+    // Appends the k-way merge of already sorted schedules, same time pins keep the schedules order
+    void merge(const std::vector<const TalkieSchedule*> &sorted_schedules);
+    // Of the set messages to the same device and "n" within window_ms of the first one, only the last one
+    // is kept (at its own time), the others are counted as coalesced by their device. The tempos are never
+    // coalesced, as the tempo map holds them all. Sorted schedules only, returns how many were removed
+    size_t coalesce(double window_ms, const TalkieRegistry &talkie_registry);
+
+    size_t size() const { return times_ms.size(); }
+    bool empty() const { return times_ms.empty(); }
+
+    double getTime(size_t pin_i) const { return times_ms[pin_i]; }
+    uint32_t getDeviceId(size_t pin_i) const { return device_ids[pin_i]; }
+    const char* getMessage(size_t pin_i) const { return arena() + message_offsets[pin_i]; }
+    size_t getLength(size_t pin_i) const { return message_lengths[pin_i]; }
+    std::string copyMessage(size_t pin_i) const { return std::string(getMessage(pin_i), getLength(pin_i)); }
+
+    // First pin at or after time_ms, by binary search of the sorted times
+    size_t timePin(double time_ms) const;
+
+    // First pin after pin_i with a different time (same time pins are played as one batch)
+    size_t sameTimeEnd(size_t pin_i) const;
+    size_t largestSameTime() const;
+
+    void pluckTooth(size_t pin_i, const TalkieRegistry &talkie_registry) const;
+
+    // Reads every page of the arrays and of the messages once, so plucking them never faults, returns the bytes
+    size_t prefault() const;
+
+private:
+    const char* arena() const { return external_arena != nullptr ? external_arena : messages_arena.data(); }
+};
+
+
+#endif // TALKIE_SCHEDULE_HPP
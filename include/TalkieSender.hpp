@@ -0,0 +1,139 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_SENDER_HPP
+#define TALKIE_SENDER_HPP
+
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include "TalkieRegistry.hpp"
+
+
+#define SEND_QUEUE_CAPACITY     256     // Messages waiting per device, a power of 2
+#define SEND_MESSAGE_BYTES      256     // Longer messages are queued apart, allocated when pushed
+#define SEND_MAXIMUM_WORKERS    64      // Devices beyond it share the workers
+#define SEND_IDLE_WAIT_MS       10      // Bounds a missed wake up
+#define SEND_DEFAULT_BURST      4       // Messages a rate limited device takes at once after being idle
+
+
+class TalkieSocket;
+
+
+// Single producer (the playing thread) and single consumer (a sender worker) ring of due messages,
+// each one copied in, so it doesn't depend on the schedule it came from
+class TalkieSendQueue {
+public:
+    struct Entry {
+        long long due_ns;       // TalkieCounters clock
+        uint32_t length;
+        char message[SEND_MESSAGE_BYTES];
+        std::string long_message;   // Only for the longer ones
+        const char* data() const { return length > SEND_MESSAGE_BYTES ? long_message.data() : message; }
+    };
+
+private:
+    std::unique_ptr<Entry[]> entries;
+    alignas(64) std::atomic<size_t> head{0};    // Next to be sent, written by the consumer only
+    alignas(64) std::atomic<size_t> tail{0};    // Next to be pushed, written by the producer only
+
+public:
+    TalkieSendQueue() : entries(new Entry[SEND_QUEUE_CAPACITY]) { }
+
+    // Use this class as non-copyable and non-movable (shared by two threads)
+    TalkieSendQueue(const TalkieSendQueue&) = delete;
+    TalkieSendQueue& operator=(const TalkieSendQueue&) = delete;
+
+    // False if full
+    bool push(long long due_ns, const char* message, size_t length);
+    // nullptr if empty
+    const Entry* front() const;
+    void pop() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    bool empty() const { return front() == nullptr; }
+};
+
+
+// Sends the pins of each device from its own queue and worker thread, so a device whose sends block
+// only delays itself and never the playing thread or the other devices. Queued messages older than
+// late_drop_ms when their turn comes are dropped (never if 0). Devices added while playing get their
+// queue (and worker) with their first message, so none is ever sent around them. With a rate limit
+// each device has a token bucket of rate_limit messages per second, up to burst at once, and its
+// messages wait in its queue for a token (deferred), so a small device isn't flooded and the others
+// aren't delayed.
+class TalkieSenders {
+private:
+    struct Worker {
+        const uint32_t first_device;    // Then every SEND_MAXIMUM_WORKERS devices
+        std::thread worker_thread;
+        std::mutex worker_mutex;
+        std::condition_variable worker_condition;
+        std::atomic<bool> sleeping{false};
+        Worker(uint32_t first_device) : first_device(first_device) { }
+    };
+    struct TokenBucket {        // Only touched by the worker of the device
+        double tokens;
+        long long refill_ns;    // TalkieCounters clock of the last refill
+        bool front_deferred;    // The front message was already counted as deferred
+    };
+    struct Lane {               // Of a device, never moved once added
+        TalkieSendQueue send_queue;
+        TokenBucket token_bucket;
+    };
+
+    TalkieSocket &talkie_socket;
+    const long long late_drop_ns;
+    const double tokens_per_ns;     // 0 without rate limit
+    const double burst_tokens;
+    // Chunked by device id as the registry devices, so the workers read them while more are added
+    std::array<std::unique_ptr<std::unique_ptr<Lane>[]>, REGISTRY_MAXIMUM_CHUNKS> lane_chunks;
+    std::atomic<uint32_t> total_lanes{0};
+    std::array<std::unique_ptr<Worker>, SEND_MAXIMUM_WORKERS> workers;
+    size_t total_workers = 0;       // Only touched by the playing thread
+    std::atomic<bool> running{true};
+
+public:
+    TalkieSenders(TalkieSocket &talkie_socket, double late_drop_ms,
+        double rate_limit = 0.0, double burst = SEND_DEFAULT_BURST);
+    // Sends (or drops) whatever is still queued before returning
+    ~TalkieSenders();
+
+    // Use this class as non-copyable and non-movable (it owns the workers)
+    TalkieSenders(const TalkieSenders&) = delete;
+    TalkieSenders& operator=(const TalkieSenders&) = delete;
+
+    // Queues a due message to its device, sending it at once if it can't be queued
+    void send(uint32_t device_id, const char* message, size_t length);
+
+private:
+    Lane& getLane(uint32_t device_id) const {
+        return *lane_chunks[device_id / REGISTRY_CHUNK_DEVICES][device_id % REGISTRY_CHUNK_DEVICES];
+    }
+    // Adds the lanes (and workers) of the devices up to total_devices, by the playing thread only
+    void addLanes(size_t total_devices);
+    void workerLoop(Worker &worker);
+    // Sets ready_ns to when the first rate limited device gets a token, 0 if none is waiting for it
+    bool drainQueues(Worker &worker, long long &ready_ns);
+    bool takeToken(uint32_t device_id, Lane &lane, long long now_ns, long long &ready_ns);
+};
+
+
+#endif // TALKIE_SENDER_HPP
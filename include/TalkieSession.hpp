@@ -0,0 +1,135 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_SESSION_HPP
+#define TALKIE_SESSION_HPP
+
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieCompiled.hpp"
+#include "TalkieTempoMap.hpp"
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+
+
+enum class TransportState {
+    stopped,
+    playing,
+    paused
+};
+
+
+// Keeps the socket, the discovered devices and the timer calibration warm between plays, so each new
+// play list starts with the devices already reached by unicast. The next play list can be loaded from
+// another thread while the current one is playing, start() takes the last one loaded (or plays again).
+// Playing runs on its own real time thread, controlled from any other thread by start, pause, seek and stop,
+// each one interrupting the timer so that even a long sleep ends at once.
+class TalkieSession {
+private:
+    struct SessionList {
+        TalkieSchedule talkie_pins;
+        TalkieSchedule tempo_pins;
+        TalkieTempoMap tempo_map;       // Of the tempo pins, built once loaded
+        double delay_ms = 0.0;          // Of the play time line, changed without reloading
+        PlayReporting play_reporting;   // Of its loading
+        CompiledPlayList compiled;      // Kept mapped while it's played (compiled play lists only)
+    };
+
+    const bool verbose;
+    const PlayOptions play_options;
+    TalkieSocket talkie_socket;
+    TalkieTimer talkie_timer;           // Calibrated once
+    bool socket_ready = false;
+
+    std::mutex lists_mutex;
+    std::unique_ptr<SessionList> loaded_list;   // The next one to be played
+    std::unique_ptr<SessionList> playing_list;  // Only replaced while stopped
+
+    // Requests are made holding the transport_mutex, and the play thread clears the timer interrupt
+    // holding it too, so no request is ever lost
+    std::mutex transport_mutex;
+    std::condition_variable transport_condition;
+    TransportState transport_state = TransportState::stopped;
+    bool stop_requested = false;
+    bool pause_requested = false;
+    double seek_time_ms = NAN;          // Pending seek, NAN if none
+    double position_ms = 0.0;           // Where the playing (re)started, was paused or will start
+    std::chrono::steady_clock::time_point position_clock;   // When the playing (re)started
+    std::thread transport_thread;
+    PlayReporting play_reporting;       // Of the last play
+
+public:
+    TalkieSession(bool verbose = false, const PlayOptions &play_options = PlayOptions());
+    ~TalkieSession();
+
+    // Use this class as non-copyable and non-movable (it owns the socket and its receiver thread)
+    TalkieSession(const TalkieSession&) = delete;
+    TalkieSession& operator=(const TalkieSession&) = delete;
+
+    bool isReady() const { return socket_ready; }
+
+    // Each load replaces the one not yet played, while something else may be playing
+    bool load(const char* json_str, int delay_ms);
+    bool loadBuffer(const char* json_data, size_t json_length, int delay_ms);     // Not NUL terminated
+    bool loadFiles(const std::vector<std::string> &json_paths, int delay_ms);
+    // The delay is added to the one it was compiled with
+    bool loadCompiled(const char* compiled_path, int delay_ms = 0);
+    // Of the play list being played, or of the one start() is going to play, applied from the next start,
+    // resume or seek on (the position remains of the play time line)
+    void setDelay(double delay_ms);
+
+    // Starts playing the last loaded play list from the current position and returns at once,
+    // or resumes it if paused, false if there's nothing to play
+    bool start();
+    void pause();
+    // Moves to time_ms of the play list (its first pin at or after it), the playing goes on from there
+    void seek(double time_ms);
+    // Stops playing and rewinds to the start
+    void stop();
+    // Blocks until the playing ends or is stopped
+    void wait();
+    // Starts and waits, returns 0 as PlayList does
+    int play();
+
+    TransportState getState();
+    bool isPlaying() { return getState() != TransportState::stopped; }
+    // Milliseconds of the play time line, the delay and the time scale included
+    double getPosition();
+
+    // Beats along the tempo map of the play list being played, or of the one start() is going to play
+    void seekBeat(double beat);
+    double getBeat();
+    double getBpm();
+
+    // Statistics of the last play, read them once it has stopped
+    const PlayReporting& getReporting() const { return play_reporting; }
+    std::string getReportJson();
+    // Counters of each device, live while playing
+    std::string getDevicesJson();
+
+private:
+    void commit(std::unique_ptr<SessionList> session_list);
+    // These are called holding the transport_mutex (and currentList the lists_mutex too)
+    double currentPosition() const;
+    SessionList* currentList() const;
+    PlayOptions listOptions(const SessionList &session_list) const;
+    void playTransport();
+};
+
+
+#endif // TALKIE_SESSION_HPP
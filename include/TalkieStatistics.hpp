@@ -0,0 +1,63 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_STATISTICS_HPP
+#define TALKIE_STATISTICS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+#define STATISTICS_MINIMUM_MS           0.001   // The first bucket edge (1 us), below it all goes in bucket 0
+#define STATISTICS_BUCKETS_PER_OCTAVE   16      // Each bucket is about 4.4% wide
+#define STATISTICS_OCTAVES              24      // Up to about 16.8 s, beyond it all goes in the last bucket
+#define STATISTICS_BUCKETS              (1 + STATISTICS_OCTAVES * STATISTICS_BUCKETS_PER_OCTAVE)
+
+
+// Streaming statistics of a series of times (ms), updated as each one happens, so nothing has to be kept
+// for the end. The mean and deviation are exact (Welford), the percentiles come from a fixed logarithmic
+// histogram and are given as the upper edge of their bucket.
+class TalkieStatistics {
+private:
+    size_t total_values = 0;
+    double total_ms     = 0.0;
+    double minimum_ms   = 0.0;
+    double maximum_ms   = 0.0;
+    double mean_ms      = 0.0;
+    double squares_ms   = 0.0;  // Sum of the squared differences from the mean
+    std::array<uint64_t, STATISTICS_BUCKETS> buckets{};
+
+public:
+    void add(double value_ms);
+    void clear() { *this = TalkieStatistics(); }
+
+    size_t count() const { return total_values; }
+    double getTotal() const { return total_ms; }
+    double getMinimum() const { return minimum_ms; }
+    double getMaximum() const { return maximum_ms; }
+    double getMean() const { return mean_ms; }
+    double getDeviation() const;
+    // Value not exceeded by the given fraction (0.5, 0.99, 0.999, ...) of the values
+    double getPercentile(double fraction) const;
+
+    // The histogram, bucket by bucket
+    size_t totalBuckets() const { return buckets.size(); }
+    uint64_t getBucketCount(size_t bucket_i) const { return buckets[bucket_i]; }
+    static double bucketEdge(size_t bucket_i);  // Upper edge (ms)
+};
+
+
+#endif // TALKIE_STATISTICS_HPP
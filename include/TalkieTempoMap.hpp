@@ -0,0 +1,60 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_TEMPO_MAP_HPP
+#define TALKIE_TEMPO_MAP_HPP
+
+#include <vector>
+#include <cstddef>
+
+
+#define TEMPO_DEFAULT_BPM_10    1200    // 120 bpm, when there are no tempos at all
+
+
+class TalkieSchedule;
+
+
+// Piecewise constant tempo segments with the prefix sum of the beats at each segment start, so a
+// position converts between beats and milliseconds with a binary search and a multiplication.
+// The first tempo also stands for the time before it, from time 0.
+class TalkieTempoMap {
+private:
+    std::vector<double> starts_ms;
+    std::vector<double> starts_beat;    // Beats elapsed from time 0 up to each segment start
+    std::vector<double> beats_ms;       // Duration of a beat along each segment
+
+public:
+    TalkieTempoMap() { }
+
+    void clear();
+    // Tempos have to be added in time order, a same time one replaces the previous
+    void add(double time_ms, double bpm_10);
+    // From the "v" (bpm_10) of the sorted tempo pins, any unreadable one is skipped
+    void build(const TalkieSchedule &tempo_pins);
+
+    size_t size() const { return starts_ms.size(); }
+    bool empty() const { return starts_ms.empty(); }
+
+    double beatToMs(double beat) const;
+    double msToBeat(double time_ms) const;
+    // Of the tempo in effect at time_ms
+    double getBpm(double time_ms) const;
+
+private:
+    size_t segmentAtMs(double time_ms) const;
+};
+
+
+#endif // TALKIE_TEMPO_MAP_HPP
@@ -0,0 +1,102 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_TIMER_HPP
+#define TALKIE_TIMER_HPP
+
+#include <string>
+#include <atomic>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX    // disables the definition of min and max macros.
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <Windows.h>
+#else
+    #include <time.h>
+#endif
+
+
+#define TIMER_SPIN_TAIL_NS      1000000LL   // Default spin tail before calibration (1 ms)
+#define TIMER_MINIMUM_TAIL_NS   20000LL
+#define TIMER_MAXIMUM_TAIL_NS   2000000LL
+#define TIMER_CALIBRATION_RUNS  25
+
+
+enum class TimerMode {
+    spin,       // Busy waits all the way, the most accurate and 100% of a CPU
+    hybrid,     // Sleeps to the deadline minus a calibrated tail and then spins
+    sleep       // Only sleeps to the deadline, the lowest CPU use
+};
+
+
+// Waits for absolute deadlines measured from the moment it's started, so the
+// time spent between waits never accumulates as error. Any wait can be interrupted
+// from another thread, even while sleeping.
+class TalkieTimer {
+private:
+    TimerMode timer_mode;
+    long long spin_tail_ns = TIMER_SPIN_TAIL_NS;
+    std::atomic<bool> interrupted{false};
+#ifdef _WIN32
+    LARGE_INTEGER frequency;    // Queried once
+    LARGE_INTEGER epoch;
+    HANDLE waitable_timer = nullptr;
+    HANDLE interrupt_event = nullptr;
+#else
+    struct timespec epoch;
+    int timer_fd = -1;          // Absolute deadlines, polled together with the interrupt
+    int interrupt_fd = -1;
+#endif
+
+public:
+    TalkieTimer(TimerMode mode = TimerMode::hybrid);
+    ~TalkieTimer();
+
+    // Use this class as non-copyable (it owns its waiting handles)
+    TalkieTimer(const TalkieTimer&) = delete;
+    TalkieTimer& operator=(const TalkieTimer&) = delete;
+
+    // Sets the time zero of the deadlines
+    void start();
+    // Nanoseconds elapsed since start()
+    long long now() const;
+    // Returns as close as possible to the given nanoseconds since start(), false if interrupted
+    bool waitUntil(long long deadline_ns);
+    // Measures the host wake up latency to size the hybrid spin tail, returns it
+    long long calibrate();
+
+    // Makes the current and any later wait return false at once, until cleared
+    void interrupt();
+    void clearInterrupt();
+    bool isInterrupted() const { return interrupted.load(std::memory_order_acquire); }
+
+    TimerMode getMode() const { return timer_mode; }
+    long long getSpinTail() const { return spin_tail_ns; }
+
+private:
+    bool sleepUntil(long long deadline_ns);
+    bool spinUntil(long long deadline_ns) const;
+};
+
+
+bool parseTimerMode(const std::string &mode_name, TimerMode &timer_mode);
+const char* timerModeName(TimerMode timer_mode);
+
+
+#endif // TALKIE_TIMER_HPP
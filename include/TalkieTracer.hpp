@@ -0,0 +1,97 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_TRACER_HPP
+#define TALKIE_TRACER_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+
+#define TRACE_RING_EVENTS   65536   // Default capacity, once full the oldest events are overwritten
+
+
+// Runtime enabled tracer of the loading phases and of the real time loop. Events go into a ring buffer
+// preallocated by enable(), so recording one is a clock read and a few stores (and nothing at all while
+// disabled). write() turns them into a Chrome trace, for chrome://tracing or ui.perfetto.dev, once the
+// traced threads are done.
+class TalkieTracer {
+public:
+    struct Event {
+        const char* name;       // Static strings only, they're kept as pointers
+        const char* arg_name;   // nullptr for no argument
+        double arg_value;
+        long long start_ns;
+        long long duration_ns;  // Negative for an instant event
+        uint32_t thread_id;
+    };
+
+private:
+    std::atomic<bool> enabled{false};
+    std::vector<Event> events;
+    std::atomic<uint64_t> total_events{0};
+    long long epoch_ns = 0;
+
+    TalkieTracer() { }
+
+public:
+    static TalkieTracer& instance();
+
+    // Use this class as non-copyable (there's a single one)
+    TalkieTracer(const TalkieTracer&) = delete;
+    TalkieTracer& operator=(const TalkieTracer&) = delete;
+
+    // Allocates the ring buffer, to be called before anything is traced
+    void enable(size_t capacity = TRACE_RING_EVENTS);
+    void disable() { enabled.store(false, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    static long long now();     // Steady clock nanoseconds
+
+    void complete(const char* name, long long start_ns, long long finish_ns,
+        const char* arg_name = nullptr, double arg_value = 0.0);
+    void instant(const char* name, const char* arg_name = nullptr, double arg_value = 0.0);
+
+    // Chrome trace JSON of the events still in the ring buffer
+    bool write(const std::string &trace_path) const;
+    uint64_t totalEvents() const { return total_events.load(std::memory_order_relaxed); }
+
+private:
+    void record(const Event &event);
+};
+
+
+// Traces its own life time as a phase, if the tracer is enabled when it's created
+class TalkieTraceScope {
+private:
+    const char* const name;
+    const long long start_ns;
+
+public:
+    TalkieTraceScope(const char* name)
+        : name(name), start_ns(TalkieTracer::instance().isEnabled() ? TalkieTracer::now() : 0) { }
+    ~TalkieTraceScope() {
+        if (start_ns != 0) TalkieTracer::instance().complete(name, start_ns, TalkieTracer::now());
+    }
+
+    // Use this class as non-copyable
+    TalkieTraceScope(const TalkieTraceScope&) = delete;
+    TalkieTraceScope& operator=(const TalkieTraceScope&) = delete;
+};
+
+
+#endif // TALKIE_TRACER_HPP
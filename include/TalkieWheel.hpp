@@ -0,0 +1,144 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#ifndef TALKIE_WHEEL_HPP
+#define TALKIE_WHEEL_HPP
+
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieLoader.hpp"
+#include "TalkieCompiled.hpp"
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+
+#define WHEEL_TICK_MS       1.0         // Pins of the same tick are handed over together, sorted by time
+#define WHEEL_SLOT_BITS     8
+#define WHEEL_SLOTS         (1 << WHEEL_SLOT_BITS)
+#define WHEEL_LEVELS        3           // About 4.6 hours of ticks, the pins beyond wait in the overflow
+#define WHEEL_FEED_PINS     1024        // Loaded pins added to the wheel at once, same time pins are never split
+#define WHEEL_RELEASE_PINS  16384       // Compiled pins fed between two releases of their pages
+
+
+// Hierarchical timing wheel of pins (not thread safe). Pins are added in any order in O(1) and taken tick
+// by tick in time order, each pin being moved at most once per level on its way down to the first one.
+// Pins added behind the cursor are late, they come first in the next batch taken.
+class TalkieWheel {
+private:
+    // The message is copied in, so it doesn't depend on where it was loaded from
+    struct Slot {
+        double time_ms;
+        uint64_t sequence;      // Same time pins keep their adding order
+        uint32_t device_id;
+        uint32_t length;
+        char message[SEND_MESSAGE_BYTES];
+        std::string long_message;   // Only for the longer ones
+        const char* data() const { return length > SEND_MESSAGE_BYTES ? long_message.data() : message; }
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    std::vector<uint32_t> levels[WHEEL_LEVELS][WHEEL_SLOTS];   // Slot indexes
+    size_t level_pins[WHEEL_LEVELS] = { };
+    std::vector<uint32_t> overflow;
+    std::vector<uint32_t> late;
+    std::vector<uint32_t> cascading;    // Reused by cascade
+    int64_t cursor_tick = 0;            // Next tick to be taken, the ones before it were all taken
+    uint64_t next_sequence = 0;
+    size_t total_pins = 0;
+    size_t total_late = 0;
+    size_t maximum_pins = 0;
+
+public:
+    void add(double time_ms, uint32_t device_id, const char* message, size_t length);
+    // Appends the pins of the next tick with any (the late ones first) that ends up to limit_ms,
+    // false if there are none up to there
+    bool take(double limit_ms, TalkieSchedule &batch);
+
+    size_t size() const { return total_pins; }
+    double cursorMs() const { return static_cast<double>(cursor_tick) * WHEEL_TICK_MS; }
+    size_t totalLate() const { return total_late; }
+    size_t maximumPins() const { return maximum_pins; }
+
+private:
+    static int64_t tickOf(double time_ms);
+    void place(uint32_t slot_i);
+    // Moves down the pins of the higher levels whose slot the cursor just reached
+    void cascade();
+    void append(std::vector<uint32_t> &slot_indexes, TalkieSchedule &batch);
+};
+
+
+// Feeds a timing wheel from a loader thread, never more than ahead_ms past the pins being played, so only that
+// window is ever kept in memory, however long the play list is. The compiled play lists are paged in from their
+// mapping (and their played pages released), the Json content is streamed in by the loader, where pins out of
+// order are still played in time if loaded before their tick is taken.
+class TalkieWheelStream {
+private:
+    TalkieSocket &talkie_socket;
+    PlayReporting &play_reporting;
+    const bool verbose;
+    const double ahead_ms;
+    const double coalesce_ms;       // Each fed block is coalesced on its own, 0 for none
+    std::mutex wheel_mutex;
+    std::condition_variable wheel_condition;
+    TalkieWheel talkie_wheel;
+    TalkieSchedule playing_batch;   // Only touched by the play thread
+    TalkieSchedule feeding_pins;    // Only touched by the loader thread
+    TalkieSchedule feeding_tempos;  // Not played as such, the tempos are pins of their own
+    std::thread loader_thread;
+    double first_ms = 0.0;          // Earliest pin time of the first feed, where the play starts
+    double loaded_ms = 0.0;         // Latest pin time fed so far
+    bool any_fed = false;
+    bool finished = false;
+    bool stopping = false;
+    bool loaded = false;
+    size_t total_underruns = 0;
+    size_t loading_time_ms = 0;
+
+public:
+    TalkieWheelStream(TalkieSocket &talkie_socket, double ahead_ms, double coalesce_ms,
+        PlayReporting &play_reporting, bool verbose = false);
+    ~TalkieWheelStream();
+
+    // Use this class as non-copyable and non-movable (it owns the loader thread)
+    TalkieWheelStream(const TalkieWheelStream&) = delete;
+    TalkieWheelStream& operator=(const TalkieWheelStream&) = delete;
+
+    void start(std::function<bool(TalkieLoader&)> load);
+    // The devices are recreated right away, the compiled play list has to stay open until joined
+    bool start(const CompiledPlayList &compiled);
+    // Blocks until the ahead window (or everything) is fed, false if there is nothing to play
+    bool waitAhead();
+    // The pins of the next tick, waited for if still loading (an underrun), nullptr once all was played
+    TalkieSchedule* nextSchedule();
+    // Lets the loader finish without playing and waits for it, returns if it succeeded
+    bool join();
+
+    size_t totalLate();
+    size_t maximumPins();
+    size_t totalUnderruns() const { return total_underruns; }
+    size_t loadingTime() const { return loading_time_ms; }
+
+private:
+    void run(std::function<bool()> load);
+    // Called by the loader thread, waits while the wheel is ahead_ms ahead of the play, false once joined
+    bool feed();
+};
+
+
+#endif // TALKIE_WHEEL_HPP
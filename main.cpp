@@ -16,9 +16,11 @@ https://github.com/ruiseixasm/JsonTalkiePlayer
 
 // SHALL E INCLUDED FIRST THAN EVERYTHING ELSE !!
 #include "JsonTalkiePlayer.hpp"
+#include "TalkieCompiled.hpp"
+#include "TalkieTracer.hpp"
+#include "TalkieLive.hpp"
 
 #include <fstream>
-#include <sstream>
 
 // Testing program in the project folder
 //   Windows: .\build\Release\JsonTalkiePlayer.exe -v .\windows_exported_lead_sheet_melody_jmp.json
@@ -35,30 +37,102 @@ https://github.com/ruiseixasm/JsonTalkiePlayer
 
 void printUsage(const char *programName) {
     std::cout << "Usage: " << programName << " [options] input_file_1.json [input_file_2.json]\n"
+              << "       " << programName << " [options] --live PORT\n"
               << "Options:\n"
               << "  -h, --help       Show this help message and exit\n"
               << "  -d, --delay MS   Sets a delay in milliseconds\n"
+              << "  -s, --time-scale X  Scales the time line when playing, 2 plays at half the speed\n"
+              << "  -c, --compile F  Compiles the input files into the binary play list F instead of playing them\n"
+              << "  -t, --timer MODE Timing engine: spin, hybrid (default) or sleep\n"
+              << "  -P, --policy MODE  What late pins do to the later ones: strict-grid, slew or legacy-drag (default)\n"
+              << "  -w, --slew-rate PCT  Percent of the time between pins the slew policy catches up (default 5)\n"
+              << "  -n, --no-batch   Sends same time pins one by one instead of in a single batch\n"
+              << "  -q, --queues     Sends each device from its own queue, so a slow one delays no other\n"
+              << "  -L, --late-drop MS  Drops the queued pins that are later than MS milliseconds\n"
+              << "  -l, --look-ahead S  Starts playing a time ordered file once its first S seconds of play are loaded\n"
+              << "  -W, --wheel S    Keeps only the next S seconds of play in memory, in a timing wheel fed from the\n"
+              << "                   file (or compiled play list) while playing, pins out of order within S included\n"
+              << "  -r, --report F   Writes the play statistics as JSON into the file F\n"
+              << "  -D, --discovery S  Waits up to S seconds for the devices to answer before playing\n"
+              << "  -a, --address-cache F  Keeps the discovered addresses in the file F for the next start\n"
+              << "  -C, --cache DIR  Keeps the played files compiled in DIR, replaying them without parsing\n"
+              << "  -S, --cache-size MB  Size cap of the cache directory, the least recently used are evicted\n"
+              << "  -p, --port N     Port the player listens on and broadcasts the tempos to (default 5005)\n"
+              << "  -I, --interfaces LIST  One socket per interface, \"all\" or a comma list of names or IPs,\n"
+              << "                   each broadcasting to its own subnet\n"
+              << "  -A, --affinity CPU  Pins the play thread to the core CPU, or to an isolated one with auto\n"
+              << "  -R, --rt-priority N  Real time priority of the play thread (default 40, 0 keeps the normal one)\n"
+              << "  -M, --lock-memory  Pre-faults and locks the loaded schedules in memory before playing\n"
+              << "  -k, --reliable   Sends again the run messages the devices don't echo, until echoed or lost\n"
+              << "  -K, --ack-timeout MS  Waits MS milliseconds for an echo before sending again (default 30)\n"
+              << "  -B, --ack-budget MS  Gives up a message MS milliseconds after its first send (default 200)\n"
+              << "  -m, --coalesce MS  Keeps only the last of the set messages to a device and name within MS ms\n"
+              << "  -Q, --rate-limit N  Sends at most N messages per second to each device, deferring the others\n"
+              << "  -b, --rate-burst N  Messages an idle rate limited device takes at once (default 4)\n"
+              << "  -Z, --live PORT  Plays the time stamped batches received on PORT (TCP and UDP) as they arrive,\n"
+              << "                   until a client sends \"stop\"\n"
+              << "  -T, --trace F    Traces the loading and playing into the Chrome trace file F\n"
               << "  -v, --verbose    Enable verbose mode\n"
               << "  -V, --version    Prints the current version number\n\n"
               << "More info here: https://github.com/ruiseixasm/JsonTalkiePlayer\n\n";
 }
 
+// Writes the trace, if any, once the playing or compiling is done
+static int writeTrace(int result, const char* trace_path) {
+    if (trace_path != nullptr) {
+        TalkieTracer::instance().write(trace_path);
+    }
+    return result;
+}
+
 int main(int argc, char *argv[]) {
 
     int verbose = 0;
     int delay_ms = 0;  // Default delay value
+    const char* compiled_path = nullptr;
+    const char* trace_path = nullptr;
+    int live_port = 0;      // No live mode
+    PlayOptions play_options;
     int option_index = 0;
 
     struct option long_options[] = {
         {"help",    no_argument,       nullptr, 'h'},
         {"delay",   required_argument, nullptr, 'd'},
+        {"time-scale", required_argument, nullptr, 's'},
+        {"compile", required_argument, nullptr, 'c'},
+        {"timer",   required_argument, nullptr, 't'},
+        {"policy",  required_argument, nullptr, 'P'},
+        {"slew-rate", required_argument, nullptr, 'w'},
+        {"no-batch", no_argument,      nullptr, 'n'},
+        {"queues",  no_argument,       nullptr, 'q'},
+        {"late-drop", required_argument, nullptr, 'L'},
+        {"look-ahead", required_argument, nullptr, 'l'},
+        {"wheel",   required_argument, nullptr, 'W'},
+        {"report",  required_argument, nullptr, 'r'},
+        {"discovery", required_argument, nullptr, 'D'},
+        {"address-cache", required_argument, nullptr, 'a'},
+        {"cache",   required_argument, nullptr, 'C'},
+        {"cache-size", required_argument, nullptr, 'S'},
+        {"port",    required_argument, nullptr, 'p'},
+        {"interfaces", required_argument, nullptr, 'I'},
+        {"affinity", required_argument, nullptr, 'A'},
+        {"rt-priority", required_argument, nullptr, 'R'},
+        {"lock-memory", no_argument,   nullptr, 'M'},
+        {"reliable", no_argument,      nullptr, 'k'},
+        {"ack-timeout", required_argument, nullptr, 'K'},
+        {"ack-budget", required_argument, nullptr, 'B'},
+        {"coalesce", required_argument, nullptr, 'm'},
+        {"rate-limit", required_argument, nullptr, 'Q'},
+        {"rate-burst", required_argument, nullptr, 'b'},
+        {"live",    required_argument, nullptr, 'Z'},
+        {"trace",   required_argument, nullptr, 'T'},
         {"verbose", no_argument,       nullptr, 'v'},
         {"version", no_argument,       nullptr, 'V'}, // New option for version
         {nullptr,   0,                 nullptr,  0 }
     };
 
     while (true) {
-        int c = getopt_long(argc, argv, "hd:vV", long_options, &option_index);
+        int c = getopt_long(argc, argv, "hd:s:c:t:P:w:nqL:l:W:r:D:a:C:S:p:I:A:R:MkK:B:m:Q:b:Z:T:vV", long_options, &option_index);
         if (c == -1) break;
 
         switch (c) {
@@ -77,6 +151,229 @@ int main(int argc, char *argv[]) {
                     return 1;
                 }
                 break;
+            case 's':
+                try {
+                    play_options.time_scale = std::stod(optarg);
+                    if (!(play_options.time_scale > 0)) {
+                        std::cerr << "Error: Time scale must be a positive number" << std::endl;
+                        return 1;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid time scale '" << optarg << "'. Must be a number." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'c':
+                compiled_path = optarg;
+                break;
+            case 't':
+                if (!parseTimerMode(optarg, play_options.timer_mode)) {
+                    std::cerr << "Error: Invalid timer mode '" << optarg << "'. Must be spin, hybrid or sleep." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'P':
+                if (!parseSchedulePolicy(optarg, play_options.schedule_policy)) {
+                    std::cerr << "Error: Invalid policy '" << optarg << "'. Must be strict-grid, slew or legacy-drag." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'w':
+                try {
+                    const double slew_percent = std::stod(optarg);
+                    if (slew_percent <= 0 || slew_percent > 100) {
+                        std::cerr << "Error: Slew rate must be above 0 and up to 100 percent" << std::endl;
+                        return 1;
+                    }
+                    play_options.slew_rate = slew_percent / 100;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid slew rate '" << optarg << "'. Must be a percentage." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'n':
+                play_options.batch_sends = false;
+                break;
+            case 'q':
+                play_options.device_queues = true;
+                break;
+            case 'L':
+                try {
+                    play_options.late_drop_ms = std::stod(optarg);
+                    if (play_options.late_drop_ms < 0) {
+                        std::cerr << "Error: Late drop must be a non-negative number of milliseconds" << std::endl;
+                        return 1;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid late drop value '" << optarg << "'. Must be a number of milliseconds." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'l':
+                try {
+                    play_options.look_ahead_s = std::stod(optarg);
+                    if (play_options.look_ahead_s < 0) {
+                        std::cerr << "Error: Look ahead must be a non-negative number of seconds" << std::endl;
+                        return 1;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid look ahead value '" << optarg << "'. Must be a number of seconds." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'W':
+                try {
+                    play_options.wheel_ahead_s = std::stod(optarg);
+                    if (play_options.wheel_ahead_s < 0) {
+                        std::cerr << "Error: Wheel window must be a non-negative number of seconds" << std::endl;
+                        return 1;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid wheel window '" << optarg << "'. Must be a number of seconds." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'r':
+                play_options.report_path = optarg;
+                break;
+            case 'D':
+                try {
+                    play_options.discovery_s = std::stod(optarg);
+                    if (play_options.discovery_s < 0) {
+                        std::cerr << "Error: Discovery must be a non-negative number of seconds" << std::endl;
+                        return 1;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid discovery value '" << optarg << "'. Must be a number of seconds." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'a':
+                play_options.address_cache = optarg;
+                break;
+            case 'C':
+                play_options.cache_dir = optarg;
+                break;
+            case 'S':
+                try {
+                    const int cache_mb = std::stoi(optarg);
+                    if (cache_mb < 1) {
+                        std::cerr << "Error: Cache size must be a positive number of megabytes" << std::endl;
+                        return 1;
+                    }
+                    play_options.cache_mb = static_cast<size_t>(cache_mb);
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid cache size '" << optarg << "'. Must be a number of megabytes." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'p':
+                try {
+                    const int talkie_port = std::stoi(optarg);
+                    if (talkie_port < 1 || talkie_port > 65535) {
+                        std::cerr << "Error: Port must be between 1 and 65535" << std::endl;
+                        return 1;
+                    }
+                    play_options.talkie_port = talkie_port;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid port '" << optarg << "'. Must be a number." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'I':
+                play_options.interfaces = optarg;
+                break;
+            case 'A':
+                try {
+                    if (std::string(optarg) == "auto") {
+                        play_options.realtime.cpu = REALTIME_AUTO_CPU;
+                    } else {
+                        const int cpu = std::stoi(optarg);
+                        if (cpu < 0) {
+                            std::cerr << "Error: The core must be 0 or above" << std::endl;
+                            return 1;
+                        }
+                        play_options.realtime.cpu = cpu;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid core '" << optarg << "'. Must be a number or auto." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'R':
+                try {
+                    const int priority = std::stoi(optarg);
+                    if (priority < 0 || priority > 99) {
+                        std::cerr << "Error: Real time priority must be between 0 and 99" << std::endl;
+                        return 1;
+                    }
+                    play_options.realtime.priority = priority;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid real time priority '" << optarg << "'. Must be a number." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'M':
+                play_options.realtime.lock_memory = true;
+                break;
+            case 'k':
+                play_options.reliable_runs = true;
+                break;
+            case 'K':
+            case 'B':
+                try {
+                    const double ack_ms = std::stod(optarg);
+                    if (ack_ms <= 0) {
+                        std::cerr << "Error: Acknowledgement times must be a positive number of milliseconds" << std::endl;
+                        return 1;
+                    }
+                    (c == 'K' ? play_options.ack_timeout_ms : play_options.ack_budget_ms) = ack_ms;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid acknowledgement time '" << optarg << "'. Must be a number of milliseconds." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'm':
+                try {
+                    play_options.coalesce_ms = std::stod(optarg);
+                    if (play_options.coalesce_ms < 0) {
+                        std::cerr << "Error: Coalesce window must be a non-negative number of milliseconds" << std::endl;
+                        return 1;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid coalesce window '" << optarg << "'. Must be a number of milliseconds." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'Q':
+            case 'b':
+                try {
+                    const double rate = std::stod(optarg);
+                    if (c == 'Q' ? rate < 0 : rate < 1) {
+                        std::cerr << "Error: Rate limit must be a non-negative and its burst at least 1 message" << std::endl;
+                        return 1;
+                    }
+                    (c == 'Q' ? play_options.rate_limit : play_options.rate_burst) = rate;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid rate '" << optarg << "'. Must be a number of messages." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'Z':
+                try {
+                    live_port = std::stoi(optarg);
+                    if (live_port < 1 || live_port > 65535) {
+                        std::cerr << "Error: Live port must be between 1 and 65535" << std::endl;
+                        return 1;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid live port '" << optarg << "'. Must be a number." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'T':
+                trace_path = optarg;
+                break;
             case 'v':
                 verbose = 1;
                 break;
@@ -91,33 +388,61 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (trace_path != nullptr) {
+        TalkieTracer::instance().enable();
+    }
+
+    // The batches come from the live port, so no input files
+    if (live_port > 0) {
+        if (live_port == play_options.talkie_port) {
+            std::cerr << "Error: The live port must differ from the Talkie port" << std::endl;
+            return 1;
+        }
+        TalkieLive talkie_live(live_port, verbose, play_options);
+        if (!talkie_live.start()) {
+            return writeTrace(1, trace_path);
+        }
+        talkie_live.wait();
+        return writeTrace(0, trace_path);
+    }
+
     if (optind + 1 > argc) {    // optind points to the first non-option argument (at least 1 file)
         std::cerr << "Error: Missing input file(s)\n";
         printUsage(argv[0]);
         return 1;
     }
 
-    int read_files = 0;
-    std::stringstream json_files_buffer;
-    json_files_buffer << "[";
+    // A compiled play list is already sorted and encoded, so it can only be played alone
+    if (optind + 1 == argc && isCompiledFile(argv[optind])) {
+        if (compiled_path != nullptr) {
+            std::cerr << "Error: The input file is already compiled" << std::endl;
+            return 1;
+        }
+        play_options.delay_ms = delay_ms;   // Added to the one it was compiled with
+        return writeTrace(PlayCompiled(argv[optind], verbose, play_options), trace_path);
+    }
+
+    // The files are memory mapped and parsed in place, never copied whole into memory
+    std::vector<std::string> json_paths;
     for (size_t filename_position = optind; filename_position < argc; filename_position++) {
 
         const char* filename = argv[filename_position];
+        if (isCompiledFile(filename)) {
+            std::cerr << "Compiled files can't be mixed with other files: " << filename << std::endl;
+            continue;
+        }
         std::ifstream json_file(filename);
         if (!json_file.is_open()) {
             std::cerr << "Could not open the file: " << filename << std::endl;
             continue;
         }
-        read_files++;
-        json_files_buffer << json_file.rdbuf() << ",";
         json_file.close();
+        json_paths.push_back(filename);
     }
-    if (read_files == 0)
+    if (json_paths.empty())
         return 1;
-    
-    std::string json_files_list = json_files_buffer.str();
-    // Replace last "," with a "]"
-    json_files_list.back() = ']';
 
-    return PlayList(json_files_list.c_str(), delay_ms, verbose);
+    if (compiled_path != nullptr)
+        return writeTrace(CompileFiles(json_paths, delay_ms, compiled_path, verbose), trace_path);
+    return writeTrace(PlayFiles(json_paths, delay_ms, verbose, play_options), trace_path);
 }
@@ -14,6 +14,15 @@ https://github.com/ruiseixasm/JsonMidiCreator
 https://github.com/ruiseixasm/JsonTalkiePlayer
 */
 #include "JsonTalkiePlayer.hpp"
+#include "TalkieCompiled.hpp"
+#include "TalkieChecksum.hpp"
+#include "TalkieMessage.hpp"
+#include "TalkieLoader.hpp"
+#include "TalkieTracer.hpp"
+#include "TalkieSender.hpp"
+#include "TalkieWheel.hpp"
+
+#include <fstream>
 
 
 
@@ -26,68 +35,6 @@ double get_time_ms(int minutes_numerator, int minutes_denominator) {
 }
 
 
-static uint32_t message_id(const double time_milliseconds) {
-    return static_cast<uint32_t>(time_milliseconds);
-}
-
-
-static std::string encode(const nlohmann::json& message) {
-    return message.dump(); // Convert JSON to string
-}
-
-
-static uint16_t calculate_checksum(const std::string& data) {
-    uint16_t checksum = 0;
-    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.c_str());
-    size_t len = data.length();
-    if (len < 256) {    // JsonTalkie Arduino library is programmed to handle just up to 128 bytes
-        uint8_t data_bytes[256] = {0};
-        size_t data_bytes_i = 0;
-        
-        // ASCII byte values:
-        // 	'c' = 99
-        // 	':' = 58
-        // 	'"' = 34
-        // 	'0' = 48
-        // 	'9' = 57
-
-        // Has to be pre processed (linearly)
-        bool at_c0 = false;
-        for (size_t i = 0; i < len; ++i) {
-            if (!at_c0 && i > 3 && bytes[i - 3] == 'c' && bytes[i - 1] == ':' && bytes[i - 4] == '"' && bytes[i - 2] == '"') {
-                at_c0 = true;
-                data_bytes[data_bytes_i++] = '0';
-                continue;
-            } else if (at_c0) {
-                if (bytes[i] < '0' || bytes[i] > '9') {
-                    at_c0 = false;
-                } else {
-                    continue;
-                }
-            }
-            data_bytes[data_bytes_i] = bytes[i];
-            data_bytes_i++;
-        }
-        len = data_bytes_i;
-        // std::cout << "Final message: " << data_bytes << std::endl;
-
-        uint16_t chunk = 0;
-
-        for (size_t i = 0; i < len; i += 2) {
-            // Combine two data_bytes into 16-bit value
-            chunk = data_bytes[i] << 8;
-            if (i + 1 < len) {
-                chunk |= data_bytes[i + 1];
-            }
-            checksum ^= chunk;
-        }
-    }
-    return checksum & 0xFFFF;
-}
-
-
-
-
 bool TalkieSocket::initialize() {
     if (socket_initialized) {
         return true;
@@ -103,16 +50,59 @@ bool TalkieSocket::initialize() {
     }
 #endif
 
+    endpoints.clear();
+    if (interface_selection.empty()) {
+        // ONE socket for everything, it also receives the broadcast echoes
+        TalkieEndpoint endpoint;
+        endpoint.name = "any";
+        endpoint.address.s_addr = INADDR_ANY;
+        endpoint.netmask.s_addr = INADDR_ANY;
+        endpoint.broadcast.s_addr = INADDR_BROADCAST;
+        endpoints.push_back(endpoint);
+    } else {
+        // One socket per interface, broadcasting to its own subnet instead of the limited broadcast
+        // that only leaves through the interface of the default route
+        std::vector<TalkieInterface> selected_interfaces;
+        if (!selectInterfaces(interface_selection, selected_interfaces, verbose)) {
+#ifdef _WIN32
+            WSACleanup();
+#endif
+            return false;
+        }
+        for (const TalkieInterface &talkie_interface : selected_interfaces) {
+            TalkieEndpoint endpoint;
+            endpoint.name = talkie_interface.name;
+            endpoint.address = talkie_interface.address;
+            endpoint.netmask = talkie_interface.netmask;
+            endpoint.broadcast = talkie_interface.broadcast;
+            endpoints.push_back(endpoint);
+        }
+    }
+
+    for (TalkieEndpoint &endpoint : endpoints) {
+        if (!openEndpoint(endpoint)) {
+            socket_initialized = true;  // So that the already opened ones are closed
+            closeSocket();
+            return false;
+        }
+    }
+
+    socket_initialized = true;
+    if (verbose) std::cout << "Socket initialized successfully" << std::endl;
+    return true;
+}
+
+
+bool TalkieSocket::openEndpoint(TalkieEndpoint &endpoint) {
     // Create socket with error checking
-    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    endpoint.sockfd = socket(AF_INET, SOCK_DGRAM, 0);
 #ifdef _WIN32
-    if (sockfd == INVALID_SOCKET) {
+    if (endpoint.sockfd == INVALID_SOCKET) {
         std::cerr << "Failed to create socket. Error: " << WSAGetLastError() << std::endl;
-        WSACleanup();  // Clean up Winsock
         return false;
     }
 #else
-    if (sockfd < 0) {
+    if (endpoint.sockfd < 0) {
         std::cerr << "Failed to create socket. Error: " << strerror(errno) << std::endl;
         return false;
     }
@@ -120,47 +110,48 @@ bool TalkieSocket::initialize() {
 
     // Enable broadcast with error checking
     int broadcast = 1;
-    if (setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, (char*)&broadcast, sizeof(broadcast)) < 0) {
+    if (setsockopt(endpoint.sockfd, SOL_SOCKET, SO_BROADCAST, (char*)&broadcast, sizeof(broadcast)) < 0) {
         std::cerr << "Failed to enable broadcast: ";
 #ifdef _WIN32
         std::cerr << WSAGetLastError() << std::endl;
-        closesocket(sockfd);
-        WSACleanup();
 #else
         std::cerr << strerror(errno) << std::endl;
-        close(sockfd);
 #endif
-        sockfd = -1;
         return false;
     }
 
     // Bind with error checking
     sockaddr_in local_addr{};
     local_addr.sin_family = AF_INET;
-    local_addr.sin_addr.s_addr = INADDR_ANY;
-    local_addr.sin_port = htons(5005);  // Default port
+    local_addr.sin_addr = endpoint.address;
+    local_addr.sin_port = htons(talkie_port);
     
-    if (bind(sockfd, (sockaddr*)&local_addr, sizeof(local_addr)) < 0) {
-        std::cerr << "Socket initialization failed, unable to bind: ";
+    if (bind(endpoint.sockfd, (sockaddr*)&local_addr, sizeof(local_addr)) < 0) {
+        std::cerr << "Socket initialization failed, unable to bind " << endpoint.name << ": ";
 #ifdef _WIN32
         std::cerr << WSAGetLastError() << std::endl;
-        closesocket(sockfd);
-        WSACleanup();
 #else
         std::cerr << strerror(errno) << std::endl;
-        close(sockfd);
 #endif
-        sockfd = -1;
         return false;
     }
 
-    socket_initialized = true;
-    if (verbose) std::cout << "Socket initialized successfully" << std::endl;
+    if (verbose && endpoints.size() > 1) std::cout << "Socket bound to " << endpoint.name << std::endl;
     return true;
 }
 
 
-bool TalkieSocket::sendToDevice(const std::string& ip, int port, const std::string& message) {
+uint32_t TalkieSocket::routeTo(const in_addr& address) const {
+    for (uint32_t endpoint_i = 0; endpoint_i < endpoints.size(); ++endpoint_i) {
+        const TalkieEndpoint &endpoint = endpoints[endpoint_i];
+        if ((address.s_addr & endpoint.netmask.s_addr) == (endpoint.address.s_addr & endpoint.netmask.s_addr))
+            return endpoint_i;
+    }
+    return 0;
+}
+
+
+bool TalkieSocket::sendToDevice(const std::string& ip, int port, const char* message, size_t length) {
     if (!socket_initialized) {
         return false;
     }
@@ -170,7 +161,7 @@ bool TalkieSocket::sendToDevice(const std::string& ip, int port, const std::stri
     target.sin_port = htons(port);
     inet_pton(AF_INET, ip.c_str(), &target.sin_addr);
     
-    sendto(sockfd, message.c_str(), message.length(), 0,
+    sendto(endpoints[routeTo(target.sin_addr)].sockfd, message, length, 0,
             (sockaddr*)&target, sizeof(target));
     
     // if (verbose) std::cout << "Message: " << message << " sent to " << ip << ":" << port << std::endl;
@@ -179,7 +170,17 @@ bool TalkieSocket::sendToDevice(const std::string& ip, int port, const std::stri
 }
 
 
-bool TalkieSocket::sendBroadcast(int port, const std::string& message) {
+bool TalkieSocket::sendTo(const sockaddr_in& target, const char* message, size_t length, uint32_t endpoint_i) {
+    if (!socket_initialized) {
+        return false;
+    }
+
+    return sendto(endpoints[endpoint_i].sockfd, message, length, 0,
+            (const sockaddr*)&target, sizeof(target)) >= 0;
+}
+
+
+bool TalkieSocket::sendBroadcast(int port, const char* message, size_t length) {
     if (!socket_initialized) {
         return false;
     }
@@ -187,31 +188,108 @@ bool TalkieSocket::sendBroadcast(int port, const std::string& message) {
     sockaddr_in broadcast_addr{};
     broadcast_addr.sin_family = AF_INET;
     broadcast_addr.sin_port = htons(port);
-    broadcast_addr.sin_addr.s_addr = INADDR_BROADCAST;
     
-    sendto(sockfd, message.c_str(), message.length(), 0,
-            (sockaddr*)&broadcast_addr, sizeof(broadcast_addr));
+    bool sent = false;
+    for (const TalkieEndpoint &endpoint : endpoints) {
+        broadcast_addr.sin_addr = endpoint.broadcast;
+        if (sendto(endpoint.sockfd, message, length, 0,
+                (sockaddr*)&broadcast_addr, sizeof(broadcast_addr)) >= 0)
+            sent = true;
+    }
     
     // if (verbose) std::cout << "Message: " << message << " broadcasted to port " << port << std::endl;
 
-    return true;
+    return sent;
+}
+
+
+size_t TalkieSocket::sendDatagrams(const TalkieDatagram* datagrams, size_t total_datagrams) {
+    if (!socket_initialized) {
+        return 0;
+    }
+
+    size_t sent_datagrams = 0;
+
+#ifdef __linux__
+    // Linux: all the datagrams of a batch leave the process in one sendmmsg call per endpoint
+    constexpr size_t max_batch = 64;
+    struct mmsghdr messages[max_batch];
+    struct iovec vectors[max_batch];
+    sockaddr_in targets[max_batch];                 // Broadcasts get the address of the endpoint subnet
+    const TalkieDatagram* batched[max_batch];
+    
+    for (uint32_t endpoint_i = 0; endpoint_i < endpoints.size(); ++endpoint_i) {
+        const TalkieEndpoint &endpoint = endpoints[endpoint_i];
+        size_t datagram_i = 0;
+        while (datagram_i < total_datagrams) {
+            size_t batch_size = 0;
+            for (; datagram_i < total_datagrams && batch_size < max_batch; ++datagram_i) {
+                const TalkieDatagram &datagram = datagrams[datagram_i];
+                if (datagram.unicast && datagram.endpoint_i != endpoint_i) {
+                    continue;
+                }
+                targets[batch_size] = datagram.target;
+                if (!datagram.unicast)
+                    targets[batch_size].sin_addr = endpoint.broadcast;
+                vectors[batch_size].iov_base = const_cast<char*>(datagram.message);
+                vectors[batch_size].iov_len = datagram.length;
+                messages[batch_size].msg_hdr = {};
+                messages[batch_size].msg_hdr.msg_name = &targets[batch_size];
+                messages[batch_size].msg_hdr.msg_namelen = sizeof(targets[batch_size]);
+                messages[batch_size].msg_hdr.msg_iov = &vectors[batch_size];
+                messages[batch_size].msg_hdr.msg_iovlen = 1;
+                batched[batch_size++] = &datagram;
+            }
+            size_t batch_sent = 0;
+            while (batch_sent < batch_size) {
+                const long long send_start_ns = TalkieCounters::clockNs();
+                int sent = sendmmsg(endpoint.sockfd, messages + batch_sent,
+                    static_cast<unsigned int>(batch_size - batch_sent), 0);
+                const long long send_finish_ns = TalkieCounters::clockNs();
+                if (sent <= 0) {
+                    // The datagram that failed is skipped so a bad target can't hold the others back
+                    batched[batch_sent]->counters->countSend(batched[batch_sent]->unicast, false, send_start_ns, send_finish_ns);
+                    batch_sent++;
+                    continue;
+                }
+                // Each device is charged the whole call, it's what delayed its message
+                for (int sent_i = 0; sent_i < sent; ++sent_i) {
+                    const TalkieDatagram &datagram = *batched[batch_sent + sent_i];
+                    datagram.counters->countSend(datagram.unicast, true, send_start_ns, send_finish_ns);
+                }
+                batch_sent += static_cast<size_t>(sent);
+                sent_datagrams += static_cast<size_t>(sent);
+            }
+        }
+    }
+#else
+    // Windows: there's no batched send for UDP, so the loop is kept as tight as possible
+    for (size_t datagram_i = 0; datagram_i < total_datagrams; ++datagram_i) {
+        const TalkieDatagram &datagram = datagrams[datagram_i];
+        sockaddr_in target = datagram.target;
+        for (uint32_t endpoint_i = 0; endpoint_i < endpoints.size(); ++endpoint_i) {
+            if (datagram.unicast && datagram.endpoint_i != endpoint_i) {
+                continue;
+            }
+            if (!datagram.unicast)
+                target.sin_addr = endpoints[endpoint_i].broadcast;
+            const long long send_start_ns = TalkieCounters::clockNs();
+            const bool sent = sendto(endpoints[endpoint_i].sockfd, datagram.message, static_cast<int>(datagram.length), 0,
+                    (const sockaddr*)&target, sizeof(target)) >= 0;
+            datagram.counters->countSend(datagram.unicast, sent, send_start_ns, TalkieCounters::clockNs());
+            if (sent) sent_datagrams++;
+        }
+    }
+#endif
+
+    return sent_datagrams;
 }
 
 
 bool TalkieSocket::broadcastTempo(const nlohmann::json &json_talkie_clock) {
 
     try {
-        nlohmann::json broadcast_tempo = {
-            {"m", MessageCode::set},            // message type
-            {"f", json_talkie_clock["f"]},      // from
-            {"i", 0},                           // ID
-            {"c", 0},                           // checksum
-            {"n", "bpm_10"},                    // parameter name
-            {"v", json_talkie_clock["bpm_10"]}  // parameter value
-        };
-
-        broadcast_tempo["c"] = calculate_checksum(encode(broadcast_tempo));
-        this->sendBroadcast(5005, encode(broadcast_tempo));
+        this->sendBroadcast(talkie_port, tempo_writer.writeTempo(json_talkie_clock));
 
     } catch (const std::exception& e) {
 
@@ -223,65 +301,91 @@ bool TalkieSocket::broadcastTempo(const nlohmann::json &json_talkie_clock) {
 }
 
 
-bool TalkieSocket::hasMessages() {
-    if (!socket_initialized || sockfd == -1) {
+uint32_t TalkieSocket::getDeviceId(const nlohmann::json &target, int target_port) {
+    if (target.is_string()) {
+        return getDeviceId(target.get_ref<const std::string&>(), target_port);
+    } else if (target.is_number()) {
+        return getDeviceId(target.get<uint8_t>(), target_port);
+    }
+    return TALKIE_NO_DEVICE;
+}
+
+
+uint32_t TalkieSocket::getDeviceId(const std::string &name, int target_port) {
+    std::lock_guard<std::mutex> lock(devices_mutex);
+    return talkie_registry.addName(name, target_port);
+}
+
+
+uint32_t TalkieSocket::getDeviceId(uint8_t channel, int target_port) {
+    std::lock_guard<std::mutex> lock(devices_mutex);
+    return talkie_registry.addChannel(channel, target_port);
+}
+
+
+uint32_t TalkieSocket::getBroadcastId(int target_port) {
+    std::lock_guard<std::mutex> lock(devices_mutex);
+    return talkie_registry.addBroadcast(target_port);
+}
+
+
+bool TalkieSocket::hasMessages(long timeout_us) {
+    if (!socket_initialized || endpoints.empty()) {
         std::cout << "DEBUG: Socket not initialized or invalid" << std::endl;
         return false;
     }
+    return readyEndpoint(timeout_us) >= 0;
+}
 
-    // sockaddr_in bound_addr{};
-    // socklen_t len = sizeof(bound_addr);
-    // getsockname(sockfd, (sockaddr*)&bound_addr, &len);
-    // std::cout << "DEBUG: Socket actually bound to port: " << ntohs(bound_addr.sin_port) << std::endl;
 
+int TalkieSocket::readyEndpoint(long timeout_us) {
     fd_set readfds;
     FD_ZERO(&readfds);
-    FD_SET(sockfd, &readfds);
+    int highest_fd = 0;
+    for (const TalkieEndpoint &endpoint : endpoints) {
+        FD_SET(endpoint.sockfd, &readfds);
+        highest_fd = std::max(highest_fd, static_cast<int>(endpoint.sockfd));
+    }
 
     struct timeval timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0;
+    timeout.tv_sec = timeout_us / 1000000;
+    timeout.tv_usec = timeout_us % 1000000;
 
 #ifdef _WIN32
     int result = select(0, &readfds, nullptr, nullptr, &timeout);
 #else
-    int result = select(sockfd + 1, &readfds, nullptr, nullptr, &timeout);
+    int result = select(highest_fd + 1, &readfds, nullptr, nullptr, &timeout);
 #endif
 
-    // std::cout << "DEBUG: select() returned: " << result << std::endl;
-    
-    if (result > 0 && FD_ISSET(sockfd, &readfds)) {
-        // std::cout << "DEBUG: Data available on socket!" << std::endl;
-        return true;
+    if (result > 0) {
+        for (size_t endpoint_i = 0; endpoint_i < endpoints.size(); ++endpoint_i) {
+            if (FD_ISSET(endpoints[endpoint_i].sockfd, &readfds))
+                return static_cast<int>(endpoint_i);
+        }
     }
-    
-    // std::cout << "DEBUG: No data available" << std::endl;
-    return false;
+    return -1;
 }
 
 
 std::vector<std::pair<std::string, std::string>> TalkieSocket::receiveMessages() {
 
     received_messages.clear();
+    received_endpoints.clear();
     
-    if (!socket_initialized || sockfd == -1) {
+    if (!socket_initialized || endpoints.empty()) {
         return received_messages;
     }
 
     char buffer[1024];
     sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
+    socklen_t client_len;
 
-    memset(buffer, 0, sizeof(buffer));
-    
-    int received = recvfrom(sockfd, buffer, sizeof(buffer) - 1, 0,
-                            (sockaddr*)&client_addr, &client_len);
-
-    
-    do {
+    // Only reads the endpoints select() reports, so, recvfrom never blocks
+    for (int endpoint_i = readyEndpoint(0); endpoint_i >= 0; endpoint_i = readyEndpoint(0)) {
         memset(buffer, 0, sizeof(buffer));
+        client_len = sizeof(client_addr);
         
-        int received = recvfrom(sockfd, buffer, sizeof(buffer) - 1, 0,
+        int received = recvfrom(endpoints[endpoint_i].sockfd, buffer, sizeof(buffer) - 1, 0,
                                (sockaddr*)&client_addr, &client_len);
 
         if (received > 0) {
@@ -293,6 +397,7 @@ std::vector<std::pair<std::string, std::string>> TalkieSocket::receiveMessages()
             
             // Store IP and raw message separately
             received_messages.push_back({client_ip, buffer});
+            received_endpoints.push_back(static_cast<uint32_t>(endpoint_i));
             
             // if (verbose) {
             //     std::cout << "Received from " << client_ip << " - " << buffer << std::endl;
@@ -300,19 +405,24 @@ std::vector<std::pair<std::string, std::string>> TalkieSocket::receiveMessages()
         } else {
             break;
         }
-    } while (hasMessages());
+    }
 
 
     return received_messages;
 }
-
-
-bool TalkieSocket::updateAddresses() {
+bool TalkieSocket::updateAddresses(long timeout_us) {
     bool updated_addresses = false;
-    try {
-        if (socket_initialized && this->hasMessages()) {
-            this->receiveMessages();
-            for (const auto& full_message : received_messages) {
+    if (socket_initialized && this->hasMessages(timeout_us)) {
+        this->receiveMessages();
+        const long long receive_ns = TalkieCounters::clockNs();
+        std::lock_guard<std::mutex> lock(devices_mutex);
+        // Once every device has its IP the echoes are just drained, unless they acknowledge messages
+        if (totalUpdates() >= talkie_registry.totalNamed() && talkie_acks == nullptr) {
+            return false;
+        }
+        for (size_t message_i = 0; message_i < received_messages.size(); ++message_i) {
+            const auto& full_message = received_messages[message_i];
+            try {
                 std::string device_address = full_message.first;
                 std::string json_string = full_message.second;
                 
@@ -324,12 +434,14 @@ bool TalkieSocket::updateAddresses() {
                 // IT'S FASTER THIS WAY
                 std::string device_name = json_message["f"];
                 // std::cout << "2. Checked message: " << json_string << " of " << device_name << std::endl;
-                auto device_it = devices_by_name.find(device_name);
-                if (device_it != devices_by_name.end()) {
+                const uint32_t device_id = talkie_registry.findName(device_name);
+                if (device_id != TALKIE_NO_DEVICE) {
 
-                    auto talkie_device = &device_it->second;
+                    auto talkie_device = &talkie_registry.getDevice(device_id);
                     // Checks if it has an ip already (avoids extra heavy string manipulation and searching)
-                    if (talkie_device->getTargetIP().empty()) {
+                    const bool discovering = !talkie_device->hasTargetIP();
+                    const bool acknowledging = talkie_acks != nullptr && json_message.value("m", -1) == MessageCode::echo;
+                    if (discovering || acknowledging) {
 
                         uint16_t checksum = json_message["c"];
                         // std::cout << "   Expected checksum: " << checksum << std::endl;
@@ -337,392 +449,1098 @@ bool TalkieSocket::updateAddresses() {
                         uint16_t calculated = calculate_checksum(json_string);
                         // std::cout << "   Calculated checksum: " << calculated << std::endl;
                         
-                        if (checksum == calculated) {
+                        if (checksum == calculated && acknowledging) {
+                            talkie_acks->acknowledge(device_id, json_message.value("i", 0u), receive_ns);
+                        }
+                        if (checksum == calculated && discovering) {
                                 // std::cout << "3. Accepted message: " << json_string << std::endl;
-                                talkie_device->setTargetIP(device_address);
-                                // std::cout << "New Address " << device_address << " for " << device_name << std::endl;
+                                // Answered through this endpoint, so it's the one that reaches it
+                                const uint32_t endpoint_i = received_endpoints[message_i];
+                                in_addr address;
+                                if (inet_pton(AF_INET, device_address.c_str(), &address) == 1)
+                                    talkie_device->setTargetAddress(address, endpoint_i);
+                                talkie_device->getCounters().markDiscovered(TalkieCounters::clockNs());
+                                if (verbose) {
+                                    std::cout << "New Address " << device_address << " for " << device_name;
+                                    if (endpoints.size() > 1) std::cout << " on " << endpoints[endpoint_i].name;
+                                    std::cout << std::endl;
+                                }
                                 total_updates++;
                                 updated_addresses = true;
-                        } else {
+                        } else if (checksum != calculated) {
+                            talkie_device->getCounters().countChecksumFailure();
                             std::cout << "CHECKSUM FAILED! Expected: " << checksum 
                                     << ", Got: " << calculated << std::endl;
                         }
                     }
                 }
+            } catch (const std::exception& e) {
+                // A single bad datagram (not Talkie, or from an unknown sender) isn't fatal
+                if (verbose) std::cerr << "Discarded message while updating Addresses: " << e.what() << std::endl;
             }
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Fatal error while updating Addresses: " << e.what() << std::endl;
-        return false;
     }
     return updated_addresses;
 }
 
 
+nlohmann::json TalkieSocket::devicesJson() {
+    auto device_json = [this](const TalkieDevice &talkie_device) {
+        const TalkieCounters &counters = talkie_device.getCounters();
+        const double discovery_ms = counters.discoveryMs();
+        return nlohmann::json{
+            {"ip", talkie_device.hasTargetIP() ? nlohmann::json(talkie_device.getTargetIP()) : nlohmann::json()},
+            {"port", talkie_device.getTargetPort()},
+            {"interface", talkie_device.hasTargetIP()
+                ? nlohmann::json(endpoints.empty() ? "any" : endpoints[talkie_device.getEndpoint()].name) : nlohmann::json()},
+            {"unicast_sends", counters.unicastSends()},
+            {"broadcast_sends", counters.broadcastSends()},
+            {"send_errors", counters.sendErrors()},
+            {"checksum_failures", counters.checksumFailures()},
+            {"late_drops", counters.lateDrops()},
+            {"full_drops", counters.fullDrops()},
+            {"discovery_ms", discovery_ms < 0 ? nlohmann::json() : nlohmann::json(discovery_ms)},
+            {"send_us", {
+                {"p50", counters.sendPercentileUs(0.5)},
+                {"p99", counters.sendPercentileUs(0.99)},
+                {"p99_9", counters.sendPercentileUs(0.999)}
+            }},
+            {"tracked", counters.trackedMessages()},
+            {"acknowledged", counters.acknowledgedMessages()},
+            {"retransmits", counters.totalRetransmits()},
+            {"lost", counters.lostMessages()},
+            {"untracked", counters.untrackedMessages()},
+            {"coalesced", counters.coalescedMessages()},
+            {"deferred", counters.deferredMessages()},
+            {"round_trip_ms", {
+                {"p50", counters.roundTripPercentileMs(0.5)},
+                {"p99", counters.roundTripPercentileMs(0.99)}
+            }}
+        };
+    };
+    nlohmann::json devices = nlohmann::json::array();
+    std::lock_guard<std::mutex> lock(devices_mutex);
+    for (uint32_t device_id = 0; device_id < talkie_registry.size(); ++device_id) {
+        nlohmann::json device = device_json(talkie_registry.getDevice(device_id));
+        device["id"] = device_id;
+        if (talkie_registry.isNamed(device_id)) {
+            device["name"] = talkie_registry.getName(device_id);
+        } else if (talkie_registry.isChannel(device_id)) {
+            device["channel"] = talkie_registry.getChannel(device_id);
+        } else {
+            device["broadcast"] = true;
+        }
+        devices.push_back(device);
+    }
+    return devices;
+}
+
+
+std::vector<std::pair<uint32_t, std::string>> TalkieSocket::namedDevices() {
+    std::vector<std::pair<uint32_t, std::string>> named_devices;
+    std::lock_guard<std::mutex> lock(devices_mutex);
+    for (uint32_t device_id = 0; device_id < talkie_registry.size(); ++device_id) {
+        if (talkie_registry.isNamed(device_id))
+            named_devices.emplace_back(device_id, talkie_registry.getName(device_id));
+    }
+    return named_devices;
+}
+
+
+bool TalkieSocket::startReceiver() {
+    if (!socket_initialized || receiver_running.load()) {
+        return false;
+    }
+    receiver_running.store(true);
+    receiver_thread = std::thread(&TalkieSocket::receiverLoop, this);
+    return true;
+}
+
+
+void TalkieSocket::stopReceiver() {
+    receiver_running.store(false);
+    if (receiver_thread.joinable()) {
+        receiver_thread.join();
+    }
+}
+
+
+void TalkieSocket::setAcks(TalkieAcks *acks) {
+    std::lock_guard<std::mutex> lock(devices_mutex);
+    talkie_acks = acks;
+}
+
+
+void TalkieSocket::receiverLoop() {
+    unpinThread();
+    // The select() timeout bounds how long stopReceiver() waits for the join
+    while (receiver_running.load(std::memory_order_relaxed)) {
+        updateAddresses(ACKS_RECEIVE_TIMEOUT_US);
+        std::lock_guard<std::mutex> lock(devices_mutex);
+        if (talkie_acks != nullptr)
+            talkie_acks->retransmit(TalkieCounters::clockNs());
+    }
+}
+
+
 
 void TalkieSocket::closeSocket() {
-    if (sockfd != -1) {
+    stopReceiver();
+    for (TalkieEndpoint &endpoint : endpoints) {
 #ifdef _WIN32
-        closesocket(sockfd);
-        WSACleanup();  // Clean up Winsock when done
+        if (endpoint.sockfd != INVALID_SOCKET) closesocket(endpoint.sockfd);
+        endpoint.sockfd = INVALID_SOCKET;
 #else
-        close(sockfd);
+        if (endpoint.sockfd != -1) close(endpoint.sockfd);
+        endpoint.sockfd = -1;
 #endif
-        sockfd = -1;
+    }
+    endpoints.clear();
+    if (socket_initialized) {
+#ifdef _WIN32
+        WSACleanup();  // Clean up Winsock when done
+#endif
+        socket_initialized = false;
     }
 }
 
+TalkieDevice::TalkieDevice(TalkieSocket * const socket, int port, bool verbose, bool named, bool broadcast)
+            : talkie_socket(socket), verbose(verbose), named(named), broadcast(broadcast), target_port(port),
+              broadcast_target{}, unicast_target{}, active_target(&broadcast_target) {
+    broadcast_target.sin_family = AF_INET;
+    broadcast_target.sin_port = htons(port);
+    broadcast_target.sin_addr.s_addr = INADDR_BROADCAST;
+    unicast_target = broadcast_target;
+}
+
 TalkieSocket * const TalkieDevice::getSocket() {
     return talkie_socket;
 }
 
-bool TalkieDevice::sendMessage(const std::string& talkie_message) {
-    if (talkie_message.empty()) {
-        std::cerr << "Error: Empty message\n";
-        return false;
+void TalkieDevice::setTargetAddress(const in_addr& address, uint32_t endpoint_i) {
+    if (!hasTargetIP()) {
+        unicast_target.sin_addr = address;
+        unicast_endpoint = endpoint_i;
+        active_target.store(&unicast_target, std::memory_order_release);
     }
+}
 
-    // No IP defined
-    if (target_ip.empty()) {
-        // Use broadcast as default
-        return talkie_socket->sendBroadcast(target_port, talkie_message);
-    } else {
-        // Use specific IP
-        return talkie_socket->sendToDevice(target_ip, target_port, talkie_message);
+void TalkieDevice::setTargetIP(const std::string& ip) {
+    in_addr address;
+    if (inet_pton(AF_INET, ip.c_str(), &address) == 1) {
+        setTargetAddress(address, talkie_socket->routeTo(address));
+    }
+}
+
+std::string TalkieDevice::getTargetIP() const {
+    if (!hasTargetIP()) {
+        return std::string();
+    }
+    char target_ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &unicast_target.sin_addr, target_ip, INET_ADDRSTRLEN);
+    return target_ip;
+}
+
+void TalkieDevice::setDatagram(TalkieDatagram &datagram, const char* talkie_message, size_t length) const {
+    const sockaddr_in* target = active_target.load(std::memory_order_acquire);
+    datagram.target = *target;
+    datagram.message = talkie_message;
+    datagram.length = length;
+    datagram.counters = &counters;
+    datagram.unicast = target == &unicast_target;
+    datagram.endpoint_i = unicast_endpoint;
+}
+
+bool TalkieDevice::sendMessage(const char* talkie_message, size_t length) {
+    if (length == 0) {
+        std::cerr << "Error: Empty message\n";
+        return false;
     }
 
-    return false;
+    // Broadcast as default until the device IP is known
+    const sockaddr_in* target = active_target.load(std::memory_order_acquire);
+    const bool unicast = target == &unicast_target;
+    const long long send_start_ns = TalkieCounters::clockNs();
+    const bool sent = unicast ? talkie_socket->sendTo(*target, talkie_message, length, unicast_endpoint)
+        : talkie_socket->sendBroadcast(target_port, talkie_message, length);
+    counters.countSend(unicast, sent, send_start_ns, TalkieCounters::clockNs());
+    return sent;
 }
 
 
 
 
-// TalkiePin methods definition
-void TalkiePin::pluckTooth() {
-    if (talkie_device != nullptr)
-        talkie_device->sendMessage(talkie_message);
+bool parseSchedulePolicy(const std::string &policy_name, SchedulePolicy &schedule_policy) {
+    if (policy_name == "strict-grid") {
+        schedule_policy = SchedulePolicy::strict_grid;
+    } else if (policy_name == "slew") {
+        schedule_policy = SchedulePolicy::slew;
+    } else if (policy_name == "legacy-drag") {
+        schedule_policy = SchedulePolicy::legacy_drag;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+const char* schedulePolicyName(SchedulePolicy schedule_policy) {
+    switch (schedule_policy) {
+        case SchedulePolicy::strict_grid:   return "strict-grid";
+        case SchedulePolicy::slew:          return "slew";
+        case SchedulePolicy::legacy_drag:   return "legacy-drag";
+    }
+    return "unknown";
 }
 
 
 
 
-// Function to set real-time scheduling
-void setRealTimeScheduling() {
+// Function to set back the normal scheduling (threads inherit the real-time one on Linux)
+void setBackgroundScheduling() {
+    unpinThread();
 #ifdef _WIN32
-    // Set the thread priority to highest for real-time scheduling on Windows
-    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
 #else
-    // Set real-time scheduling on Linux
     struct sched_param param;
-    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
-    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
 #endif
 }
 
 
 
-int PlayList(const char* json_str, const int delay_ms, bool verbose) {
+bool loadJsonPins(const char* json_str, TalkieSocket &talkie_socket,
+        TalkieSchedule &talkie_pins, TalkieSchedule &tempo_pins, PlayReporting &play_reporting, bool verbose) {
+
+    TalkieLoader talkie_loader(talkie_socket, talkie_pins, tempo_pins, play_reporting, verbose);
+    const bool loaded = talkie_loader.loadString(json_str);
+
+    // Sorted once, same time pins keep their file order
+    talkie_pins.sort();
+
+    return loaded;
+}
+
+
+bool loadJsonFiles(const std::vector<std::string> &json_paths, TalkieSocket &talkie_socket,
+        TalkieSchedule &talkie_pins, TalkieSchedule &tempo_pins, PlayReporting &play_reporting, bool verbose) {
+
+    TalkieLoader talkie_loader(talkie_socket, talkie_pins, tempo_pins, play_reporting, verbose);
+    const bool loaded = talkie_loader.loadFiles(json_paths);
+
+    // Sorted once, same time pins keep their file order
+    talkie_pins.sort();
+
+    return loaded;
+}
+
+
+void reportData(const PlayReporting &play_reporting, size_t total_pins, bool verbose) {
+
+    // Where the reporting is finally done
+    if (verbose) std::cout << "Data stats reporting:" << std::endl;
+    if (verbose) std::cout << "\tTalkie Messages processing time (ms):       " << std::setw(10) << play_reporting.json_processing << std::endl;
+    if (verbose) std::cout << "\tTotal validated Talkie Messages (accepted): " << std::setw(10) << play_reporting.total_validated << std::endl;
+    if (verbose) std::cout << "\tTotal incorrect Talkie Messages (excluded): " << std::setw(10) << play_reporting.total_incorrect << std::endl;
+    if (verbose) std::cout << "\tTotal resultant Talkie Messages (included): " << std::setw(10) << total_pins << std::endl;
+    if (verbose && play_reporting.total_coalesced > 0)
+        std::cout << "\tTotal coalesced set messages (superseded):  " << std::setw(10) << play_reporting.total_coalesced << std::endl;
+}
+
+
+void reportPlay(const PlayReporting &play_reporting, bool verbose) {
+
+    // Where the reporting is finally done
+    if (verbose) std::cout << std::endl << "Talkie stats reporting:" << std::endl;
+    // Set fixed floating-point notation and precision
+    if (verbose) std::cout << std::fixed << std::setprecision(3);
+    if (verbose) std::cout << "\tTotal drag (ms):      " << std::setw(34) << play_reporting.total_drag << " \\" << std::endl;
+    if (verbose) std::cout << "\tCumulative delay (ms):" << std::setw(34) << play_reporting.delays.getTotal() << " /" << std::endl;
+    if (verbose) std::cout << "\tMaximum delay (ms): " << std::setw(36) << play_reporting.delays.getMaximum() << " \\" << std::endl;
+    if (verbose) std::cout << "\tMinimum delay (ms): " << std::setw(36) << play_reporting.delays.getMinimum() << " /" << std::endl;
+    if (verbose) std::cout << "\tAverage delay (ms): " << std::setw(36) << play_reporting.delays.getMean() << " \\" << std::endl;
+    if (verbose) std::cout << "\tStandard deviation of delays (ms):" << std::setw(36 - 14) << play_reporting.delays.getDeviation() << " /"  << std::endl;
+    if (verbose) std::cout << "\tMedian delay (ms):  " << std::setw(36) << play_reporting.delays.getPercentile(0.5) << " \\" << std::endl;
+    if (verbose) std::cout << "\t99th percentile delay (ms):" << std::setw(29) << play_reporting.delays.getPercentile(0.99) << " /" << std::endl;
+    if (verbose) std::cout << "\t99.9th percentile delay (ms):" << std::setw(27) << play_reporting.delays.getPercentile(0.999) << " \\" << std::endl;
+    if (verbose) std::cout << "\tTotal same time batches:" << std::setw(32) << play_reporting.total_batches << " \\" << std::endl;
+    if (verbose) std::cout << "\tLargest batch (pins):" << std::setw(35) << play_reporting.largest_batch << " /" << std::endl;
+    if (verbose) std::cout << "\tMaximum batch skew (ms):" << std::setw(32) << play_reporting.maximum_skew << " \\" << std::endl;
+    if (verbose) std::cout << "\tAverage batch skew (ms):" << std::setw(32) << play_reporting.average_skew << " /" << std::endl;
+    if (verbose) std::cout << "\tSchedule policy: " << std::setw(39) << schedulePolicyName(play_reporting.schedule_policy) << " \\" << std::endl;
+    if (verbose) std::cout << "\tLate batches:    " << std::setw(39) << play_reporting.late_batches << " /" << std::endl;
+    if (verbose) std::cout << "\tMaximum drag (ms):" << std::setw(38) << play_reporting.maximum_drag << " \\" << std::endl;
+    if (verbose) std::cout << "\tTotal slewed (ms):" << std::setw(38) << play_reporting.total_slewed << " /" << std::endl;
+    if (verbose) std::cout << "\tMaximum lateness to the grid (ms):" << std::setw(22) << play_reporting.maximum_lateness << " \\" << std::endl;
+}
+
+
+nlohmann::json reportJson(const PlayReporting &play_reporting) {
+    const TalkieStatistics &delays = play_reporting.delays;
+    nlohmann::json histogram = nlohmann::json::array();
+    const DiscoveryReport &discovery = play_reporting.discovery;
+    nlohmann::json realtime = nlohmann::json::array();
+    for (const RealTimeStep &realtime_step : play_reporting.realtime)
+        realtime.push_back({{"step", realtime_step.name}, {"applied", realtime_step.applied}, {"detail", realtime_step.detail}});
+    for (size_t bucket_i = 0; bucket_i < delays.totalBuckets(); ++bucket_i) {
+        if (delays.getBucketCount(bucket_i) > 0)    // Only the used buckets, as [upper edge (ms), pins]
+            histogram.push_back({TalkieStatistics::bucketEdge(bucket_i), delays.getBucketCount(bucket_i)});
+    }
+    return {
+        {"version", VERSION},
+        {"json_processing_ms", play_reporting.json_processing},
+        {"total_validated", play_reporting.total_validated},
+        {"total_incorrect", play_reporting.total_incorrect},
+        {"total_coalesced", play_reporting.total_coalesced},
+        {"total_drag_ms", play_reporting.total_drag},
+        {"realtime", realtime},
+        {"schedule", {
+            {"policy", schedulePolicyName(play_reporting.schedule_policy)},
+            {"late_batches", play_reporting.late_batches},
+            {"maximum_drag_ms", play_reporting.maximum_drag},
+            {"total_slewed_ms", play_reporting.total_slewed},
+            {"maximum_lateness_ms", play_reporting.maximum_lateness}
+        }},
+        {"delays_ms", {
+            {"pins", delays.count()},
+            {"total", delays.getTotal()},
+            {"minimum", delays.getMinimum()},
+            {"maximum", delays.getMaximum()},
+            {"average", delays.getMean()},
+            {"deviation", delays.getDeviation()},
+            {"p50", delays.getPercentile(0.5)},
+            {"p99", delays.getPercentile(0.99)},
+            {"p99_9", delays.getPercentile(0.999)},
+            {"histogram", histogram}
+        }},
+        {"batches", {
+            {"total", play_reporting.total_batches},
+            {"largest", play_reporting.largest_batch},
+            {"skewed", play_reporting.skewed_batches},
+            {"maximum_skew_ms", play_reporting.maximum_skew},
+            {"average_skew_ms", play_reporting.average_skew}
+        }},
+        {"discovery", !discovery.probed ? nlohmann::json() : nlohmann::json{
+            {"discovery_ms", discovery.discovery_ms},
+            {"probed", discovery.total_probed},
+            {"answered", discovery.total_answered},
+            {"cached", discovery.total_cached},
+            {"unanswered", discovery.unanswered}
+        }}
+    };
+}
+
+
+bool writeReport(const PlayReporting &play_reporting, TalkieSocket &talkie_socket, const std::string &report_path) {
+    std::ofstream report_file(report_path);
+    if (!report_file) {
+        std::cerr << "Unable to write the report: " << report_path << std::endl;
+        return false;
+    }
+    nlohmann::json report = reportJson(play_reporting);
+    report["devices"] = talkie_socket.devicesJson();
+    report_file << report.dump(4) << std::endl;
+    return true;
+}
+
+
+void reportDevices(TalkieSocket &talkie_socket, bool verbose) {
+    if (!verbose) {
+        return;
+    }
+    std::cout << std::endl << "Devices stats reporting:" << std::endl;
+    for (const auto &device : talkie_socket.devicesJson()) {
+        std::cout << "\t" << (device.contains("name") ? device["name"].get<std::string>()
+            : device.contains("channel") ? "channel " + std::to_string(device["channel"].get<int>()) : std::string("tempo"));
+        std::cout << " (" << (device["ip"].is_null() ? "broadcast" : device["ip"].get<std::string>()) << "): "
+            << device["unicast_sends"] << " unicast, " << device["broadcast_sends"] << " broadcast, "
+            << device["send_errors"] << " send errors, " << device["checksum_failures"] << " checksum failures";
+        if (device["late_drops"].get<uint64_t>() + device["full_drops"].get<uint64_t>() > 0)
+            std::cout << ", " << device["late_drops"] << " dropped late, " << device["full_drops"] << " dropped full";
+        if (!device["discovery_ms"].is_null())
+            std::cout << ", discovered in " << device["discovery_ms"].get<double>() << " ms";
+        std::cout << ", send p50/p99 " << device["send_us"]["p50"].get<double>()
+            << "/" << device["send_us"]["p99"].get<double>() << " us";
+        if (device["tracked"].get<uint64_t>() > 0)
+            std::cout << ", " << device["acknowledged"] << "/" << device["tracked"] << " acknowledged, "
+                << device["retransmits"] << " retransmits, " << device["lost"] << " lost, round trip p50/p99 "
+                << device["round_trip_ms"]["p50"].get<double>() << "/" << device["round_trip_ms"]["p99"].get<double>() << " ms";
+        if (device["untracked"].get<uint64_t>() > 0)
+            std::cout << ", " << device["untracked"] << " untracked";
+        if (device["coalesced"].get<uint64_t>() + device["deferred"].get<uint64_t>() > 0)
+            std::cout << ", " << device["coalesced"] << " coalesced, " << device["deferred"] << " deferred";
+        std::cout << std::endl;
+    }
+}
+
+
+// Plays one sorted schedule by index, from pin_i, against the deadlines of the already started timer
+// shifted by start_time_ms (of the play time line), adding each pin delay to the statistics, returns where it stopped.
+// The deadlines are also shifted by the drag gathered since drag_origin_ms, as the schedule policy sets it.
+// With senders the due pins are just queued to their devices, so the delays are only of this thread.
+// With acks the sent pins are tracked after the batch, so the tracking never delays a send.
+// Tempos played with a time scale are rewritten ahead of their batch, with their bpm_10 scaled too
+struct TempoScaling {
+    TalkieMessageWriter tempo_writer;
+    std::vector<std::string> scaled_tempos;     // One per pin of the batch, empty if sent as it is
+};
+
+
+static size_t playSchedule(TalkieSocket &talkie_socket, TalkieTimer &talkie_timer, TalkieSchedule &talkie_schedule,
+        std::vector<TalkieDatagram> &talkie_datagrams, TempoScaling &tempo_scaling,
+        TalkieSenders *talkie_senders, TalkieAcks *talkie_acks,
+        size_t pin_i, double start_time_ms,
+        double drag_origin_ms, const PlayOptions &play_options, PlayReporting &play_reporting) {
+
+    const size_t total_pins = talkie_schedule.size();
+    TalkieTracer &talkie_tracer = TalkieTracer::instance();
+    const bool tracing = talkie_tracer.isEnabled();
+    const bool scaling = play_options.time_scale != 1.0;
+    double previous_time_ms = NAN;
+
+    while (pin_i < total_pins) {
+        
+        const size_t batch_end = talkie_schedule.sameTimeEnd(pin_i);
+        const double pin_time_ms = play_options.playTime(talkie_schedule.getTime(pin_i));
+        if (play_options.schedule_policy == SchedulePolicy::slew && !std::isnan(previous_time_ms)) {
+            // Each gap between pins gives back a slice of the drag, so the grid is reached again without a jump
+            const double slew_ms = std::min(play_reporting.total_drag - drag_origin_ms,
+                (pin_time_ms - previous_time_ms) * play_options.slew_rate);
+            if (slew_ms > 0) {
+                play_reporting.total_drag -= slew_ms;
+                play_reporting.total_slewed += slew_ms;
+            }
+        }
+        previous_time_ms = pin_time_ms;
+        const double drag_ms = play_reporting.total_drag - drag_origin_ms;
+        long long next_pin_time_ns = std::llround((pin_time_ms - start_time_ms + drag_ms) * 1000000);
+
+        if (scaling) {
+            for (size_t batch_i = pin_i; batch_i < batch_end; ++batch_i) {
+                std::string &scaled_tempo = tempo_scaling.scaled_tempos[batch_i - pin_i];
+                scaled_tempo.clear();
+                const uint32_t device_id = talkie_schedule.getDeviceId(batch_i);
+                // The device itself knows, a streamed load may be growing the registry meanwhile
+                if (device_id != TALKIE_NO_DEVICE && talkie_socket.getDevice(device_id).isBroadcast()) {
+                    try {
+                        scaled_tempo = tempo_scaling.tempo_writer.writeTempo(talkie_schedule.getMessage(batch_i),
+                            talkie_schedule.getLength(batch_i), play_options.time_scale);
+                    } catch (const nlohmann::json::exception&) { }     // Sent as it is
+                }
+            }
+        }
+        auto is_scaled = [&](size_t batch_i) { return scaling && !tempo_scaling.scaled_tempos[batch_i - pin_i].empty(); };
+        auto pin_message = [&](size_t batch_i) {
+            return is_scaled(batch_i) ? tempo_scaling.scaled_tempos[batch_i - pin_i].data() : talkie_schedule.getMessage(batch_i);
+        };
+        auto pin_length = [&](size_t batch_i) {
+            return is_scaled(batch_i) ? tempo_scaling.scaled_tempos[batch_i - pin_i].size() : talkie_schedule.getLength(batch_i);
+        };
+
+        // The batch is prepared ahead, so, once awake, it's just one system call away
+        const bool batched = talkie_senders == nullptr && play_options.batch_sends && batch_end - pin_i > 1;
+        size_t total_datagrams = 0;
+        if (batched) {
+            for (size_t batch_i = pin_i; batch_i < batch_end; ++batch_i) {
+                const uint32_t device_id = talkie_schedule.getDeviceId(batch_i);
+                if (device_id != TALKIE_NO_DEVICE)
+                    talkie_socket.getDevice(device_id).setDatagram(talkie_datagrams[total_datagrams++],
+                        pin_message(batch_i), pin_length(batch_i));
+            }
+        }
+
+        if (!talkie_timer.waitUntil(next_pin_time_ns))
+            break;  // Interrupted
+
+        const long long trace_start_ns = tracing ? TalkieTracer::now() : 0;
+        long long pluck_time_ns = talkie_timer.now();
+        const double delay_time_ms = static_cast<double>(pluck_time_ns - next_pin_time_ns) / 1000000;
+        if (talkie_senders != nullptr) {
+            for (size_t batch_i = pin_i; batch_i < batch_end; ++batch_i) {
+                const uint32_t device_id = talkie_schedule.getDeviceId(batch_i);
+                if (device_id != TALKIE_NO_DEVICE)
+                    talkie_senders->send(device_id, pin_message(batch_i), pin_length(batch_i));
+                play_reporting.delays.add(delay_time_ms);
+            }
+        } else if (batched) {
+            talkie_socket.sendDatagrams(talkie_datagrams.data(), total_datagrams);  // <----- Talkie Send
+            for (size_t batch_i = pin_i; batch_i < batch_end; ++batch_i)
+                play_reporting.delays.add(delay_time_ms);
+        } else {
+            for (size_t batch_i = pin_i; batch_i < batch_end; ++batch_i) {
+                long long send_time_ns = batch_i == pin_i ? pluck_time_ns : talkie_timer.now();
+                if (is_scaled(batch_i))
+                    talkie_socket.getDevice(talkie_schedule.getDeviceId(batch_i)).sendMessage(pin_message(batch_i), pin_length(batch_i));
+                else
+                    talkie_schedule.pluckTooth(batch_i, talkie_socket.getRegistry());  // as soon as possible! <----- Talkie Send
+                play_reporting.delays.add(static_cast<double>(send_time_ns - next_pin_time_ns) / 1000000);
+            }
+        }
+        const long long batch_finish_ns = talkie_timer.now();
+        if (tracing)
+            talkie_tracer.complete("send", trace_start_ns, TalkieTracer::now(), "delay_ms", delay_time_ms);
+        if (talkie_acks != nullptr) {
+            const long long send_ns = TalkieCounters::clockNs();
+            for (size_t batch_i = pin_i; batch_i < batch_end; ++batch_i) {
+                const uint32_t device_id = talkie_schedule.getDeviceId(batch_i);
+                if (device_id != TALKIE_NO_DEVICE)
+                    talkie_acks->track(device_id, pin_message(batch_i), pin_length(batch_i), send_ns);
+            }
+        }
+
+        if (batch_end - pin_i > 1) {
+            double skew_time_ms = static_cast<double>(batch_finish_ns - pluck_time_ns) / 1000000;
+            play_reporting.maximum_skew = std::max(play_reporting.maximum_skew, skew_time_ms);
+            play_reporting.skewed_batches++;    // Running average, a play may be resumed many times
+            play_reporting.average_skew += (skew_time_ms - play_reporting.average_skew) / play_reporting.skewed_batches;
+        }
+        play_reporting.total_batches++;
+        play_reporting.largest_batch = std::max(play_reporting.largest_batch, batch_end - pin_i);
+
+        pin_i = batch_end;
+
+        play_reporting.maximum_lateness = std::max(play_reporting.maximum_lateness, delay_time_ms + drag_ms);
+        if (delay_time_ms > DRAG_DURATION_MS) {
+            play_reporting.late_batches++;
+            // Process drag if existent, the strict grid has none
+            if (play_options.schedule_policy != SchedulePolicy::strict_grid) {
+                play_reporting.total_drag += delay_time_ms - DRAG_DURATION_MS;  // Drag isn't Delay
+                play_reporting.maximum_drag = std::max(play_reporting.maximum_drag,
+                    play_reporting.total_drag - drag_origin_ms);
+            }
+        }
+    }
+    return pin_i;
+}
+
+
+size_t playSchedules(TalkieSocket &talkie_socket, TalkieTimer &talkie_timer, const std::function<TalkieSchedule*()> &next_schedule,
+        const PlayOptions &play_options, PlayReporting &play_reporting, bool verbose, size_t first_pin, double start_time_ms) {
+
+    //
+    // Where the Talkie messages are sent to each Device
+    //
+
+    if (verbose) std::cout << "Timer mode: " << timerModeName(talkie_timer.getMode())
+        << " (spin tail of " << talkie_timer.getSpinTail() / 1000 << " us)" << std::endl;
+    if (verbose) std::cout << "Schedule policy: " << schedulePolicyName(play_options.schedule_policy) << std::endl;
+
+    // Echoes update the devices IPs from now on without disturbing the playing (unless it's already running)
+    const bool started_receiver = talkie_socket.startReceiver();
+
+    // Grown before each schedule so that batching same time pins allocates nothing while playing
+    std::vector<TalkieDatagram> talkie_datagrams;
+    TempoScaling tempo_scaling;
+    // The drag so far was already applied to start_time_ms
+    const double drag_origin_ms = play_reporting.total_drag;
+    play_reporting.schedule_policy = play_options.schedule_policy;
+    size_t pin_i = first_pin;
+
+    TalkieSchedule *talkie_schedule = next_schedule();  // The first one is ready before starting
+    // Destroyed before the receiver is stopped, once everything queued is sent
+    std::unique_ptr<TalkieSenders> talkie_senders;
+    if (play_options.device_queues || play_options.rate_limit > 0)    // The rate limit defers in the queues
+        talkie_senders.reset(new TalkieSenders(talkie_socket, play_options.late_drop_ms,
+            play_options.rate_limit, play_options.rate_burst));
+    // Matched and retransmitted by the receiver, drained before it's stopped
+    std::unique_ptr<TalkieAcks> talkie_acks;
+    if (play_options.reliable_runs) {
+        talkie_acks.reset(new TalkieAcks(talkie_socket, play_options.ack_timeout_ms, play_options.ack_budget_ms));
+        talkie_socket.setAcks(talkie_acks.get());
+        if (verbose) std::cout << "Reliable runs: resent after " << play_options.ack_timeout_ms
+            << " ms, lost after " << play_options.ack_budget_ms << " ms" << std::endl;
+    }
+
+    TalkieTraceScope trace_scope("play");
+    talkie_timer.start();   // Deadlines are absolute from here on
+
+    while (talkie_schedule != nullptr) {
+        if (play_options.batch_sends)
+            talkie_datagrams.resize(std::max(talkie_datagrams.size(), talkie_schedule->largestSameTime()));
+        if (play_options.time_scale != 1.0)
+            tempo_scaling.scaled_tempos.resize(std::max(tempo_scaling.scaled_tempos.size(), talkie_schedule->largestSameTime()));
+        pin_i = playSchedule(talkie_socket, talkie_timer, *talkie_schedule, talkie_datagrams, tempo_scaling,
+            talkie_senders.get(), talkie_acks.get(), pin_i, start_time_ms, drag_origin_ms, play_options, play_reporting);
+        if (pin_i < talkie_schedule->size())
+            break;  // Interrupted
+        talkie_schedule = next_schedule();
+        if (talkie_schedule != nullptr)
+            pin_i = 0;
+    }
+
+    talkie_senders.reset();
+    if (talkie_acks) {
+        talkie_acks->drain();
+        talkie_socket.setAcks(nullptr);
+    }
+    if (started_receiver)
+        talkie_socket.stopReceiver();
+    return pin_i;
+}
+
+
+void broadcastStartTempo(TalkieSocket &talkie_socket, const TalkieSchedule &tempo_pins, double start_time_ms, double time_scale) {
+    // The ones at start_time_ms or after are still ahead in the time line
+    const size_t tempo_end = tempo_pins.timePin(start_time_ms);
+    if (tempo_end > 0) {
+        const char* tempo_message = tempo_pins.getMessage(tempo_end - 1);
+        size_t tempo_length = tempo_pins.getLength(tempo_end - 1);
+        TalkieMessageWriter tempo_writer;
+        if (time_scale != 1.0) {
+            try {
+                const std::string &scaled_tempo = tempo_writer.writeTempo(tempo_message, tempo_length, time_scale);
+                tempo_message = scaled_tempo.data();
+                tempo_length = scaled_tempo.size();
+            } catch (const nlohmann::json::exception&) { }     // Sent as it is
+        }
+        talkie_socket.sendBroadcast(talkie_socket.getPort(), tempo_message, tempo_length);
+    }
+}
+
+
+// Plays a fully loaded schedule
+static void playPins(TalkieSocket &talkie_socket, TalkieSchedule &talkie_schedule, const PlayOptions &play_options,
+        PlayReporting &play_reporting, bool verbose) {
+
+    const size_t total_pins = talkie_schedule.size();
+
+    if (total_pins > 0) {
+
+        size_t duration_time_sec = std::round(play_options.playTime(talkie_schedule.getTime(total_pins - 1)) / 1000);
+        if (verbose) std::cout << "The data will now be played during "
+            << duration_time_sec / 60 << " minutes and " << duration_time_sec % 60 << " seconds..." << std::endl;
+
+        if (play_options.discovery_s > 0)
+            play_reporting.discovery = discoverDevices(talkie_socket, play_options.discovery_s, play_options.address_cache, verbose);
+
+        TalkieTimer talkie_timer(play_options.timer_mode);
+        if (play_options.timer_mode == TimerMode::hybrid) {
+            talkie_timer.calibrate();
+        }
+
+        bool played = false;
+        playSchedules(talkie_socket, talkie_timer, [&talkie_schedule, &played]() -> TalkieSchedule* {
+            if (played) return nullptr;
+            played = true;
+            return &talkie_schedule;
+        }, play_options, play_reporting, verbose);
+    }
+}
+
+
+// Plays the blocks as they are handed over by the stream, their tempos are played as any other pin
+static void playStream(TalkieSocket &talkie_socket, TalkieStream &talkie_stream, const PlayOptions &play_options,
+        PlayReporting &play_reporting, bool verbose) {
+
+    if (verbose) std::cout << "The data will now be played while the rest is loaded..." << std::endl;
+
+    // Only the devices of the look ahead are known by now
+    if (play_options.discovery_s > 0)
+        play_reporting.discovery = discoverDevices(talkie_socket, play_options.discovery_s, play_options.address_cache, verbose);
+
+    TalkieTimer talkie_timer(play_options.timer_mode);
+    if (play_options.timer_mode == TimerMode::hybrid) {
+        talkie_timer.calibrate();
+    }
+
+    playSchedules(talkie_socket, talkie_timer, [&talkie_stream]() -> TalkieSchedule* {
+        TalkieStream::Block *block = talkie_stream.nextBlock();
+        if (block == nullptr) return nullptr;
+        return &block->talkie_pins;
+    }, play_options, play_reporting, verbose);
+}
+
+
+// Plays the ticks as they are taken from the wheel, only its ahead window is ever loaded
+static void playWheel(TalkieSocket &talkie_socket, TalkieWheelStream &wheel_stream, const PlayOptions &play_options,
+        PlayReporting &play_reporting, bool verbose) {
+
+    if (verbose) std::cout << "The data will now be played while the rest is fed to the timing wheel..." << std::endl;
+
+    // Only the devices of the ahead window are known by now (all of them for compiled play lists)
+    if (play_options.discovery_s > 0)
+        play_reporting.discovery = discoverDevices(talkie_socket, play_options.discovery_s, play_options.address_cache, verbose);
+
+    TalkieTimer talkie_timer(play_options.timer_mode);
+    if (play_options.timer_mode == TimerMode::hybrid) {
+        talkie_timer.calibrate();
+    }
+
+    playSchedules(talkie_socket, talkie_timer, [&wheel_stream]() -> TalkieSchedule* {
+        return wheel_stream.nextSchedule();
+    }, play_options, play_reporting, verbose);
+}
+
+
+static void reportWheel(TalkieWheelStream &wheel_stream, bool verbose) {
+    if (verbose) std::cout << "\tOut of order pins (played late):            " << std::setw(10) << wheel_stream.totalLate() << std::endl;
+    if (verbose) std::cout << "\tLoading underruns (waits for the loader):   " << std::setw(10) << wheel_stream.totalUnderruns() << std::endl;
+    if (verbose) std::cout << "\tMost pins held by the timing wheel:         " << std::setw(10) << wheel_stream.maximumPins() << std::endl;
+}
+
+
+static int playJson(const std::function<bool(TalkieLoader&)> &load_json, bool verbose, const PlayOptions &play_options) {
     
     if (verbose) {
         std::cout << "JsonTalkiePlayer version: " << VERSION << std::endl;
-        std::cout << "Delay set to: " << delay_ms << " ms" << std::endl;
+        std::cout << "Delay set to: " << play_options.delay_ms << " ms" << std::endl;
+        if (play_options.time_scale != 1.0) std::cout << "Time scale set to: " << play_options.time_scale << std::endl;
     }
     
-    TalkieSocket talkie_socket(verbose);
+    TalkieSocket talkie_socket(verbose, play_options.talkie_port, play_options.interfaces);
     
     // Where the playing happens
     if (talkie_socket.initialize()) {
 
         disableBackgroundThrottling();
 
-        // Set real-time scheduling
-        setRealTimeScheduling();
-        
-        #ifdef DEBUGGING
-        auto debugging_start = std::chrono::high_resolution_clock::now();
-        auto debugging_now = debugging_start;
-        auto debugging_last = debugging_now;
-        long long completion_time_us = 0;
-        #endif
-
-        struct PlayReporting {
-            size_t json_processing  = 0;    // milliseconds
-            size_t total_validated  = 0;
-            size_t total_incorrect  = 0;
-            double total_drag       = 0.0;
-            double total_delay      = 0.0;
-            double maximum_delay    = 0.0;
-            double minimum_delay    = 0.0;
-            double average_delay    = 0.0;
-            double sd_delay         = 0.0;
-        };
+        // Set real-time scheduling, undone once played
+        TalkieRealTime talkie_realtime(play_options.realtime, verbose);
+        talkie_realtime.apply();
+
         PlayReporting play_reporting;
 
-        std::list<TalkiePin> talkieToProcess;
-        std::list<TalkiePin> talkieProcessed;
+        auto data_processing_start = std::chrono::high_resolution_clock::now();
 
-        #ifdef DEBUGGING
-        debugging_now = std::chrono::high_resolution_clock::now();
-        auto completion_time = std::chrono::duration_cast<std::chrono::microseconds>(debugging_now - debugging_last);
-        completion_time_us = completion_time.count();
-        std::cout << "TALKIE DEVICES FULLY PROCESSED IN: " << completion_time_us << " microseconds" << std::endl;
-        debugging_last = std::chrono::high_resolution_clock::now();
-        #endif
+        if (play_options.wheel_ahead_s > 0) {
 
-        //
-        // Where the JSON content is processed and added up the Pluck Talkie messages
-        //
+            //
+            // Where the JSON content is fed to the timing wheel only as far ahead as needed, in any order
+            //
 
-        auto data_processing_start = std::chrono::high_resolution_clock::now();
+            const double wheel_ahead_ms = play_options.scoreSpan(play_options.wheel_ahead_s);
+            TalkieWheelStream wheel_stream(talkie_socket, wheel_ahead_ms, play_options.coalesce_ms,
+                play_reporting, verbose);
+            wheel_stream.start(load_json);
+            bool ready;
+            {
+                TalkieTraceScope trace_scope("wheel ahead");
+                ready = wheel_stream.waitAhead();
+            }
 
-        try {
+            auto wheel_ahead_finish = std::chrono::high_resolution_clock::now();
+            auto wheel_ahead_time = std::chrono::duration_cast<std::chrono::milliseconds>(wheel_ahead_finish - data_processing_start);
+            if (verbose) std::cout << "Timing wheel fed " << play_options.wheel_ahead_s << " seconds ahead in "
+                << wheel_ahead_time.count() << " ms" << std::endl << std::endl;
 
-            nlohmann::json json_files_data = nlohmann::json::parse(json_str);
+            if (ready) {
+                // Only the stack and what is loaded so far, the wheel grows up to its window as it's fed
+                talkie_realtime.lockMemory({});
+                playWheel(talkie_socket, wheel_stream, play_options, play_reporting, verbose);
+            }
+            if (!wheel_stream.join())
+                std::cerr << "Json content broken, only the pins fed before it was reached were played" << std::endl;
+            play_reporting.json_processing = wheel_stream.loadingTime();
 
-            for (nlohmann::json jsonData : json_files_data) {
+            if (verbose) std::cout << std::endl;
+            reportData(play_reporting, play_reporting.total_validated, verbose);
+            reportWheel(wheel_stream, verbose);
 
-                nlohmann::json jsonFileType;
-                nlohmann::json jsonFileUrl;
-                nlohmann::json jsonFileContent;
+        } else if (play_options.look_ahead_s > 0) {
 
-                try
-                {
-                    jsonFileType = jsonData["filetype"];
-                    jsonFileUrl = jsonData["url"];
-                    jsonFileContent = jsonData["content"];
-                }
-                catch (nlohmann::json::parse_error& ex)
-                {
-                    if (verbose) std::cerr << "Unable to extract json data: " << ex.byte << std::endl;
-                    continue;
-                }
-                
-                if (jsonFileType != FILE_TYPE || jsonFileUrl != FILE_URL) {
-                    if (verbose) std::cerr << "Wrong type of file!" << std::endl;
-                    continue;
-                }
+            //
+            // Where the JSON content keeps being loaded while the first blocks are already played
+            //
 
-                // Check if jsonFileContent is a non-empty array
-                if (!jsonFileContent.is_array() || jsonFileContent.empty()) {
-                    if (verbose) std::cerr << "JSON file is empty." << std::endl;
-                }
+            TalkieStream talkie_stream(talkie_socket, play_options.scoreSpan(play_options.look_ahead_s), play_options.coalesce_ms,
+                play_reporting, verbose);
+            talkie_stream.start(load_json);
+            bool ready;
+            {
+                TalkieTraceScope trace_scope("look ahead");
+                ready = talkie_stream.waitLookAhead();
+            }
 
+            auto look_ahead_finish = std::chrono::high_resolution_clock::now();
+            auto look_ahead_time = std::chrono::duration_cast<std::chrono::milliseconds>(look_ahead_finish - data_processing_start);
+            if (verbose) std::cout << "Look ahead of " << play_options.look_ahead_s << " seconds loaded in "
+                << look_ahead_time.count() << " ms" << std::endl << std::endl;
+
+            if (ready) {
+                // Only the stack and what is loaded so far, the later blocks are faulted in as they come
+                talkie_realtime.lockMemory({});
+                playStream(talkie_socket, talkie_stream, play_options, play_reporting, verbose);
+            } else {
+                while (talkie_stream.nextBlock() != nullptr) { }    // Lets the loader finish
+            }
+            talkie_stream.join();
+            play_reporting.json_processing = talkie_stream.loadingTime();
 
-                std::unordered_map<uint8_t, TalkieDevice> devices_by_channel;
-                TalkieDevice *talkie_device = nullptr;
+            if (verbose) std::cout << std::endl;
+            reportData(play_reporting, play_reporting.total_validated, verbose);
+            if (verbose) std::cout << "\tOut of order pins (played late):            " << std::setw(10) << talkie_stream.totalUnordered() << std::endl;
+            if (verbose) std::cout << "\tLoading underruns (waits for the loader):   " << std::setw(10) << talkie_stream.totalUnderruns() << std::endl;
 
-                for (auto jsonElement : jsonFileContent)
-                {
-                    // Talkie message is just message
-                    if (jsonElement.contains("port") && jsonElement.contains("time_ms") && jsonElement.contains("message")) {
+        } else {
 
-                        double time_milliseconds = jsonElement["time_ms"] + static_cast<double>(delay_ms);
-                        int target_port = jsonElement["port"];
-                        nlohmann::json json_talkie_message = jsonElement["message"];
-                        json_talkie_message["i"] = message_id(time_milliseconds);
-                        json_talkie_message["c"] = 0;
-                        json_talkie_message["c"] = calculate_checksum(encode(json_talkie_message));
-                        
-                        play_reporting.total_incorrect++;
-
-                        if (json_talkie_message["t"].is_string()) {
-                            std::string name = json_talkie_message["t"].get<std::string>();
-
-                            auto device_it = talkie_socket.devices_by_name.find(name);  // Use iterator, not device
-                            if (device_it != talkie_socket.devices_by_name.end()) {
-                                talkie_device = &device_it->second;  // Use iterator directly
-                            } else {
-                                auto device = talkie_socket.devices_by_name.emplace(name, TalkieDevice(&talkie_socket, target_port, verbose));
-                                talkie_device = &device.first->second; // Get pointer to stored object
-                            }
-                        } else if (json_talkie_message["t"].is_number()) {
-                            uint8_t channel = json_talkie_message["t"].get<uint8_t>();
-
-                            auto device_it = devices_by_channel.find(channel);  // Use iterator, not device
-                            if (device_it != devices_by_channel.end()) {
-                                talkie_device = &device_it->second;  // Use iterator directly
-                            } else {
-                                auto device = devices_by_channel.emplace(channel, TalkieDevice(&talkie_socket, target_port, verbose));
-                                talkie_device = &device.first->second; // Get pointer to stored object
-                            }
-                        } else {
-                            continue;
-                        }
+            TalkieSchedule talkieToProcess;
+            TalkieSchedule talkieTempos;
 
-                        const std::string talkie_message = encode(json_talkie_message);
-                        talkieToProcess.push_back( TalkiePin(time_milliseconds, talkie_device, talkie_message) );
-                        play_reporting.total_incorrect--;    // Cancels out the initial ++ increase at the beginning of the loop
-                        play_reporting.total_validated++;
+            //
+            // Where the JSON content is processed and added up the Pluck Talkie messages
+            //
 
-                    } else if (jsonElement.contains("tempo")) {
+            {
+                TalkieTraceScope trace_scope("load");
+                TalkieLoader talkie_loader(talkie_socket, talkieToProcess, talkieTempos, play_reporting, verbose);
+                load_json(talkie_loader);
+            }
+            {
+                // Sorted once, same time pins keep their file order. The tempos are played as the broadcast
+                // pins among them, without a tempo map their own schedule is left as loaded
+                TalkieTraceScope trace_scope("sort");
+                talkieToProcess.sort();
+            }
+            if (play_options.coalesce_ms > 0) {
+                TalkieTraceScope trace_scope("coalesce");
+                play_reporting.total_coalesced += talkieToProcess.coalesce(play_options.coalesce_ms, talkie_socket.getRegistry());
+            }
 
-						talkie_socket.broadcastTempo(jsonElement["tempo"]);
-                    }
-                }
+            if (verbose) std::cout << std::endl;
+
+            auto data_processing_finish = std::chrono::high_resolution_clock::now();
+            auto data_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(data_processing_finish - data_processing_start);
+            play_reporting.json_processing = data_processing_time.count();
+
+            reportData(play_reporting, talkieToProcess.size(), verbose);
+
+            if (talkieToProcess.size() > 0) {
+
+                talkie_realtime.lockMemory({&talkieToProcess});
+                playPins(talkie_socket, talkieToProcess, play_options, play_reporting, verbose);
             }
-        } catch (const nlohmann::json::parse_error& e) {
-            if (verbose) std::cerr << "JSON parse error: " << e.what() << std::endl;
         }
 
-        if (verbose) std::cout << std::endl;
+        play_reporting.realtime = talkie_realtime.getSteps();
+        reportPlay(play_reporting, verbose);
+        reportDevices(talkie_socket, verbose);
+        if (!play_options.report_path.empty())
+            writeReport(play_reporting, talkie_socket, play_options.report_path);
+    }
+    return 0;
+}
 
-        #ifdef DEBUGGING
-        debugging_now = std::chrono::high_resolution_clock::now();
-        completion_time = std::chrono::duration_cast<std::chrono::microseconds>(debugging_now - debugging_last);
-        completion_time_us = completion_time.count();
-        std::cout << "JSON DATA FULLY PROCESSED IN: " << completion_time_us << " microseconds" << std::endl;
-        debugging_last = std::chrono::high_resolution_clock::now();
-        #endif
 
+// The given delay replaces the one of the options
+static PlayOptions delayedOptions(const PlayOptions &play_options, const int delay_ms) {
+    PlayOptions delayed_options = play_options;
+    delayed_options.delay_ms = static_cast<double>(delay_ms);
+    return delayed_options;
+}
 
 
+int PlayList(const char* json_str, const int delay_ms, bool verbose, const PlayOptions &play_options) {
+    return playJson([json_str](TalkieLoader &talkie_loader) {
+        return talkie_loader.loadString(json_str);
+    }, verbose, delayedOptions(play_options, delay_ms));
+}
 
-        if (talkieToProcess.size() == 0) {
 
-            auto data_processing_finish = std::chrono::high_resolution_clock::now();
+int PlayBuffer(const char* json_data, size_t json_length, const int delay_ms, bool verbose, const PlayOptions &play_options) {
+    return playJson([json_data, json_length](TalkieLoader &talkie_loader) {
+        return talkie_loader.loadBuffer(json_data, json_length);
+    }, verbose, delayedOptions(play_options, delay_ms));
+}
 
-            auto pre_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(data_processing_finish - data_processing_start);
-            play_reporting.json_processing = pre_processing_time.count();
 
-            // Where the reporting is finally done
-            if (verbose) std::cout << "Data stats reporting:" << std::endl;
-            if (verbose) std::cout << "\tTalkie Messages processing time (ms):       " << std::setw(10) << play_reporting.json_processing << std::endl;
-            if (verbose) std::cout << "\tTotal validated Talkie Messages (accepted): " << std::setw(10) << play_reporting.total_validated << std::endl;
-            if (verbose) std::cout << "\tTotal incorrect Talkie Messages (excluded): " << std::setw(10) << play_reporting.total_incorrect << std::endl;
-            if (verbose) std::cout << "\tTotal resultant Talkie Messages (included): " << std::setw(10) << talkieToProcess.size() << std::endl;
+int PlayFiles(const std::vector<std::string> &json_paths, const int delay_ms, bool verbose, const PlayOptions &play_options) {
+    PlayOptions files_options = delayedOptions(play_options, delay_ms);
+    if (!play_options.cache_dir.empty()) {
+        // Compiled without any delay, so the same one is played with any delay
+        TalkieCache talkie_cache(play_options.cache_dir, play_options.cache_mb, verbose);
+        const std::string compiled_path = talkie_cache.compiledPath(json_paths);
+        if (!compiled_path.empty()) {
+            return PlayCompiled(compiled_path.c_str(), verbose, files_options);
+        }
+        // Played without the cache then
+    }
+    if ((files_options.look_ahead_s > 0 || files_options.wheel_ahead_s > 0) && json_paths.size() > 1) {
+        // Several files are only time ordered once merged, so they have to be loaded first
+        if (verbose) std::cout << "Look ahead needs a single file, all files are loaded first" << std::endl;
+        files_options.look_ahead_s = 0;
+        files_options.wheel_ahead_s = 0;
+    }
+    return playJson([&json_paths](TalkieLoader &talkie_loader) {
+        return talkie_loader.loadFiles(json_paths);
+    }, verbose, files_options);
+}
 
-            
-        } else {
 
-            //
-            // Where the existing Talkie messages are sorted by time and other parameters
-            //
+int PlayCompiled(const char* compiled_path, bool verbose, const PlayOptions &play_options) {
 
-            // Two levels sorting criteria
-            talkieToProcess.sort([]( const TalkiePin &a, const TalkiePin &b ) {
-            
-                 return a.getTime() < b.getTime();
-            });
-
-            #ifdef DEBUGGING
-            debugging_now = std::chrono::high_resolution_clock::now();
-            completion_time = std::chrono::duration_cast<std::chrono::microseconds>(debugging_now - debugging_last);
-            completion_time_us = completion_time.count();
-            std::cout << "SORTING FULLY PROCESSED IN: " << completion_time_us << " microseconds" << std::endl;
-            debugging_last = std::chrono::high_resolution_clock::now();
-            #endif
-
-            #ifdef DEBUGGING
-            debugging_now = std::chrono::high_resolution_clock::now();
-            completion_time = std::chrono::duration_cast<std::chrono::microseconds>(debugging_now - debugging_last);
-            completion_time_us = completion_time.count();
-            std::cout << "TALKIE MESSAGES CLEANING UP FULLY PROCESSED IN: " << completion_time_us << " microseconds" << std::endl;
-            debugging_last = std::chrono::high_resolution_clock::now();
-            #endif
+    if (verbose) {
+        std::cout << "JsonTalkiePlayer version: " << VERSION << std::endl;
+        std::cout << "Compiled play list: " << compiled_path << std::endl;
+    }
 
-            auto data_processing_finish = std::chrono::high_resolution_clock::now();
-            auto data_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(data_processing_finish - data_processing_start);
+    TalkieSocket talkie_socket(verbose, play_options.talkie_port, play_options.interfaces);
 
-            play_reporting.json_processing = data_processing_time.count();
+    // Where the playing happens
+    if (talkie_socket.initialize()) {
 
-            // Where the reporting is finally done
-            if (verbose) std::cout << "Data stats reporting:" << std::endl;
-            if (verbose) std::cout << "\tTalkie Messages processing time (ms):       " << std::setw(10) << play_reporting.json_processing << std::endl;
-            if (verbose) std::cout << "\tTotal validated Talkie Messages (accepted): " << std::setw(10) << play_reporting.total_validated << std::endl;
-            if (verbose) std::cout << "\tTotal incorrect Talkie Messages (excluded): " << std::setw(10) << play_reporting.total_incorrect << std::endl;
-            if (verbose) std::cout << "\tTotal resultant Talkie Messages (included): " << std::setw(10) << talkieToProcess.size() << std::endl;
+        disableBackgroundThrottling();
 
-            TalkiePin *last_pin = &talkieToProcess.back();
-            size_t duration_time_sec = std::round(last_pin->getTime() / 1000);
-            if (verbose) std::cout << "The data will now be played during "
-                << duration_time_sec / 60 << " minutes and " << duration_time_sec % 60 << " seconds..." << std::endl;
+        // Set real-time scheduling, undone once played
+        TalkieRealTime talkie_realtime(play_options.realtime, verbose);
+        talkie_realtime.apply();
 
+        PlayReporting play_reporting;
+
+        if (play_options.wheel_ahead_s > 0) {
 
             //
-            // Where the Talkie messages are sent to each Device
+            // Where the compiled pins are paged in from the mapping only as far ahead as needed
             //
 
-            auto playing_start = std::chrono::high_resolution_clock::now();
-
-            while (talkieToProcess.size() > 0) {
-                
-                TalkiePin &talkie_pin = talkieToProcess.front();  // Pin TALKIE message
-
-                long long next_pin_time_us = std::round((talkie_pin.getTime() + play_reporting.total_drag) * 1000);
-                auto playing_now = std::chrono::high_resolution_clock::now();
-                auto elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(playing_now - playing_start);
-                long long elapsed_time_us = elapsed_time.count();
-                long long sleep_time_us = next_pin_time_us > elapsed_time_us ? next_pin_time_us - elapsed_time_us : 0;
-
-                highResolutionSleep(sleep_time_us, &talkie_socket);  // Sleep for x microseconds
-
-                auto pluck_time = std::chrono::high_resolution_clock::now() - playing_start;
-                talkie_pin.pluckTooth();  // as soon as possible! <----- Talkie Send
-
-                auto pluck_time_us = static_cast<double>(
-                    std::chrono::duration_cast<std::chrono::microseconds>(pluck_time).count()
-                );
-                double delay_time_ms = (pluck_time_us - next_pin_time_us) / 1000;
-                talkie_pin.setDelayTime(delay_time_ms);
-                talkieProcessed.push_back(std::move(talkieToProcess.front()));  // Move the object
-                talkieToProcess.pop_front();  // Remove the first element
-
-                // Process drag if existent
-                if (delay_time_ms > DRAG_DURATION_MS)
-                    play_reporting.total_drag += delay_time_ms - DRAG_DURATION_MS;  // Drag isn't Delay
+            // Before the mapping, so the play list is never locked in memory as a whole
+            talkie_realtime.lockMemory({});
+
+            const double wheel_ahead_ms = play_options.scoreSpan(play_options.wheel_ahead_s);
+            CompiledPlayList compiled;
+            TalkieWheelStream wheel_stream(talkie_socket, wheel_ahead_ms, play_options.coalesce_ms,
+                play_reporting, verbose);
+            bool mapped;
+            {
+                TalkieTraceScope trace_scope("map compiled");
+                mapped = compiled.open(compiled_path, verbose) && wheel_stream.start(compiled);
             }
+            if (!mapped) {
+                std::cerr << "Unable to load the compiled play list: " << compiled_path << std::endl;
+                return 1;
+            }
+            play_reporting.total_validated = compiled.header()->pin_count;
 
-            #ifdef DEBUGGING
-            debugging_now = std::chrono::high_resolution_clock::now();
-            completion_time = std::chrono::duration_cast<std::chrono::microseconds>(debugging_now - debugging_last);
-            completion_time_us = completion_time.count();
-            std::cout << "PLAYING FULLY PROCESSED IN: " << completion_time_us << " microseconds" << std::endl;
-            debugging_last = std::chrono::high_resolution_clock::now();
-            #endif
+            PlayOptions compiled_options = play_options;
+            compiled_options.delay_ms += compiled.header()->delay_ms;
+            if (verbose) std::cout << "Delay set to: " << compiled_options.delay_ms << " ms" << std::endl;
+            if (wheel_stream.waitAhead())
+                playWheel(talkie_socket, wheel_stream, compiled_options, play_reporting, verbose);
+            if (!wheel_stream.join())
+                std::cerr << "Compiled play list broken past its start: " << compiled_path << std::endl;
+            play_reporting.json_processing = wheel_stream.loadingTime();
 
-            //
-            // Where the final Statistics are calculated
-            //
+            if (verbose) std::cout << std::endl;
+            reportData(play_reporting, play_reporting.total_validated, verbose);
+            reportWheel(wheel_stream, verbose);
 
-            if (talkieProcessed.size() > 0) {
-
-                for (auto &talkie_pin : talkieProcessed) {
-                    auto delay_time_ms = talkie_pin.getDelayTime();
-                    play_reporting.total_delay += delay_time_ms;
-                    play_reporting.maximum_delay = std::max(play_reporting.maximum_delay, delay_time_ms);
-                }
+        } else {
 
-                play_reporting.minimum_delay = play_reporting.maximum_delay;
-                play_reporting.average_delay = play_reporting.total_delay / talkieProcessed.size();
+            TalkieSchedule talkieToProcess;
+            TalkieSchedule talkieTempos;
 
-                for (auto &talkie_pin : talkieProcessed) {
-                    auto delay_time_ms = talkie_pin.getDelayTime();
-                    play_reporting.minimum_delay = std::min(play_reporting.minimum_delay, delay_time_ms);
-                    play_reporting.sd_delay += std::pow(delay_time_ms - play_reporting.average_delay, 2);
-                }
+            auto data_processing_start = std::chrono::high_resolution_clock::now();
 
-                play_reporting.sd_delay /= talkieProcessed.size();
-                play_reporting.sd_delay = std::sqrt(play_reporting.sd_delay);
+            // Already sorted, encoded and checksummed, just needs to be mapped (kept mapped while playing)
+            CompiledPlayList compiled;
+            bool mapped;
+            {
+                TalkieTraceScope trace_scope("map compiled");
+                mapped = compiled.open(compiled_path, verbose)
+                    && loadCompiledPins(compiled, talkie_socket, talkieToProcess, talkieTempos, verbose);
+            }
+            if (!mapped) {
+                std::cerr << "Unable to load the compiled play list: " << compiled_path << std::endl;
+                return 1;
+            }
+            play_reporting.total_validated = talkieToProcess.size();
+            if (play_options.coalesce_ms > 0) {
+                TalkieTraceScope trace_scope("coalesce");
+                play_reporting.total_coalesced += talkieToProcess.coalesce(play_options.coalesce_ms, talkie_socket.getRegistry());
             }
 
+            if (verbose) std::cout << std::endl;
+
+            auto data_processing_finish = std::chrono::high_resolution_clock::now();
+            auto data_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(data_processing_finish - data_processing_start);
+            play_reporting.json_processing = data_processing_time.count();
+
+            reportData(play_reporting, talkieToProcess.size(), verbose);
+
+            PlayOptions compiled_options = play_options;
+            compiled_options.delay_ms += compiled.header()->delay_ms;
+            if (verbose) std::cout << "Delay set to: " << compiled_options.delay_ms << " ms" << std::endl;
+            talkie_realtime.lockMemory({&talkieToProcess});   // The mapped arena included
+            playPins(talkie_socket, talkieToProcess, compiled_options, play_reporting, verbose);
         }
 
-        // Where the reporting is finally done
-        if (verbose) std::cout << std::endl << "Talkie stats reporting:" << std::endl;
-        // Set fixed floating-point notation and precision
-        if (verbose) std::cout << std::fixed << std::setprecision(3);
-        if (verbose) std::cout << "\tTotal drag (ms):      " << std::setw(34) << play_reporting.total_drag << " \\" << std::endl;
-        if (verbose) std::cout << "\tCumulative delay (ms):" << std::setw(34) << play_reporting.total_delay << " /" << std::endl;
-        if (verbose) std::cout << "\tMaximum delay (ms): " << std::setw(36) << play_reporting.maximum_delay << " \\" << std::endl;
-        if (verbose) std::cout << "\tMinimum delay (ms): " << std::setw(36) << play_reporting.minimum_delay << " /" << std::endl;
-        if (verbose) std::cout << "\tAverage delay (ms): " << std::setw(36) << play_reporting.average_delay << " \\" << std::endl;
-        if (verbose) std::cout << "\tStandard deviation of delays (ms):" << std::setw(36 - 14) << play_reporting.sd_delay << " /"  << std::endl;
+        play_reporting.realtime = talkie_realtime.getSteps();
+        reportPlay(play_reporting, verbose);
+        reportDevices(talkie_socket, verbose);
+        if (!play_options.report_path.empty())
+            writeReport(play_reporting, talkie_socket, play_options.report_path);
+    }
+    return 0;
+}
+
+
+static int compileJson(const std::function<bool(TalkieLoader&)> &load_json, const int delay_ms,
+        const char* compiled_path, bool verbose) {
+
+    if (verbose) {
+        std::cout << "JsonTalkiePlayer version: " << VERSION << std::endl;
+        std::cout << "Delay set to: " << delay_ms << " ms" << std::endl;
+    }
+
+    // Never initialized, it's only needed as the owner of the devices
+    TalkieSocket talkie_socket(verbose);
+    PlayReporting play_reporting;
+
+    TalkieSchedule talkieToProcess;
+    TalkieSchedule talkieTempos;
 
+    auto data_processing_start = std::chrono::high_resolution_clock::now();
+
+    {
+        TalkieTraceScope trace_scope("load");
+        TalkieLoader talkie_loader(talkie_socket, talkieToProcess, talkieTempos, play_reporting, verbose);
+        if (!load_json(talkie_loader)) {
+            return 1;
+        }
     }
+    {
+        // Sorted once, same time pins keep their file order
+        TalkieTraceScope trace_scope("sort");
+        talkieToProcess.sort();
+        talkieTempos.sort();
+    }
+    {
+        TalkieTraceScope trace_scope("write compiled");
+        if (!writeCompiledPlayList(compiled_path, talkie_socket, talkieToProcess, talkieTempos, delay_ms, verbose)) {
+            return 1;
+        }
+    }
+
+    auto data_processing_finish = std::chrono::high_resolution_clock::now();
+    auto data_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(data_processing_finish - data_processing_start);
+    play_reporting.json_processing = data_processing_time.count();
+
+    reportData(play_reporting, talkieToProcess.size(), verbose);
     return 0;
 }
 
 
+int CompileList(const char* json_str, const int delay_ms, const char* compiled_path, bool verbose) {
+    return compileJson([json_str](TalkieLoader &talkie_loader) {
+        return talkie_loader.loadString(json_str);
+    }, delay_ms, compiled_path, verbose);
+}
+
+
+int CompileBuffer(const char* json_data, size_t json_length, const int delay_ms, const char* compiled_path, bool verbose) {
+    return compileJson([json_data, json_length](TalkieLoader &talkie_loader) {
+        return talkie_loader.loadBuffer(json_data, json_length);
+    }, delay_ms, compiled_path, verbose);
+}
+
+
+int CompileFiles(const std::vector<std::string> &json_paths, const int delay_ms, const char* compiled_path, bool verbose) {
+    return compileJson([&json_paths](TalkieLoader &talkie_loader) {
+        return talkie_loader.loadFiles(json_paths);
+    }, delay_ms, compiled_path, verbose);
+}
+
+
 
 void disableBackgroundThrottling() {
 #ifdef _WIN32
@@ -738,75 +1556,9 @@ void disableBackgroundThrottling() {
 #endif
 }
 
-// High-resolution sleep function
-void highResolutionSleep(long long microseconds, TalkieSocket * const talkie_socket) {
-#ifdef _WIN32
-    LARGE_INTEGER frequency, start, end;
-    QueryPerformanceFrequency(&frequency);
-    QueryPerformanceCounter(&start);
-
-    double elapsedMicroseconds = 0;
-    do {
-        QueryPerformanceCounter(&end);
-        elapsedMicroseconds = static_cast<double>(end.QuadPart - start.QuadPart) * 1e6 / frequency.QuadPart;
-        
-        // Update received Addresses
-        if (talkie_socket && talkie_socket->totalUpdates() < talkie_socket->devices_by_name.size()) {
-            talkie_socket->updateAddresses();
-        }
-
-
-        // // Check and process messages
-        // if (talkie_socket && talkie_socket->hasMessages()) {
-        //     auto messages = talkie_socket->receiveMessages();
-        //     for (const auto& msg : messages) {
-        //         // Process the message here
-        //         std::cout << "Received during sleep: " << msg.second << std::endl;
-        //     }
-        // }
-        
-        // Small sleep to prevent 100% CPU usage
-        if (elapsedMicroseconds < microseconds - 1000) {  // If we have more than 1ms left
-            std::this_thread::sleep_for(std::chrono::microseconds(100));  // Sleep 100us
-        }
-        
-    } while (elapsedMicroseconds < microseconds);
-    
-#else
-    // Linux: High-resolution timing using clock_gettime
-    struct timespec start, current;
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    
-    long long elapsedNanoseconds = 0;
-    long long targetNanoseconds = microseconds * 1000;  // Convert microseconds to nanoseconds
-    
-    do {
-        clock_gettime(CLOCK_MONOTONIC, &current);
-        elapsedNanoseconds = (current.tv_sec - start.tv_sec) * 1000000000LL + 
-                           (current.tv_nsec - start.tv_nsec);
-        
-        // Update received Addresses
-        if (talkie_socket) {
-            talkie_socket->updateAddresses();
-        }
-
-
-        // // Check and process messages
-        // if (talkie_socket && talkie_socket->hasMessages()) {
-        //     auto messages = talkie_socket->receiveMessages();
-        //     for (const auto& msg : messages) {
-        //         // Process the message here
-        //         std::cout << "Received during sleep: " << msg << std::endl;
-        //     }
-        // }
-        
-        // Small sleep to prevent 100% CPU usage
-        if (elapsedNanoseconds < targetNanoseconds - 1000000) {  // If we have more than 1ms left
-            std::this_thread::sleep_for(std::chrono::microseconds(100));  // Sleep 100us
-        }
-        
-    } while (elapsedNanoseconds < targetNanoseconds);
-#endif
+// High-resolution sleep function, relative to the call (the player waits on absolute deadlines instead)
+void highResolutionSleep(long long microseconds) {
+    thread_local TalkieTimer sleep_timer(TimerMode::hybrid);
+    const long long deadline_ns = sleep_timer.now() + microseconds * 1000;
+    sleep_timer.waitUntil(deadline_ns);
 }
-
-
@@ -14,11 +14,217 @@ https://github.com/ruiseixasm/JsonMidiCreator
 https://github.com/ruiseixasm/JsonTalkiePlayer
 */
 #include "JsonTalkiePlayer_ctypes.hpp"
+#include "TalkieCompiled.hpp"
+#include "TalkieSession.hpp"
+#include "TalkieTracer.hpp"
+#include "TalkieLive.hpp"
 
 int PlayList_ctypes(const char* json_str, const int delay_ms, int verbose) {
     return PlayList(json_str, delay_ms, verbose);
 }
 
+int PlayCompiled_ctypes(const char* compiled_path, int verbose) {
+    return PlayCompiled(compiled_path, verbose);
+}
+
+int CompileList_ctypes(const char* json_str, const int delay_ms, const char* compiled_path, int verbose) {
+    return CompileList(json_str, delay_ms, compiled_path, verbose);
+}
+
+int PlayBuffer_ctypes(const char* json_data, size_t json_length, const int delay_ms, int verbose) {
+    return PlayBuffer(json_data, json_length, delay_ms, verbose);
+}
+
+int CompileBuffer_ctypes(const char* json_data, size_t json_length, const int delay_ms,
+        const char* compiled_path, int verbose) {
+    return CompileBuffer(json_data, json_length, delay_ms, compiled_path, verbose);
+}
+
+int PlayFiles_ctypes(const char** file_paths, int total_files, const int delay_ms, int verbose) {
+    if (file_paths == nullptr || total_files < 1) return 1;
+    return PlayFiles(std::vector<std::string>(file_paths, file_paths + total_files), delay_ms, verbose);
+}
+
+int PlayFilesCached_ctypes(const char** file_paths, int total_files, const int delay_ms,
+        const char* cache_dir, int cache_mb, int verbose) {
+    if (file_paths == nullptr || total_files < 1 || cache_dir == nullptr) return 1;
+    PlayOptions play_options;
+    play_options.cache_dir = cache_dir;
+    if (cache_mb > 0) play_options.cache_mb = static_cast<size_t>(cache_mb);
+    return PlayFiles(std::vector<std::string>(file_paths, file_paths + total_files), delay_ms, verbose, play_options);
+}
+
+int PlayFile_ctypes(const char* file_path, const int delay_ms, int verbose) {
+    if (isCompiledFile(file_path)) {
+        PlayOptions play_options;
+        play_options.delay_ms = delay_ms;   // Added to the one it was compiled with
+        return PlayCompiled(file_path, verbose, play_options);
+    }
+    return PlayFiles({file_path}, delay_ms, verbose);
+}
+
+void* SessionCreate_ctypes(int verbose) {
+    TalkieSession* talkie_session = new TalkieSession(verbose);
+    if (!talkie_session->isReady()) {
+        delete talkie_session;
+        return nullptr;
+    }
+    return talkie_session;
+}
+
+void* SessionCreateOn_ctypes(int verbose, int talkie_port, const char* interfaces) {
+    PlayOptions play_options;
+    play_options.talkie_port = talkie_port;
+    if (interfaces != nullptr) play_options.interfaces = interfaces;
+    TalkieSession* talkie_session = new TalkieSession(verbose, play_options);
+    if (!talkie_session->isReady()) {
+        delete talkie_session;
+        return nullptr;
+    }
+    return talkie_session;
+}
+
+int SessionLoad_ctypes(void* session, const char* json_str, const int delay_ms) {
+    if (session == nullptr) return 1;
+    return static_cast<TalkieSession*>(session)->load(json_str, delay_ms) ? 0 : 1;
+}
+
+int SessionLoadFile_ctypes(void* session, const char* file_path, const int delay_ms) {
+    if (session == nullptr) return 1;
+    TalkieSession* talkie_session = static_cast<TalkieSession*>(session);
+    if (isCompiledFile(file_path)) {
+        return talkie_session->loadCompiled(file_path, delay_ms) ? 0 : 1;
+    }
+    return talkie_session->loadFiles({file_path}, delay_ms) ? 0 : 1;
+}
+
+int SessionLoadBuffer_ctypes(void* session, const char* json_data, size_t json_length, const int delay_ms) {
+    if (session == nullptr) return 1;
+    return static_cast<TalkieSession*>(session)->loadBuffer(json_data, json_length, delay_ms) ? 0 : 1;
+}
+
+int SessionLoadFiles_ctypes(void* session, const char** file_paths, int total_files, const int delay_ms) {
+    if (session == nullptr || file_paths == nullptr || total_files < 1) return 1;
+    return static_cast<TalkieSession*>(session)->loadFiles(
+        std::vector<std::string>(file_paths, file_paths + total_files), delay_ms) ? 0 : 1;
+}
+
+int SessionPlay_ctypes(void* session) {
+    if (session == nullptr) return 1;
+    return static_cast<TalkieSession*>(session)->play();
+}
+
+int SessionStart_ctypes(void* session) {
+    if (session == nullptr) return 1;
+    return static_cast<TalkieSession*>(session)->start() ? 0 : 1;
+}
+
+void SessionPause_ctypes(void* session) {
+    if (session != nullptr) static_cast<TalkieSession*>(session)->pause();
+}
+
+void SessionSeek_ctypes(void* session, double time_ms) {
+    if (session != nullptr) static_cast<TalkieSession*>(session)->seek(time_ms);
+}
+
+void SessionStop_ctypes(void* session) {
+    if (session != nullptr) static_cast<TalkieSession*>(session)->stop();
+}
+
+void SessionWait_ctypes(void* session) {
+    if (session != nullptr) static_cast<TalkieSession*>(session)->wait();
+}
+
+double SessionPosition_ctypes(void* session) {
+    if (session == nullptr) return 0.0;
+    return static_cast<TalkieSession*>(session)->getPosition();
+}
+
+void SessionSetDelay_ctypes(void* session, double delay_ms) {
+    if (session != nullptr) static_cast<TalkieSession*>(session)->setDelay(delay_ms);
+}
+
+void SessionSeekBeat_ctypes(void* session, double beat) {
+    if (session != nullptr) static_cast<TalkieSession*>(session)->seekBeat(beat);
+}
+
+double SessionBeat_ctypes(void* session) {
+    if (session == nullptr) return 0.0;
+    return static_cast<TalkieSession*>(session)->getBeat();
+}
+
+double SessionBpm_ctypes(void* session) {
+    if (session == nullptr) return 0.0;
+    return static_cast<TalkieSession*>(session)->getBpm();
+}
+
+int SessionState_ctypes(void* session) {
+    if (session == nullptr) return 0;
+    return static_cast<int>(static_cast<TalkieSession*>(session)->getState());
+}
+
+const char* SessionReport_ctypes(void* session) {
+    if (session == nullptr) return "{}";
+    static thread_local std::string report_json;
+    report_json = static_cast<TalkieSession*>(session)->getReportJson();
+    return report_json.c_str();
+}
+
+const char* SessionDevices_ctypes(void* session) {
+    if (session == nullptr) return "[]";
+    static thread_local std::string devices_json;
+    devices_json = static_cast<TalkieSession*>(session)->getDevicesJson();
+    return devices_json.c_str();
+}
+
+void SessionDestroy_ctypes(void* session) {
+    delete static_cast<TalkieSession*>(session);
+}
+
+void* LiveCreate_ctypes(int verbose, int control_port) {
+    TalkieLive* talkie_live = new TalkieLive(control_port, verbose);
+    if (!talkie_live->isReady() || !talkie_live->start()) {
+        delete talkie_live;
+        return nullptr;
+    }
+    return talkie_live;
+}
+
+int LivePush_ctypes(void* live, const char* batch_data, size_t batch_length) {
+    if (live == nullptr || batch_data == nullptr) return 0;
+    return static_cast<int>(static_cast<TalkieLive*>(live)->push(batch_data, batch_length).accepted);
+}
+
+double LivePosition_ctypes(void* live) {
+    if (live == nullptr) return 0.0;
+    return static_cast<TalkieLive*>(live)->getPosition();
+}
+
+int LivePending_ctypes(void* live) {
+    if (live == nullptr) return 0;
+    return static_cast<int>(static_cast<TalkieLive*>(live)->totalPending());
+}
+
+void LiveStop_ctypes(void* live) {
+    if (live != nullptr) static_cast<TalkieLive*>(live)->stop();
+}
+
+void LiveWait_ctypes(void* live) {
+    if (live != nullptr) static_cast<TalkieLive*>(live)->wait();
+}
+
+void LiveDestroy_ctypes(void* live) {
+    delete static_cast<TalkieLive*>(live);
+}
+
+void TraceEnable_ctypes(int capacity_events) {
+    TalkieTracer::instance().enable(capacity_events > 0 ? static_cast<size_t>(capacity_events) : TRACE_RING_EVENTS);
+}
+
+int TraceWrite_ctypes(const char* trace_path) {
+    return TalkieTracer::instance().write(trace_path) ? 0 : 1;
+}
+
 int add_ctypes(int a, int b) {
     return a + b;
 }
\ No newline at end of file
@@ -0,0 +1,159 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieAcks.hpp"
+#include "TalkieMessage.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+
+
+TalkieAcks::TalkieAcks(TalkieSocket &socket, double timeout_ms, double budget_ms)
+            : talkie_socket(socket), timeout_ns(std::llround(timeout_ms * 1000000)),
+              budget_ns(std::llround(budget_ms * 1000000)), table(size_t(1) << ACKS_TABLE_BITS) {
+    for (Outstanding &outstanding : table)
+        outstanding.key = 0;
+}
+
+
+size_t TalkieAcks::slotOf(uint64_t key) const {
+    // Fibonacci hashing, the times of the ids are spread over the whole table
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - ACKS_TABLE_BITS));
+}
+
+
+bool TalkieAcks::track(uint32_t device_id, const char* message, size_t length, long long send_ns) {
+    uint32_t message_code, message_id;
+    if (!peekMessage(message, length, message_code, message_id) || message_code != MessageCode::run) {
+        return true;
+    }
+    TalkieDevice &talkie_device = talkie_socket.getDevice(device_id);
+    if (!talkie_device.isNamed()) {
+        return true;    // Channels answer with many names, or none
+    }
+    const uint64_t key = messageKey(device_id, message_id);
+    std::lock_guard<std::mutex> lock(table_mutex);
+    // Kept below 3/4 full, so the probing stays short
+    if (total_outstanding >= table.size() / 4 * 3 || length > ACKS_MESSAGE_BYTES) {
+        talkie_device.getCounters().countUntracked();
+        return false;
+    }
+    size_t slot_i = slotOf(key);
+    while (table[slot_i].key != 0 && table[slot_i].key != key)
+        slot_i = (slot_i + 1) & (table.size() - 1);
+    if (table[slot_i].key == 0)
+        total_outstanding++;
+    // The same "i" again (same millisecond) just restarts it, one echo acknowledges both
+    Outstanding &outstanding = table[slot_i];
+    outstanding.key = key;
+    outstanding.first_send_ns = send_ns;
+    outstanding.last_send_ns = send_ns;
+    outstanding.length = static_cast<uint32_t>(length);
+    outstanding.retransmits = 0;
+    std::memcpy(outstanding.message, message, length);
+    talkie_device.getCounters().countTracked();
+    return true;
+}
+
+
+void TalkieAcks::acknowledge(uint32_t device_id, uint32_t message_id, long long echo_ns) {
+    const uint64_t key = messageKey(device_id, message_id);
+    std::lock_guard<std::mutex> lock(table_mutex);
+    for (size_t slot_i = slotOf(key); table[slot_i].key != 0; slot_i = (slot_i + 1) & (table.size() - 1)) {
+        if (table[slot_i].key == key) {
+            const Outstanding &outstanding = table[slot_i];
+            talkie_socket.getDevice(device_id).getCounters().countAcknowledged(
+                echo_ns - outstanding.first_send_ns, outstanding.retransmits > 0);
+            erase(slot_i);
+            return;
+        }
+    }
+    // Echoed already, given up or never tracked (duplicated echoes of the retransmissions end here)
+}
+
+
+void TalkieAcks::erase(size_t slot_i) {
+    const size_t mask = table.size() - 1;
+    size_t hole_i = slot_i;
+    for (size_t next_i = (hole_i + 1) & mask; table[next_i].key != 0; next_i = (next_i + 1) & mask) {
+        // Moved back only if its home slot isn't cyclically between the hole and where it is
+        const size_t home_i = slotOf(table[next_i].key);
+        if (((next_i - home_i) & mask) >= ((next_i - hole_i) & mask)) {
+            table[hole_i] = table[next_i];
+            hole_i = next_i;
+        }
+    }
+    table[hole_i].key = 0;
+    total_outstanding--;
+}
+
+
+void TalkieAcks::retransmit(long long now_ns) {
+    struct Resend {
+        uint32_t device_id;
+        std::string message;    // The slot may be shifted once the table is unlocked
+    };
+    std::vector<Resend> resends;
+    {
+        std::lock_guard<std::mutex> lock(table_mutex);
+        if (total_outstanding == 0) {
+            return;
+        }
+        for (size_t slot_i = 0; slot_i < table.size(); ) {
+            Outstanding &outstanding = table[slot_i];
+            if (outstanding.key == 0 || now_ns - outstanding.last_send_ns < timeout_ns) {
+                slot_i++;
+                continue;
+            }
+            const uint32_t device_id = static_cast<uint32_t>(outstanding.key >> 32) - 1;
+            if (now_ns - outstanding.first_send_ns + timeout_ns > budget_ns) {
+                // Another attempt couldn't be echoed within the budget
+                talkie_socket.getDevice(device_id).getCounters().countLost();
+                erase(slot_i);
+                continue;   // The slot now has the next one shifted back, if any
+            }
+            outstanding.last_send_ns = now_ns;
+            outstanding.retransmits++;
+            resends.push_back({device_id, std::string(outstanding.message, outstanding.length)});
+            slot_i++;
+        }
+    }
+    for (const Resend &resend : resends) {
+        TalkieDevice &talkie_device = talkie_socket.getDevice(resend.device_id);
+        talkie_device.getCounters().countRetransmit();
+        talkie_device.sendMessage(resend.message);
+    }
+}
+
+
+size_t TalkieAcks::outstanding() {
+    std::lock_guard<std::mutex> lock(table_mutex);
+    return total_outstanding;
+}
+
+
+void TalkieAcks::drain() {
+    const long long drain_end_ns = TalkieCounters::clockNs() + budget_ns;
+    while (outstanding() > 0 && TalkieCounters::clockNs() < drain_end_ns) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        retransmit(TalkieCounters::clockNs());  // Also done by the receiver, the first one to get there does it
+    }
+    // Whatever is left is out of its budget by now
+    retransmit(TalkieCounters::clockNs() + budget_ns);
+}
@@ -0,0 +1,209 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieCache.hpp"
+#include "TalkieCompiled.hpp"
+#include "TalkieTracer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+    #include <direct.h>         // For _mkdir
+    #include <sys/utime.h>
+#else
+    #include <dirent.h>
+    #include <utime.h>
+    #include <sys/stat.h>
+#endif
+
+
+
+// Not cryptographic, a 64 bits word at a time (mixing the high bits back down) to hash large exports in milliseconds
+static uint64_t hash_bytes(uint64_t hash, const char* data, size_t size) {
+    size_t byte_i = 0;
+    for (; byte_i + sizeof(uint64_t) <= size; byte_i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + byte_i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 32;
+    }
+    for (; byte_i < size; ++byte_i) {
+        hash = (hash ^ static_cast<uint8_t>(data[byte_i])) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+
+static uint64_t hash_number(uint64_t hash, uint64_t number) {
+    char bytes[sizeof(number)];
+    std::memcpy(bytes, &number, sizeof(number));
+    return hash_bytes(hash, bytes, sizeof(bytes));
+}
+
+
+struct CachedFile {
+    std::string path;
+    uint64_t size;
+    long long used_time;    // Of the last write, touched on each hit
+};
+
+
+static std::vector<CachedFile> list_cached(const std::string &cache_dir) {
+    std::vector<CachedFile> cached_files;
+    const size_t extension_length = std::strlen(CACHE_EXTENSION);
+#ifdef _WIN32
+    WIN32_FIND_DATAA find_data;
+    HANDLE find_handle = FindFirstFileA((cache_dir + "/*" CACHE_EXTENSION).c_str(), &find_data);
+    if (find_handle == INVALID_HANDLE_VALUE) {
+        return cached_files;
+    }
+    do {
+        if ((find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+            cached_files.push_back({cache_dir + "/" + find_data.cFileName,
+                (static_cast<uint64_t>(find_data.nFileSizeHigh) << 32) | find_data.nFileSizeLow,
+                (static_cast<long long>(find_data.ftLastWriteTime.dwHighDateTime) << 32)
+                    | find_data.ftLastWriteTime.dwLowDateTime});
+        }
+    } while (FindNextFileA(find_handle, &find_data));
+    FindClose(find_handle);
+#else
+    DIR* directory = opendir(cache_dir.c_str());
+    if (directory == nullptr) {
+        return cached_files;
+    }
+    while (struct dirent* entry = readdir(directory)) {
+        const size_t name_length = std::strlen(entry->d_name);
+        if (name_length <= extension_length
+                || std::strcmp(entry->d_name + name_length - extension_length, CACHE_EXTENSION) != 0) {
+            continue;
+        }
+        const std::string path = cache_dir + "/" + entry->d_name;
+        struct stat file_stat;
+        if (stat(path.c_str(), &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+            cached_files.push_back({path, static_cast<uint64_t>(file_stat.st_size),
+                static_cast<long long>(file_stat.st_mtime)});
+        }
+    }
+    closedir(directory);
+#endif
+    return cached_files;
+}
+
+
+static void touch_file(const std::string &path) {
+#ifdef _WIN32
+    _utime(path.c_str(), nullptr);
+#else
+    utime(path.c_str(), nullptr);
+#endif
+}
+
+
+static void make_directory(const std::string &path) {
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+
+
+
+TalkieCache::TalkieCache(const std::string &cache_dir, size_t maximum_mb, bool verbose)
+        : cache_dir(cache_dir), maximum_bytes(static_cast<uint64_t>(maximum_mb) * 1024 * 1024), verbose(verbose) { }
+
+
+bool TalkieCache::hashFiles(const std::vector<std::string> &json_paths, uint64_t &content_hash) const {
+    TalkieTraceScope trace_scope("cache hash");
+    // The compiled format version is part of the key, so an older compiled play list is never a hit
+    uint64_t hash = hash_number(0xCBF29CE484222325ULL, COMPILED_VERSION);
+    for (const std::string &json_path : json_paths) {
+        MappedFile mapped_file;
+        if (!mapped_file.map(json_path.c_str())) {
+            return false;
+        }
+        // The size too, so that the same bytes split differently among files don't match
+        hash = hash_number(hash_bytes(hash, mapped_file.data(), mapped_file.size()), mapped_file.size());
+    }
+    content_hash = hash;
+    return true;
+}
+
+
+std::string TalkieCache::compiledPath(const std::vector<std::string> &json_paths) {
+    uint64_t content_hash;
+    if (json_paths.empty() || !hashFiles(json_paths, content_hash)) {
+        std::cerr << "Unable to read the files to be cached" << std::endl;
+        return std::string();
+    }
+    char hash_name[17];
+    std::snprintf(hash_name, sizeof(hash_name), "%016llx", static_cast<unsigned long long>(content_hash));
+    const std::string compiled_path = cache_dir + "/" + hash_name + CACHE_EXTENSION;
+
+    // A hit still has to be a valid compiled play list, as the cache may have been tampered with
+    CompiledPlayList compiled;
+    if (compiled.open(compiled_path.c_str())) {
+        compiled.close();
+        touch_file(compiled_path);
+        if (verbose) std::cout << "Cached play list: " << compiled_path << std::endl;
+        return compiled_path;
+    }
+
+    if (verbose) std::cout << "Not cached yet, compiling into: " << compiled_path << std::endl;
+    make_directory(cache_dir);
+    // Compiled aside and then renamed, so an interrupted compilation never leaves a broken hit behind
+    const std::string compiling_path = compiled_path + ".tmp";
+    if (CompileFiles(json_paths, 0, compiling_path.c_str(), verbose) != 0) {
+        std::remove(compiling_path.c_str());
+        std::cerr << "Unable to compile into the cache: " << compiled_path << std::endl;
+        return std::string();
+    }
+    std::remove(compiled_path.c_str());     // Windows doesn't rename over an existing file
+    if (std::rename(compiling_path.c_str(), compiled_path.c_str()) != 0) {
+        std::remove(compiling_path.c_str());
+        std::cerr << "Unable to store into the cache: " << compiled_path << std::endl;
+        return std::string();
+    }
+    evict(compiled_path);
+    return compiled_path;
+}
+
+
+void TalkieCache::evict(const std::string &kept_path) const {
+    std::vector<CachedFile> cached_files = list_cached(cache_dir);
+    uint64_t total_bytes = 0;
+    for (const CachedFile &cached_file : cached_files)
+        total_bytes += cached_file.size;
+    if (total_bytes <= maximum_bytes) {
+        return;
+    }
+    std::sort(cached_files.begin(), cached_files.end(), [](const CachedFile &a, const CachedFile &b) {
+        return a.used_time < b.used_time;
+    });
+    for (const CachedFile &cached_file : cached_files) {
+        if (total_bytes <= maximum_bytes) {
+            break;
+        }
+        if (cached_file.path == kept_path || std::remove(cached_file.path.c_str()) != 0) {
+            continue;
+        }
+        if (verbose) std::cout << "Evicted from the cache: " << cached_file.path << std::endl;
+        total_bytes -= cached_file.size;
+    }
+}
@@ -0,0 +1,113 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieChecksum.hpp"
+
+#include <cstring>
+
+#ifdef _MSC_VER
+    #include <intrin.h>     // For _BitScanForward64
+#endif
+
+
+static inline uint64_t load_word(const uint8_t* bytes) {
+    uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));    // Unaligned safe, compiles to a single load
+    return word;
+}
+
+static inline uint16_t swap_bytes(uint16_t chunk) {
+    return static_cast<uint16_t>((chunk << 8) | (chunk >> 8));
+}
+
+// XOR of the bytes as 16 bits chunks, the parity of the bytes already taken sets the first chunk half
+static uint16_t fold_bytes(const uint8_t* bytes, size_t length, size_t parity) {
+    uint64_t words = 0;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+        words ^= load_word(bytes + i);      // Lanes stay apart, folded only once at the end
+    words ^= words >> 32;
+    words ^= words >> 16;
+    uint16_t folded = static_cast<uint16_t>(words);
+#if !(defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    folded = swap_bytes(folded);            // Little endian lanes to big endian chunks
+#endif
+    for (; i < length; ++i)
+        folded ^= (i & 1) ? bytes[i] : static_cast<uint16_t>(bytes[i] << 8);
+    return (parity & 1) ? swap_bytes(folded) : folded;
+}
+
+// Bit 7 set on the bytes of the word equal to byte (exact for the lowest one, all that is used)
+static inline uint64_t match_bytes(uint64_t word, uint8_t byte) {
+    const uint64_t zeroed = word ^ (0x0101010101010101ULL * byte);
+    return (zeroed - 0x0101010101010101ULL) & ~zeroed & 0x8080808080808080ULL;
+}
+
+static inline unsigned lowest_byte(uint64_t matches) {
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward64(&bit, matches);
+    return static_cast<unsigned>(bit) / 8;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(matches)) / 8;
+#endif
+}
+
+// First "c": starting at or after position from, with a value byte after it
+static size_t find_c0(const uint8_t* bytes, size_t length, size_t from) {
+    size_t q = from;
+    while (q + 4 < length) {
+#if !(defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        // Jumps 8 bytes at a time to the next ':', the pattern can only be anchored at it
+        if (q + 3 + 8 <= length) {
+            const uint64_t colons = match_bytes(load_word(bytes + q + 3), ':');
+            if (colons == 0) {
+                q += 8;
+                continue;
+            }
+            q += lowest_byte(colons);
+            if (q + 4 >= length)
+                break;
+        }
+#endif
+        if (bytes[q + 3] == ':' && bytes[q + 1] == 'c' && bytes[q] == '"' && bytes[q + 2] == '"')
+            return q;
+        q++;
+    }
+    return length;
+}
+
+
+uint16_t calculate_checksum(const char* data, size_t length) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    uint16_t checksum = 0;
+    size_t emitted = 0;     // Bytes taken into account so far
+    size_t position = 0;    // First raw byte not yet taken
+
+    // Each "c": is kept and the value right after it becomes a single '0' (all its digits dropped),
+    // exactly as the JsonTalkie devices do it, but without copying the message anywhere
+    for (size_t q = find_c0(bytes, length, 0); q < length; q = find_c0(bytes, length, q + 4)) {
+        const size_t value = q + 4;
+        checksum ^= fold_bytes(bytes + position, value - position, emitted);
+        emitted += value - position;
+        checksum ^= (emitted & 1) ? '0' : static_cast<uint16_t>('0' << 8);
+        emitted++;
+        position = value + 1;
+        while (position < length && bytes[position] >= '0' && bytes[position] <= '9')
+            position++;
+    }
+    checksum ^= fold_bytes(bytes + position, length - position, emitted);
+    return checksum;
+}
@@ -0,0 +1,366 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieCompiled.hpp"
+
+#include <fstream>
+
+
+
+bool MappedFile::map(const char* path) {
+    unmap();
+
+#ifdef _WIN32
+    file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file_handle, &length) || length.QuadPart == 0) {
+        unmap();
+        return false;
+    }
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle == nullptr) {
+        unmap();
+        return false;
+    }
+    file_data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (file_data == nullptr) {
+        unmap();
+        return false;
+    }
+    file_size = static_cast<size_t>(length.QuadPart);
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0 || file_stat.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // The mapping keeps its own reference to the file
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    // The whole play list is read front to back
+    madvise(mapping, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+    file_data = static_cast<const char*>(mapping);
+    file_size = static_cast<size_t>(file_stat.st_size);
+#endif
+    return true;
+}
+
+
+void MappedFile::unmap() {
+#ifdef _WIN32
+    if (file_data != nullptr) UnmapViewOfFile(file_data);
+    if (mapping_handle != nullptr) CloseHandle(mapping_handle);
+    if (file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+    mapping_handle = nullptr;
+    file_handle = INVALID_HANDLE_VALUE;
+#else
+    if (file_data != nullptr) munmap(const_cast<char*>(file_data), file_size);
+#endif
+    file_data = nullptr;
+    file_size = 0;
+}
+
+
+
+
+bool CompiledPlayList::open(const char* path, bool verbose) {
+    close();
+
+    if (!mapped_file.map(path)) {
+        if (verbose) std::cerr << "Unable to map the compiled file: " << path << std::endl;
+        return false;
+    }
+    if (!attach(mapped_file.data(), mapped_file.size(), verbose)) {
+        if (verbose) std::cerr << "Not a valid compiled file: " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+
+bool CompiledPlayList::attach(const char* data, size_t size, bool verbose) {
+    compiled_data = nullptr;
+    compiled_header = nullptr;
+
+    if (size < sizeof(CompiledHeader)) {
+        if (verbose) std::cerr << "Compiled play list too short" << std::endl;
+        return false;
+    }
+
+    const CompiledHeader* data_header = reinterpret_cast<const CompiledHeader*>(data);
+    if (std::memcmp(data_header->magic, COMPILED_MAGIC, 4) != 0 || data_header->version != COMPILED_VERSION) {
+        if (verbose) std::cerr << "Wrong type or version of compiled play list" << std::endl;
+        return false;
+    }
+
+    // Sizes are checked as 64 bits so that corrupted counts can't wrap around
+    const uint64_t expected_size = sizeof(CompiledHeader)
+        + static_cast<uint64_t>(data_header->device_count) * sizeof(CompiledDevice)
+        + (static_cast<uint64_t>(data_header->pin_count) + data_header->tempo_count) * sizeof(CompiledPin)
+        + data_header->payload_size;
+    if (expected_size != size) {
+        if (verbose) std::cerr << "Compiled play list is truncated or corrupted" << std::endl;
+        return false;
+    }
+
+    compiled_data = data;
+    compiled_header = data_header;
+    return true;
+}
+
+
+void CompiledPlayList::close() {
+    compiled_data = nullptr;
+    compiled_header = nullptr;
+    mapped_file.unmap();
+}
+
+
+const CompiledDevice* CompiledPlayList::devices() const {
+    return reinterpret_cast<const CompiledDevice*>(compiled_data + sizeof(CompiledHeader));
+}
+
+
+const CompiledPin* CompiledPlayList::pins() const {
+    return reinterpret_cast<const CompiledPin*>(devices() + compiled_header->device_count);
+}
+
+
+const CompiledPin* CompiledPlayList::tempos() const {
+    return pins() + compiled_header->pin_count;
+}
+
+
+const char* CompiledPlayList::payload() const {
+    return reinterpret_cast<const char*>(tempos() + compiled_header->tempo_count);
+}
+
+
+bool CompiledPlayList::inPayload(uint64_t offset, uint64_t length) const {
+    return offset <= compiled_header->payload_size && length <= compiled_header->payload_size - offset;
+}
+
+
+void CompiledPlayList::releasePages(const char* begin, const char* end) const {
+#ifndef _WIN32
+    // Only the whole pages inside, a mapping of the file is read again from it if touched later
+    const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t first_page = (reinterpret_cast<uintptr_t>(begin) + page_size - 1) & ~(page_size - 1);
+    const uintptr_t last_page = reinterpret_cast<uintptr_t>(end) & ~(page_size - 1);
+    if (mapped_file.data() != nullptr && first_page < last_page)
+        madvise(reinterpret_cast<void*>(first_page), last_page - first_page, MADV_DONTNEED);
+#else
+    (void)begin;    // The working set of the process is trimmed by Windows itself
+    (void)end;
+#endif
+}
+
+
+
+
+bool isCompiledFile(const char* path) {
+    std::ifstream compiled_file(path, std::ios::binary);
+    char magic[4] = {0};
+    if (!compiled_file.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return std::memcmp(magic, COMPILED_MAGIC, sizeof(magic)) == 0;
+}
+
+
+bool encodeCompiledPlayList(std::string &compiled, const TalkieSocket &talkie_socket,
+        const TalkieSchedule &talkie_pins, const TalkieSchedule &tempo_pins, int delay_ms) {
+
+    std::vector<CompiledDevice> compiled_devices;
+    std::vector<CompiledPin> compiled_pins;
+    std::string payload;
+
+    // The devices table is the registry itself, so the pins keep their device ids as indexes
+    const TalkieRegistry &talkie_registry = talkie_socket.getRegistry();
+    for (uint32_t device_id = 0; device_id < talkie_registry.size(); ++device_id) {
+        CompiledDevice compiled_device{};
+        compiled_device.port = static_cast<uint32_t>(talkie_registry.getDevice(device_id).getTargetPort());
+        if (talkie_registry.isChannel(device_id)) {
+            compiled_device.channel = static_cast<int32_t>(talkie_registry.getChannel(device_id));
+        } else if (talkie_registry.isBroadcast(device_id)) {
+            compiled_device.channel = COMPILED_BROADCAST;
+        } else {
+            const std::string &name = talkie_registry.getName(device_id);
+            compiled_device.channel = COMPILED_NO_CHANNEL;
+            compiled_device.name_offset = static_cast<uint32_t>(payload.size());
+            compiled_device.name_length = static_cast<uint32_t>(name.size());
+            payload += name;
+        }
+        compiled_devices.push_back(compiled_device);
+    }
+
+    auto add_pins = [&](const TalkieSchedule &pins) -> bool {
+        for (size_t pin_i = 0; pin_i < pins.size(); ++pin_i) {
+            CompiledPin compiled_pin{};
+            compiled_pin.time_ms = pins.getTime(pin_i);
+            compiled_pin.device = COMPILED_NO_DEVICE;
+            if (pins.getDeviceId(pin_i) != TALKIE_NO_DEVICE) {
+                if (pins.getDeviceId(pin_i) >= compiled_devices.size()) {
+                    std::cerr << "Pin device not owned by the socket, unable to compile it!" << std::endl;
+                    return false;
+                }
+                compiled_pin.device = pins.getDeviceId(pin_i);
+            }
+            compiled_pin.offset = payload.size();
+            compiled_pin.length = static_cast<uint32_t>(pins.getLength(pin_i));
+            payload.append(pins.getMessage(pin_i), pins.getLength(pin_i));
+            compiled_pins.push_back(compiled_pin);
+        }
+        return true;
+    };
+    if (!add_pins(talkie_pins) || !add_pins(tempo_pins)) {
+        return false;
+    }
+
+    CompiledHeader compiled_header{};
+    std::memcpy(compiled_header.magic, COMPILED_MAGIC, sizeof(compiled_header.magic));
+    compiled_header.version = COMPILED_VERSION;
+    compiled_header.device_count = static_cast<uint32_t>(compiled_devices.size());
+    compiled_header.pin_count = static_cast<uint32_t>(talkie_pins.size());
+    compiled_header.tempo_count = static_cast<uint32_t>(tempo_pins.size());
+    compiled_header.delay_ms = delay_ms;
+    compiled_header.payload_size = payload.size();
+
+    compiled.clear();
+    compiled.reserve(sizeof(compiled_header) + compiled_devices.size() * sizeof(CompiledDevice)
+        + compiled_pins.size() * sizeof(CompiledPin) + payload.size());
+    compiled.append(reinterpret_cast<const char*>(&compiled_header), sizeof(compiled_header));
+    compiled.append(reinterpret_cast<const char*>(compiled_devices.data()), compiled_devices.size() * sizeof(CompiledDevice));
+    compiled.append(reinterpret_cast<const char*>(compiled_pins.data()), compiled_pins.size() * sizeof(CompiledPin));
+    compiled.append(payload);
+    return true;
+}
+
+
+bool writeCompiledPlayList(const char* path, const TalkieSocket &talkie_socket,
+        const TalkieSchedule &talkie_pins, const TalkieSchedule &tempo_pins, int delay_ms, bool verbose) {
+
+    std::string compiled;
+    if (!encodeCompiledPlayList(compiled, talkie_socket, talkie_pins, tempo_pins, delay_ms)) {
+        return false;
+    }
+
+    std::ofstream compiled_file(path, std::ios::binary | std::ios::trunc);
+    if (!compiled_file.is_open()) {
+        std::cerr << "Could not create the compiled file: " << path << std::endl;
+        return false;
+    }
+    compiled_file.write(compiled.data(), compiled.size());
+    if (!compiled_file.good()) {
+        std::cerr << "Failed to write the compiled file: " << path << std::endl;
+        return false;
+    }
+
+    if (verbose) std::cout << "Compiled " << talkie_pins.size() << " pins for " << talkie_socket.getRegistry().size()
+        << " devices into: " << path << std::endl;
+    return true;
+}
+
+
+bool loadCompiledDevices(const CompiledPlayList &compiled, TalkieSocket &talkie_socket,
+        std::vector<uint32_t> &device_ids, bool verbose) {
+
+    const CompiledHeader* compiled_header = compiled.header();
+    if (compiled_header == nullptr) {
+        return false;
+    }
+    const char* payload = compiled.payload();
+
+    device_ids.assign(compiled_header->device_count, TALKIE_NO_DEVICE);
+    const CompiledDevice* compiled_devices = compiled.devices();
+    for (uint32_t device_i = 0; device_i < compiled_header->device_count; ++device_i) {
+        const CompiledDevice &compiled_device = compiled_devices[device_i];
+        const int target_port = static_cast<int>(compiled_device.port);
+        if (compiled_device.channel == COMPILED_NO_CHANNEL) {
+            if (!compiled.inPayload(compiled_device.name_offset, compiled_device.name_length)) {
+                if (verbose) std::cerr << "Compiled device name out of bounds!" << std::endl;
+                return false;
+            }
+            std::string name(payload + compiled_device.name_offset, compiled_device.name_length);
+            device_ids[device_i] = talkie_socket.getDeviceId(name, target_port);
+        } else if (compiled_device.channel == COMPILED_BROADCAST) {
+            // The tempos go to the port of the playing socket, not to the one it was compiled with
+            device_ids[device_i] = talkie_socket.getBroadcastId(talkie_socket.getPort());
+        } else {
+            uint8_t channel = static_cast<uint8_t>(compiled_device.channel);
+            device_ids[device_i] = talkie_socket.getDeviceId(channel, target_port);
+        }
+    }
+    return true;
+}
+
+
+bool loadCompiledPins(const CompiledPlayList &compiled, TalkieSocket &talkie_socket,
+        TalkieSchedule &talkie_pins, TalkieSchedule &tempo_pins, bool verbose) {
+
+    std::vector<uint32_t> device_ids;
+    if (!loadCompiledDevices(compiled, talkie_socket, device_ids, verbose)) {
+        return false;
+    }
+    const CompiledHeader* compiled_header = compiled.header();
+    const char* payload = compiled.payload();
+
+    // Messages are played straight from the mapped payload
+    auto load_pins = [&](const CompiledPin* compiled_pins, uint32_t pin_count, TalkieSchedule &pins) -> bool {
+        pins.attachArena(payload, compiled_header->payload_size);
+        pins.reserve(pins.size() + pin_count);
+        for (uint32_t pin_i = 0; pin_i < pin_count; ++pin_i) {
+            const CompiledPin &compiled_pin = compiled_pins[pin_i];
+            uint32_t device_id;
+            if (!compiledPinDevice(compiled, compiled_pin, device_ids, device_id, verbose)) {
+                return false;
+            }
+            pins.addOffset(compiled_pin.time_ms, device_id, compiled_pin.offset, compiled_pin.length);
+        }
+        return true;
+    };
+
+    return load_pins(compiled.pins(), compiled_header->pin_count, talkie_pins)
+        && load_pins(compiled.tempos(), compiled_header->tempo_count, tempo_pins);
+}
+
+
+bool compiledPinDevice(const CompiledPlayList &compiled, const CompiledPin &compiled_pin,
+        const std::vector<uint32_t> &device_ids, uint32_t &device_id, bool verbose) {
+    if (!compiled.inPayload(compiled_pin.offset, compiled_pin.length)) {
+        if (verbose) std::cerr << "Compiled pin message out of bounds!" << std::endl;
+        return false;
+    }
+    device_id = TALKIE_NO_DEVICE;
+    if (compiled_pin.device != COMPILED_NO_DEVICE) {
+        if (compiled_pin.device >= device_ids.size()) {
+            if (verbose) std::cerr << "Compiled pin device out of bounds!" << std::endl;
+            return false;
+        }
+        device_id = device_ids[compiled_pin.device];
+    }
+    return true;
+}
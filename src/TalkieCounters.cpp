@@ -0,0 +1,108 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieCounters.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+
+
+long long TalkieCounters::clockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void TalkieCounters::countSend(bool unicast, bool sent, long long send_start_ns, long long send_finish_ns) {
+    if (first_send_ns.load(std::memory_order_relaxed) == 0) {
+        long long no_send_ns = 0;
+        first_send_ns.compare_exchange_strong(no_send_ns, send_start_ns, std::memory_order_relaxed);
+    }
+    if (!sent) {
+        send_errors.fetch_add(1, std::memory_order_relaxed);
+    } else if (unicast) {
+        unicast_sends.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        broadcast_sends.fetch_add(1, std::memory_order_relaxed);
+    }
+    addDuration(send_buckets, send_finish_ns - send_start_ns);
+}
+
+
+void TalkieCounters::countAcknowledged(long long round_trip_ns, bool retransmitted) {
+    acknowledged.fetch_add(1, std::memory_order_relaxed);
+    if (!retransmitted)
+        addDuration(round_trip_buckets, round_trip_ns);
+}
+
+
+void TalkieCounters::addDuration(std::array<std::atomic<uint64_t>, COUNTERS_BUCKETS> &buckets, long long duration_ns) {
+    size_t bucket_i = 0;
+    if (duration_ns >= COUNTERS_MINIMUM_NS) {
+        const double octaves = std::log2(static_cast<double>(duration_ns) / COUNTERS_MINIMUM_NS);
+        bucket_i = std::min(static_cast<size_t>(octaves * COUNTERS_BUCKETS_PER_OCTAVE) + 1,
+            static_cast<size_t>(COUNTERS_BUCKETS - 1));
+    }
+    buckets[bucket_i].fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void TalkieCounters::markDiscovered(long long discovered_time_ns) {
+    long long not_discovered_ns = 0;
+    discovered_ns.compare_exchange_strong(not_discovered_ns, discovered_time_ns, std::memory_order_relaxed);
+}
+
+
+double TalkieCounters::discoveryMs() const {
+    const long long discovered_time_ns = discovered_ns.load(std::memory_order_relaxed);
+    if (discovered_time_ns == 0) {
+        return -1.0;
+    }
+    const long long first_send_time_ns = first_send_ns.load(std::memory_order_relaxed);
+    if (first_send_time_ns == 0 || discovered_time_ns < first_send_time_ns) {
+        return 0.0;     // It answered before being sent anything (an echo of a previous play)
+    }
+    return static_cast<double>(discovered_time_ns - first_send_time_ns) / 1000000;
+}
+
+
+double TalkieCounters::sendPercentileUs(double fraction) const {
+    return percentileNs(send_buckets, fraction) / 1000;
+}
+
+
+double TalkieCounters::roundTripPercentileMs(double fraction) const {
+    return percentileNs(round_trip_buckets, fraction) / 1000000;
+}
+
+
+double TalkieCounters::percentileNs(const std::array<std::atomic<uint64_t>, COUNTERS_BUCKETS> &buckets, double fraction) {
+    uint64_t total_durations = 0;
+    for (const auto &bucket : buckets)
+        total_durations += bucket.load(std::memory_order_relaxed);
+    if (total_durations == 0) {
+        return 0.0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * total_durations)));
+    uint64_t counted = 0;
+    size_t bucket_i = 0;
+    for (; bucket_i < buckets.size() - 1; ++bucket_i) {
+        counted += buckets[bucket_i].load(std::memory_order_relaxed);
+        if (counted >= rank) break;
+    }
+    return COUNTERS_MINIMUM_NS * std::exp2(static_cast<double>(bucket_i) / COUNTERS_BUCKETS_PER_OCTAVE);
+}
@@ -0,0 +1,157 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieDiscovery.hpp"
+#include "TalkieMessage.hpp"
+#include "TalkieTracer.hpp"
+
+#include <fstream>
+
+
+
+bool loadAddressCache(const std::string &cache_path, std::unordered_map<std::string, std::string> &cached_ips) {
+    std::ifstream cache_file(cache_path);
+    if (!cache_file.is_open()) {
+        return true;    // Nothing cached yet
+    }
+    try {
+        nlohmann::json json_cache = nlohmann::json::parse(cache_file);
+        for (auto cached = json_cache.begin(); cached != json_cache.end(); ++cached) {
+            if (cached.value().is_object() && cached.value().contains("ip"))
+                cached_ips[cached.key()] = cached.value()["ip"].get<std::string>();
+        }
+    } catch (const nlohmann::json::exception& e) {
+        std::cerr << "Ignored the unreadable address cache " << cache_path << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool saveAddressCache(const std::string &cache_path, TalkieSocket &talkie_socket) {
+    nlohmann::json json_cache = nlohmann::json::object();
+    {
+        // Devices not in this play list keep their entries
+        std::ifstream cache_file(cache_path);
+        if (cache_file.is_open()) {
+            try {
+                json_cache = nlohmann::json::parse(cache_file);
+            } catch (const nlohmann::json::exception&) {
+                json_cache = nlohmann::json::object();
+            }
+        }
+    }
+    if (!json_cache.is_object()) {
+        json_cache = nlohmann::json::object();
+    }
+    for (const auto &named_device : talkie_socket.namedDevices()) {
+        const TalkieDevice &talkie_device = talkie_socket.getDevice(named_device.first);
+        if (talkie_device.hasTargetIP())
+            json_cache[named_device.second] = {{"ip", talkie_device.getTargetIP()}, {"port", talkie_device.getTargetPort()}};
+    }
+    std::ofstream cache_file(cache_path);
+    if (!cache_file) {
+        std::cerr << "Unable to write the address cache: " << cache_path << std::endl;
+        return false;
+    }
+    cache_file << json_cache.dump(4) << std::endl;
+    return true;
+}
+
+
+DiscoveryReport discoverDevices(TalkieSocket &talkie_socket, double timeout_s, const std::string &cache_path, bool verbose) {
+    TalkieTraceScope trace_scope("discovery");
+    DiscoveryReport discovery_report;
+    discovery_report.probed = true;
+    const auto discovery_start = std::chrono::steady_clock::now();
+
+    // The echoes are taken by the receiver, the same way as while playing
+    const bool started_receiver = talkie_socket.startReceiver();
+
+    std::vector<std::pair<uint32_t, std::string>> pending_devices;
+    for (auto &named_device : talkie_socket.namedDevices()) {
+        if (!talkie_socket.getDevice(named_device.first).hasTargetIP())
+            pending_devices.push_back(std::move(named_device));
+    }
+    discovery_report.total_probed = pending_devices.size();
+
+    std::unordered_map<std::string, std::string> cached_ips;
+    if (!cache_path.empty())
+        loadAddressCache(cache_path, cached_ips);
+
+    TalkieMessageWriter probe_writer;
+    const auto discovery_deadline = discovery_start
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout_s));
+    for (size_t probe_round = 0; !pending_devices.empty() && std::chrono::steady_clock::now() < discovery_deadline; ++probe_round) {
+
+        for (const auto &pending_device : pending_devices) {
+            TalkieDevice &talkie_device = talkie_socket.getDevice(pending_device.first);
+            const std::string &probe = probe_writer.write({
+                {"f", "JsonTalkiePlayer"}, {"m", MessageCode::talk}, {"t", pending_device.second}
+            }, 0);
+            auto cached_it = cached_ips.find(pending_device.second);
+            if (cached_it != cached_ips.end()) {
+                talkie_socket.sendToDevice(cached_it->second, talkie_device.getTargetPort(), probe);
+                if (probe_round == 0)
+                    continue;   // Broadcast only if the cached address doesn't answer (it may have changed)
+            }
+            talkie_device.sendMessage(probe);   // Broadcast, it has no address yet
+        }
+
+        const auto round_deadline = std::min(discovery_deadline,
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(DISCOVERY_PROBE_MS));
+        while (std::chrono::steady_clock::now() < round_deadline) {
+            pending_devices.erase(std::remove_if(pending_devices.begin(), pending_devices.end(),
+                [&talkie_socket](const std::pair<uint32_t, std::string> &pending_device) {
+                    return talkie_socket.getDevice(pending_device.first).hasTargetIP();
+                }), pending_devices.end());
+            if (pending_devices.empty())
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(DISCOVERY_POLL_MS));
+        }
+    }
+
+    if (started_receiver)
+        talkie_socket.stopReceiver();
+
+    discovery_report.total_answered = discovery_report.total_probed - pending_devices.size();
+    // A cached address that didn't answer may be stale (a new DHCP lease, a late boot), so these devices
+    // are still played by broadcast, their first echo gives them their actual address
+    for (const auto &pending_device : pending_devices) {
+        discovery_report.unanswered.push_back(pending_device.second);
+        if (cached_ips.count(pending_device.second) > 0)
+            discovery_report.total_cached++;
+    }
+    discovery_report.discovery_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - discovery_start).count();
+
+    if (!cache_path.empty() && discovery_report.total_answered > 0)
+        saveAddressCache(cache_path, talkie_socket);
+
+    if (verbose) {
+        std::cout << "Discovery of " << discovery_report.total_probed << " devices: "
+            << discovery_report.total_answered << " answered in " << discovery_report.discovery_ms << " ms" << std::endl;
+        for (const auto &pending_device : pending_devices) {
+            auto cached_it = cached_ips.find(pending_device.second);
+            std::cout << "\tNo answer from " << pending_device.second;
+            std::cout << ", played by broadcast";
+            if (cached_it != cached_ips.end())
+                std::cout << " (nor from its cached address " << cached_it->second << ")";
+            std::cout << std::endl;
+        }
+    }
+    return discovery_report;
+}
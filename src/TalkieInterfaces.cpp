@@ -0,0 +1,139 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieInterfaces.hpp"
+
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+    #include <ws2tcpip.h>
+    #include <iphlpapi.h>           // For GetAdaptersInfo
+    #pragma comment(lib, "iphlpapi.lib")
+#else
+    #include <arpa/inet.h>
+    #include <ifaddrs.h>
+    #include <net/if.h>
+#endif
+
+
+
+std::vector<TalkieInterface> listInterfaces() {
+    std::vector<TalkieInterface> talkie_interfaces;
+#ifdef _WIN32
+    ULONG buffer_size = 0;
+    if (GetAdaptersInfo(nullptr, &buffer_size) != ERROR_BUFFER_OVERFLOW) {
+        return talkie_interfaces;
+    }
+    std::vector<char> buffer(buffer_size);
+    PIP_ADAPTER_INFO adapters = reinterpret_cast<PIP_ADAPTER_INFO>(buffer.data());
+    if (GetAdaptersInfo(adapters, &buffer_size) != NO_ERROR) {
+        return talkie_interfaces;
+    }
+    for (PIP_ADAPTER_INFO adapter = adapters; adapter != nullptr; adapter = adapter->Next) {
+        for (PIP_ADDR_STRING address = &adapter->IpAddressList; address != nullptr; address = address->Next) {
+            TalkieInterface talkie_interface{};
+            talkie_interface.name = adapter->AdapterName;
+            if (inet_pton(AF_INET, address->IpAddress.String, &talkie_interface.address) != 1
+                    || inet_pton(AF_INET, address->IpMask.String, &talkie_interface.netmask) != 1
+                    || talkie_interface.address.s_addr == INADDR_ANY) {
+                continue;   // Adapters without an address list 0.0.0.0
+            }
+            talkie_interface.broadcast.s_addr = talkie_interface.address.s_addr | ~talkie_interface.netmask.s_addr;
+            talkie_interface.loopback = false;  // The Windows loopback isn't an adapter
+            talkie_interfaces.push_back(talkie_interface);
+        }
+    }
+#else
+    struct ifaddrs* interface_addresses = nullptr;
+    if (getifaddrs(&interface_addresses) != 0) {
+        return talkie_interfaces;
+    }
+    for (struct ifaddrs* entry = interface_addresses; entry != nullptr; entry = entry->ifa_next) {
+        if (entry->ifa_addr == nullptr || entry->ifa_addr->sa_family != AF_INET || (entry->ifa_flags & IFF_UP) == 0) {
+            continue;
+        }
+        TalkieInterface talkie_interface{};
+        talkie_interface.name = entry->ifa_name;
+        talkie_interface.address = reinterpret_cast<const sockaddr_in*>(entry->ifa_addr)->sin_addr;
+        if (entry->ifa_netmask != nullptr)
+            talkie_interface.netmask = reinterpret_cast<const sockaddr_in*>(entry->ifa_netmask)->sin_addr;
+        // Computed for the ones without IFF_BROADCAST too, the loopback delivers its subnet broadcast
+        talkie_interface.broadcast.s_addr = talkie_interface.address.s_addr | ~talkie_interface.netmask.s_addr;
+        if ((entry->ifa_flags & IFF_BROADCAST) != 0 && entry->ifa_broadaddr != nullptr)
+            talkie_interface.broadcast = reinterpret_cast<const sockaddr_in*>(entry->ifa_broadaddr)->sin_addr;
+        talkie_interface.loopback = (entry->ifa_flags & IFF_LOOPBACK) != 0;
+        talkie_interfaces.push_back(talkie_interface);
+    }
+    freeifaddrs(interface_addresses);
+#endif
+    return talkie_interfaces;
+}
+
+
+bool selectInterfaces(const std::string &selection, std::vector<TalkieInterface> &selected_interfaces, bool verbose) {
+    const std::vector<TalkieInterface> talkie_interfaces = listInterfaces();
+    selected_interfaces.clear();
+
+    if (selection == INTERFACES_ALL) {
+        for (const TalkieInterface &talkie_interface : talkie_interfaces) {
+            if (!talkie_interface.loopback)
+                selected_interfaces.push_back(talkie_interface);
+        }
+        if (selected_interfaces.empty()) {
+            std::cerr << "No interface able to broadcast was found" << std::endl;
+            return false;
+        }
+    } else {
+        std::stringstream names(selection);
+        std::string name;
+        while (std::getline(names, name, ',')) {
+            if (name.empty()) {
+                continue;
+            }
+            in_addr address{};
+            const bool is_address = inet_pton(AF_INET, name.c_str(), &address) == 1;
+            bool found = false;
+            for (const TalkieInterface &talkie_interface : talkie_interfaces) {
+                if (is_address ? talkie_interface.address.s_addr == address.s_addr : talkie_interface.name == name) {
+                    selected_interfaces.push_back(talkie_interface);
+                    found = true;
+                    break;  // The first address of an interface with several
+                }
+            }
+            if (!found) {
+                std::cerr << "Unknown network interface: " << name << std::endl;
+                return false;
+            }
+        }
+    }
+
+    if (verbose) {
+        for (const TalkieInterface &talkie_interface : selected_interfaces) {
+            char address[INET_ADDRSTRLEN], broadcast[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &talkie_interface.address, address, INET_ADDRSTRLEN);
+            inet_ntop(AF_INET, &talkie_interface.broadcast, broadcast, INET_ADDRSTRLEN);
+            std::cout << "Interface " << talkie_interface.name << ": " << address
+                << " (broadcast " << broadcast << ")" << std::endl;
+        }
+    }
+    return !selected_interfaces.empty();
+}
+
+
+bool inSubnet(const TalkieInterface &talkie_interface, const in_addr &address) {
+    return (address.s_addr & talkie_interface.netmask.s_addr)
+        == (talkie_interface.address.s_addr & talkie_interface.netmask.s_addr);
+}
@@ -0,0 +1,446 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieLive.hpp"
+#include "TalkieLoader.hpp"
+#include "TalkieCompiled.hpp"
+#include "TalkieTracer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>           // For std::greater
+
+#ifndef _WIN32
+    #include <netinet/in.h>
+#endif
+
+#ifdef MSG_NOSIGNAL
+    #define LIVE_SEND_FLAGS MSG_NOSIGNAL    // A client gone away isn't a reason to end the process
+#else
+    #define LIVE_SEND_FLAGS 0
+#endif
+
+
+
+TalkieLive::TalkieLive(int control_port, bool verbose, const PlayOptions &play_options)
+            : verbose(verbose), play_options(play_options), control_port(control_port),
+              talkie_socket(verbose, play_options.talkie_port, play_options.interfaces), talkie_timer(play_options.timer_mode) {
+
+    if (verbose) std::cout << "JsonTalkiePlayer version: " << VERSION << std::endl;
+
+    socket_ready = talkie_socket.initialize();
+    if (socket_ready) {
+        disableBackgroundThrottling();
+        if (play_options.timer_mode == TimerMode::hybrid) {
+            talkie_timer.calibrate();
+        }
+        // Echoes keep updating the devices IPs while nothing is pending too
+        talkie_socket.startReceiver();
+    }
+}
+
+
+TalkieLive::~TalkieLive() {
+    stop();
+    if (play_thread.joinable()) {
+        play_thread.join();
+    }
+    if (control_thread.joinable()) {
+        control_thread.join();
+    }
+    closeControl();
+    talkie_socket.stopReceiver();
+}
+
+
+bool TalkieLive::start() {
+    if (!socket_ready || play_thread.joinable()) {
+        return false;
+    }
+    if (!openControl()) {
+        closeControl();
+        return false;
+    }
+    if (verbose) std::cout << "Live batches accepted on port " << control_port << " (TCP and UDP)" << std::endl;
+    control_running.store(true);
+    control_thread = std::thread(&TalkieLive::controlLoop, this);
+    play_thread = std::thread(&TalkieLive::playLive, this);
+    return true;
+}
+
+
+LiveAnswer TalkieLive::push(const char* data, size_t length) {
+    LiveAnswer live_answer;
+    live_answer.valid = length == 0;    // Just asks for the position
+
+    // Loaded without holding the pending_mutex, only the merge below keeps the play thread waiting
+    TalkieSchedule talkie_pins;
+    TalkieSchedule tempo_pins;
+    double delay_ms = 0.0;
+    CompiledPlayList compiled;
+    if (length >= sizeof(CompiledHeader) && std::memcmp(data, COMPILED_MAGIC, 4) == 0) {
+        live_answer.valid = compiled.attach(data, length)
+            && loadCompiledPins(compiled, talkie_socket, talkie_pins, tempo_pins);
+        if (live_answer.valid)
+            delay_ms = compiled.header()->delay_ms;
+    } else if (length > 0) {
+        PlayReporting batch_reporting;
+        TalkieLoader talkie_loader(talkie_socket, talkie_pins, tempo_pins, batch_reporting);
+        live_answer.valid = talkie_loader.loadBuffer(data, length);
+    }
+    if (live_answer.valid && length > 0) {
+        talkie_pins.sort();
+        if (play_options.coalesce_ms > 0)
+            talkie_pins.coalesce(play_options.coalesce_ms, talkie_socket.getRegistry());
+    }
+
+    std::lock_guard<std::mutex> pending_lock(pending_mutex);
+    const double position_ms = positionMs();
+    if (length > 0) {
+        live_report.total_batches++;
+        if (!live_answer.valid)
+            live_report.invalid_batches++;
+    }
+    for (size_t pin_i = 0; live_answer.valid && pin_i < talkie_pins.size(); ++pin_i) {
+        if (talkie_pins.getLength(pin_i) > SEND_MESSAGE_BYTES || pending_pins.size() >= LIVE_MAXIMUM_PENDING) {
+            live_answer.refused++;
+            continue;
+        }
+        uint32_t slot_i;
+        if (free_slots.empty()) {
+            slot_i = static_cast<uint32_t>(slots.size());
+            slots.emplace_back();
+        } else {
+            slot_i = free_slots.back();
+            free_slots.pop_back();
+        }
+        Slot &slot = slots[slot_i];
+        slot.device_id = talkie_pins.getDeviceId(pin_i);
+        slot.length = static_cast<uint32_t>(talkie_pins.getLength(pin_i));
+        std::memcpy(slot.message, talkie_pins.getMessage(pin_i), slot.length);
+        const double time_ms = talkie_pins.getTime(pin_i) + delay_ms;
+        if (time_ms < position_ms)
+            live_report.late_pins++;
+        pending_pins.push_back({time_ms, next_sequence++, slot_i});
+        std::push_heap(pending_pins.begin(), pending_pins.end(), std::greater<PendingPin>());
+        live_answer.accepted++;
+    }
+    live_report.accepted_pins += live_answer.accepted;
+    live_report.refused_pins += live_answer.refused;
+    live_report.maximum_pending = std::max(live_report.maximum_pending, pending_pins.size());
+    live_answer.position_ms = position_ms;
+    live_answer.pending = pending_pins.size();
+    if (live_answer.accepted > 0)
+        pending_condition.notify_all();     // The new pins may be due before the ones waited for
+    return live_answer;
+}
+
+
+void TalkieLive::stop() {
+    std::lock_guard<std::mutex> pending_lock(pending_mutex);
+    if (!stop_requested) {
+        TalkieTracer::instance().instant("stop");
+        stop_requested = true;
+        talkie_timer.interrupt();
+        pending_condition.notify_all();
+    }
+}
+
+
+void TalkieLive::wait() {
+    std::unique_lock<std::mutex> pending_lock(pending_mutex);
+    pending_condition.wait(pending_lock, [this]() { return stop_requested && !playing; });
+}
+
+
+double TalkieLive::getPosition() {
+    std::lock_guard<std::mutex> pending_lock(pending_mutex);
+    return positionMs();
+}
+
+
+size_t TalkieLive::totalPending() {
+    std::lock_guard<std::mutex> pending_lock(pending_mutex);
+    return pending_pins.size();
+}
+
+
+LiveReport TalkieLive::getLiveReport() {
+    std::lock_guard<std::mutex> pending_lock(pending_mutex);
+    return live_report;
+}
+
+
+double TalkieLive::positionMs() const {
+    if (!playing) {
+        return 0.0;
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - live_origin).count();
+}
+
+
+TalkieSchedule* TalkieLive::nextBatch() {
+    std::unique_lock<std::mutex> pending_lock(pending_mutex);
+    while (true) {
+        if (stop_requested) {
+            return nullptr;
+        }
+        if (pending_pins.empty()) {
+            pending_condition.wait(pending_lock);
+            continue;
+        }
+        // The last LIVE_HORIZON_MS are waited for by the timer, far more precise than the condition
+        const double wait_ms = pending_pins.front().time_ms - LIVE_HORIZON_MS - positionMs();
+        if (wait_ms <= 0) {
+            break;
+        }
+        pending_condition.wait_for(pending_lock, std::chrono::duration<double, std::milli>(wait_ms));
+    }
+
+    // Whatever arrives meanwhile for the same horizon is played right after this batch
+    live_batch.clear();
+    const double horizon_ms = positionMs() + LIVE_HORIZON_MS;
+    while (!pending_pins.empty() && pending_pins.front().time_ms <= horizon_ms) {
+        std::pop_heap(pending_pins.begin(), pending_pins.end(), std::greater<PendingPin>());
+        const PendingPin &pending_pin = pending_pins.back();
+        const Slot &slot = slots[pending_pin.slot_i];
+        live_batch.add(pending_pin.time_ms, slot.device_id, slot.message, slot.length);
+        free_slots.push_back(pending_pin.slot_i);
+        pending_pins.pop_back();
+    }
+    return &live_batch;
+}
+
+
+void TalkieLive::playLive() {
+
+    // Set real-time scheduling, undone once this play ends
+    TalkieRealTime talkie_realtime(play_options.realtime, verbose);
+    talkie_realtime.apply();
+
+    // The pins already carry the times of the live time line, and a late one never shifts the later ones
+    PlayOptions live_options = play_options;
+    live_options.delay_ms = 0.0;
+    live_options.time_scale = 1.0;
+    live_options.schedule_policy = SchedulePolicy::strict_grid;
+
+    PlayReporting live_reporting;
+    live_reporting.realtime = talkie_realtime.getSteps();
+    bool started = false;
+    playSchedules(talkie_socket, talkie_timer, [this, &started]() -> TalkieSchedule* {
+        if (started) return nextBatch();
+        // Right before the timer is started, so both share the time zero
+        started = true;
+        std::lock_guard<std::mutex> pending_lock(pending_mutex);
+        live_origin = std::chrono::steady_clock::now();
+        playing = true;
+        live_batch.clear();
+        return &live_batch;
+    }, live_options, live_reporting, verbose);
+
+    const LiveReport final_report = getLiveReport();
+    if (verbose) {
+        std::cout << std::endl << "Live batches: " << final_report.total_batches << " (" << final_report.invalid_batches
+            << " invalid), pins accepted " << final_report.accepted_pins << ", refused " << final_report.refused_pins
+            << ", late " << final_report.late_pins << ", at most " << final_report.maximum_pending << " pending" << std::endl;
+    }
+    reportPlay(live_reporting, verbose);
+    reportDevices(talkie_socket, verbose);
+    if (!play_options.report_path.empty()) {
+        std::ofstream report_file(play_options.report_path);
+        if (report_file) {
+            nlohmann::json report = reportJson(live_reporting);
+            report["live"] = liveReportJson(final_report);
+            report["devices"] = talkie_socket.devicesJson();
+            report_file << report.dump(4) << std::endl;
+        } else {
+            std::cerr << "Unable to write the report: " << play_options.report_path << std::endl;
+        }
+    }
+
+    std::lock_guard<std::mutex> pending_lock(pending_mutex);
+    play_reporting = live_reporting;
+    stop_requested = true;      // Stopped by an interrupt of the timer too
+    playing = false;
+    control_running.store(false);
+    pending_condition.notify_all();
+}
+
+
+
+bool TalkieLive::openControl() {
+    sockaddr_in local_addr{};
+    local_addr.sin_family = AF_INET;
+    local_addr.sin_addr.s_addr = INADDR_ANY;
+    local_addr.sin_port = htons(static_cast<uint16_t>(control_port));
+    const int reuse = 1;
+
+    tcp_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (tcp_socket == LIVE_NO_SOCKET) {
+        std::cerr << "Failed to create the live TCP socket" << std::endl;
+        return false;
+    }
+    setsockopt(tcp_socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    if (bind(tcp_socket, (sockaddr*)&local_addr, sizeof(local_addr)) < 0 || listen(tcp_socket, SOMAXCONN) < 0) {
+        std::cerr << "Failed to listen on the live port " << control_port << std::endl;
+        return false;
+    }
+
+    udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_socket == LIVE_NO_SOCKET) {
+        std::cerr << "Failed to create the live UDP socket" << std::endl;
+        return false;
+    }
+    if (bind(udp_socket, (sockaddr*)&local_addr, sizeof(local_addr)) < 0) {
+        std::cerr << "Failed to bind the live UDP port " << control_port << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+void TalkieLive::closeControl() {
+    for (Client &client : clients)
+        close(client.sockfd);
+    clients.clear();
+    if (tcp_socket != LIVE_NO_SOCKET) close(tcp_socket);
+    if (udp_socket != LIVE_NO_SOCKET) close(udp_socket);
+    tcp_socket = LIVE_NO_SOCKET;
+    udp_socket = LIVE_NO_SOCKET;
+}
+
+
+void TalkieLive::controlLoop() {
+    setBackgroundScheduling();  // Loading the batches never competes with the play thread
+    std::vector<char> datagram(65536);
+    while (control_running.load(std::memory_order_relaxed)) {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(tcp_socket, &readfds);
+        FD_SET(udp_socket, &readfds);
+        int highest_fd = std::max(static_cast<int>(tcp_socket), static_cast<int>(udp_socket));
+        for (const Client &client : clients) {
+            FD_SET(client.sockfd, &readfds);
+            highest_fd = std::max(highest_fd, static_cast<int>(client.sockfd));
+        }
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = LIVE_POLL_MS * 1000;
+        if (select(highest_fd + 1, &readfds, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+
+        if (FD_ISSET(udp_socket, &readfds)) {
+            sockaddr_in udp_source{};
+            socklen_t source_length = sizeof(udp_source);
+            const int received = recvfrom(udp_socket, datagram.data(), static_cast<int>(datagram.size()), 0,
+                (sockaddr*)&udp_source, &source_length);
+            if (received >= 0) {
+                const size_t length = static_cast<size_t>(received);
+                if (length == sizeof(LIVE_STOP_COMMAND) - 1 && std::memcmp(datagram.data(), LIVE_STOP_COMMAND, length) == 0) {
+                    stop();
+                } else {
+                    answer(push(datagram.data(), length), udp_socket, &udp_source);
+                }
+            }
+        }
+        for (size_t client_i = 0; client_i < clients.size(); ) {
+            if (FD_ISSET(clients[client_i].sockfd, &readfds) && !readClient(clients[client_i])) {
+                close(clients[client_i].sockfd);
+                clients.erase(clients.begin() + client_i);
+            } else {
+                client_i++;
+            }
+        }
+        if (FD_ISSET(tcp_socket, &readfds)) {
+            const LiveSocket client_socket = accept(tcp_socket, nullptr, nullptr);
+            if (client_socket != LIVE_NO_SOCKET) {
+                if (verbose) std::cout << "Live client connected" << std::endl;
+                clients.push_back({client_socket, std::vector<char>()});
+            }
+        }
+    }
+}
+
+
+bool TalkieLive::readClient(Client &client) {
+    char chunk[65536];
+    const int received = recv(client.sockfd, chunk, sizeof(chunk), 0);
+    if (received <= 0) {
+        return false;   // Closed or failed
+    }
+    client.received.insert(client.received.end(), chunk, chunk + received);
+
+    size_t frame_start = 0;
+    while (client.received.size() - frame_start >= 4) {
+        const unsigned char* size_bytes = reinterpret_cast<const unsigned char*>(client.received.data() + frame_start);
+        const uint32_t frame_length = size_bytes[0] | (size_bytes[1] << 8) | (size_bytes[2] << 16)
+            | (static_cast<uint32_t>(size_bytes[3]) << 24);
+        if (frame_length > LIVE_MAXIMUM_FRAME) {
+            std::cerr << "Live frame of " << frame_length << " bytes refused, closing its client" << std::endl;
+            return false;
+        }
+        if (client.received.size() - frame_start - 4 < frame_length) {
+            break;  // Not whole yet
+        }
+        const char* frame = client.received.data() + frame_start + 4;
+        frame_start += 4 + frame_length;
+        if (frame_length == sizeof(LIVE_STOP_COMMAND) - 1 && std::memcmp(frame, LIVE_STOP_COMMAND, frame_length) == 0) {
+            stop();
+            continue;
+        }
+        // Copied so that a compiled play list is 8 bytes aligned, as its sections expect
+        std::vector<uint64_t> aligned((frame_length + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        std::memcpy(aligned.data(), frame, frame_length);
+        answer(push(reinterpret_cast<const char*>(aligned.data()), frame_length), client.sockfd);
+    }
+    client.received.erase(client.received.begin(), client.received.begin() + frame_start);
+    return true;
+}
+
+
+void TalkieLive::answer(const LiveAnswer &live_answer, LiveSocket sockfd, const sockaddr_in *udp_source) {
+    const std::string answer_line = liveAnswerJson(live_answer) + "\n";
+    if (udp_source != nullptr) {
+        sendto(sockfd, answer_line.data(), static_cast<int>(answer_line.size()), 0,
+            (const sockaddr*)udp_source, sizeof(sockaddr_in));
+    } else {
+        send(sockfd, answer_line.data(), static_cast<int>(answer_line.size()), LIVE_SEND_FLAGS);
+    }
+}
+
+
+
+std::string liveAnswerJson(const LiveAnswer &live_answer) {
+    return nlohmann::json{
+        {"valid", live_answer.valid},
+        {"accepted", live_answer.accepted},
+        {"refused", live_answer.refused},
+        {"position_ms", live_answer.position_ms},
+        {"pending", live_answer.pending}
+    }.dump();
+}
+
+
+nlohmann::json liveReportJson(const LiveReport &live_report) {
+    return {
+        {"total_batches", live_report.total_batches},
+        {"invalid_batches", live_report.invalid_batches},
+        {"accepted_pins", live_report.accepted_pins},
+        {"refused_pins", live_report.refused_pins},
+        {"late_pins", live_report.late_pins},
+        {"maximum_pending", live_report.maximum_pending}
+    };
+}
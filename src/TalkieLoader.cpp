@@ -0,0 +1,457 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieLoader.hpp"
+#include "TalkieTracer.hpp"
+#include "TalkieCompiled.hpp"       // For MappedFile
+
+#include <fstream>
+#include <atomic>
+#include <cstring>
+
+
+static uint32_t message_id(const double time_milliseconds) {
+    return static_cast<uint32_t>(time_milliseconds);
+}
+
+
+// Tracks where the parser is, files are the objects of the top level array (or the top level object
+// itself) and only the elements of their "content" array are built as DOM, one at a time
+class TalkieSaxHandler : public nlohmann::json_sax<nlohmann::json> {
+private:
+    TalkieLoader &talkie_loader;
+    size_t depth = 0;               // Of the containers outside of the elements
+    size_t file_depth = 1;          // 2 when the files come inside an array
+    size_t content_depth = 0;       // Of the content array being read, 0 if none
+
+    enum class FileKey { other, filetype, url, content };
+    FileKey file_key = FileKey::other;
+    bool file_type_ok = false;
+    bool file_url_ok = false;
+    size_t total_elements = 0;
+    // Elements read before both the file type and url, played only once they are confirmed
+    std::vector<nlohmann::json> deferred_elements;
+
+    // The element being built, with the stack of its open containers
+    nlohmann::json json_element;
+    std::vector<nlohmann::json*> element_containers;
+    std::string element_key;
+
+public:
+    TalkieSaxHandler(TalkieLoader &loader) : talkie_loader(loader) { }
+
+    bool null() override { return value(nullptr); }
+    bool boolean(bool val) override { return value(val); }
+    bool number_integer(number_integer_t val) override { return value(val); }
+    bool number_unsigned(number_unsigned_t val) override { return value(val); }
+    bool number_float(number_float_t val, const string_t&) override { return value(val); }
+    bool string(string_t& val) override { return value(std::move(val)); }
+    bool binary(binary_t& val) override { return value(nlohmann::json::binary(std::move(val))); }
+
+    bool start_object(std::size_t) override {
+        if (inElement()) {
+            element_containers.push_back(insert(nlohmann::json::object()));
+            return true;
+        }
+        depth++;
+        if (depth == file_depth) {
+            file_key = FileKey::other;
+            file_type_ok = file_url_ok = false;
+            total_elements = 0;
+            deferred_elements.clear();
+        }
+        return true;
+    }
+
+    bool key(string_t& val) override {
+        if (!element_containers.empty()) {
+            element_key = std::move(val);
+        } else if (depth == file_depth) {
+            file_key = val == "filetype" ? FileKey::filetype
+                : val == "url" ? FileKey::url
+                : val == "content" ? FileKey::content : FileKey::other;
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        if (!element_containers.empty()) {
+            return closeContainer();
+        }
+        if (depth == file_depth && !endFile()) {
+            return false;
+        }
+        depth--;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (inElement()) {
+            element_containers.push_back(insert(nlohmann::json::array()));
+            return true;
+        }
+        if (depth == 0) {
+            file_depth = 2;     // An array of files
+        } else if (depth == file_depth && file_key == FileKey::content) {
+            content_depth = depth + 1;
+        }
+        depth++;
+        return true;
+    }
+
+    bool end_array() override {
+        if (!element_containers.empty()) {
+            return closeContainer();
+        }
+        if (depth == content_depth) {
+            content_depth = 0;
+        }
+        depth--;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::json::exception& ex) override {
+        if (talkie_loader.isVerbose()) std::cerr << "JSON parse error: " << ex.what() << std::endl;
+        return false;
+    }
+
+private:
+    // Either inside an element or about to open one
+    bool inElement() const {
+        return !element_containers.empty() || (content_depth != 0 && depth == content_depth);
+    }
+
+    nlohmann::json* insert(nlohmann::json&& val) {
+        if (element_containers.empty()) {
+            json_element = std::move(val);
+            return &json_element;
+        }
+        nlohmann::json* container = element_containers.back();
+        if (container->is_object()) {
+            return &((*container)[element_key] = std::move(val));
+        }
+        container->push_back(std::move(val));
+        return &container->back();
+    }
+
+    bool value(nlohmann::json&& val) {
+        if (!element_containers.empty()) {
+            insert(std::move(val));
+        } else if (depth == file_depth && val.is_string()) {
+            if (file_key == FileKey::filetype) file_type_ok = val == FILE_TYPE;
+            if (file_key == FileKey::url) file_url_ok = val == FILE_URL;
+        }
+        // Scalar elements aren't Talkie elements, they are just ignored
+        return true;
+    }
+
+    bool closeContainer() {
+        element_containers.pop_back();
+        if (element_containers.empty()) {
+            total_elements++;
+            if (file_type_ok && file_url_ok) {
+                return talkie_loader.loadElement(json_element);     // The parse stops with the load
+            } else {
+                deferred_elements.push_back(std::move(json_element));
+            }
+        }
+        return true;
+    }
+
+    bool endFile() {
+        if (!file_type_ok || !file_url_ok) {
+            if (talkie_loader.isVerbose()) std::cerr << "Wrong type of file!" << std::endl;
+        } else {
+            for (const auto &deferred_element : deferred_elements) {
+                if (!talkie_loader.loadElement(deferred_element)) {
+                    deferred_elements.clear();
+                    return false;
+                }
+            }
+            if (total_elements == 0) {
+                if (talkie_loader.isVerbose()) std::cerr << "JSON file is empty." << std::endl;
+            }
+        }
+        deferred_elements.clear();
+        return true;
+    }
+};
+
+
+
+TalkieLoader::TalkieLoader(TalkieSocket &talkie_socket, TalkieSchedule &talkie_pins,
+        TalkieSchedule &tempo_pins, PlayReporting &play_reporting, bool verbose)
+            : talkie_socket(talkie_socket), verbose(verbose), play_reporting(play_reporting),
+              talkie_pins(&talkie_pins), tempo_pins(&tempo_pins) { }
+
+
+void TalkieLoader::setSchedules(TalkieSchedule &talkie_pins, TalkieSchedule &tempo_pins) {
+    this->talkie_pins = &talkie_pins;
+    this->tempo_pins = &tempo_pins;
+}
+
+
+bool TalkieLoader::loadString(const char* json_str) {
+    return loadBuffer(json_str, std::strlen(json_str));
+}
+
+
+bool TalkieLoader::loadBuffer(const char* json_data, size_t json_length) {
+    TalkieSaxHandler sax_handler(*this);
+    return nlohmann::json::sax_parse(json_data, json_data + json_length, &sax_handler);
+}
+
+
+bool TalkieLoader::loadFile(const char* json_path) {
+    MappedFile mapped_file;
+    if (mapped_file.map(json_path)) {
+        TalkieTraceScope trace_scope("load file");
+        return loadBuffer(mapped_file.data(), mapped_file.size());
+    }
+    std::ifstream json_file(json_path, std::ios::binary);
+    if (!json_file.is_open()) {
+        std::cerr << "Could not open the file: " << json_path << std::endl;
+        return false;
+    }
+    TalkieTraceScope trace_scope("load file");
+    TalkieSaxHandler sax_handler(*this);
+    return nlohmann::json::sax_parse(json_file, &sax_handler);
+}
+
+
+bool TalkieLoader::loadFiles(const std::vector<std::string> &json_paths) {
+    if (json_paths.size() < 2) {
+        return json_paths.size() == 1 && loadFile(json_paths.front().c_str());
+    }
+
+    struct FileLoad {
+        TalkieSchedule talkie_pins;
+        TalkieSchedule tempo_pins;
+        PlayReporting play_reporting;
+        bool loaded = false;
+    };
+    std::vector<FileLoad> file_loads(json_paths.size());
+    std::atomic<size_t> next_file{0};
+
+    // Devices are shared, the socket guards them, everything else is owned by each file
+    auto load_files = [&]() {
+        for (size_t file_i = next_file++; file_i < json_paths.size(); file_i = next_file++) {
+            FileLoad &file_load = file_loads[file_i];
+            TalkieLoader file_loader(talkie_socket, file_load.talkie_pins, file_load.tempo_pins,
+                file_load.play_reporting, verbose);
+            file_load.loaded = file_loader.loadFile(json_paths[file_i].c_str());
+            file_load.talkie_pins.sort();
+        }
+    };
+    const size_t total_workers = std::min<size_t>(json_paths.size(),
+        std::max<unsigned int>(1, std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (size_t worker_i = 1; worker_i < total_workers; ++worker_i)
+        workers.emplace_back([&load_files]() {
+            unpinThread();  // Off the core of the play thread, if it's pinned
+            load_files();
+        });
+    load_files();   // This thread is a worker too
+    for (auto &worker : workers)
+        worker.join();
+
+    bool loaded = true;
+    std::vector<const TalkieSchedule*> sorted_schedules;
+    for (const FileLoad &file_load : file_loads) {
+        loaded = loaded && file_load.loaded;
+        sorted_schedules.push_back(&file_load.talkie_pins);
+        for (size_t pin_i = 0; pin_i < file_load.tempo_pins.size(); ++pin_i)
+            tempo_pins->add(file_load.tempo_pins.getTime(pin_i), TALKIE_NO_DEVICE,
+                file_load.tempo_pins.getMessage(pin_i), file_load.tempo_pins.getLength(pin_i));
+        play_reporting.total_validated += file_load.play_reporting.total_validated;
+        play_reporting.total_incorrect += file_load.play_reporting.total_incorrect;
+    }
+    TalkieTraceScope trace_scope("merge");
+    talkie_pins->merge(sorted_schedules);
+    return loaded;
+}
+
+
+bool TalkieLoader::loadElement(const nlohmann::json &json_element) {
+
+    if (!json_element.is_object()) {
+        return true;
+    }
+
+    // Talkie message is just message
+    if (json_element.contains("port") && json_element.contains("time_ms") && json_element.contains("message")) {
+
+        play_reporting.total_incorrect++;
+
+        try {
+            // The ID comes from the time of the score, so the same messages play with any delay
+            const double time_milliseconds = json_element["time_ms"].get<double>();
+            int target_port = json_element["port"];
+            const nlohmann::json &json_talkie_message = json_element["message"];
+
+            if (!json_talkie_message.is_object() || !json_talkie_message.contains("t")) {
+                return true;
+            }
+            const uint32_t device_id = talkie_socket.getDeviceId(json_talkie_message["t"], target_port);
+            if (device_id == TALKIE_NO_DEVICE) {
+                return true;
+            }
+
+            if (before_pin && !before_pin(time_milliseconds)) {
+                play_reporting.total_incorrect--;   // Not incorrect, just never loaded
+                return false;
+            }
+            talkie_pins->add(time_milliseconds, device_id,
+                message_writer.write(json_talkie_message, message_id(time_milliseconds)));
+            play_reporting.total_incorrect--;    // Cancels out the initial ++ increase at the beginning
+            play_reporting.total_validated++;
+
+        } catch (const nlohmann::json::exception& e) {
+            if (verbose) std::cerr << "Discarded Talkie element: " << e.what() << std::endl;
+        }
+
+    } else if (json_element.contains("tempo")) {
+
+        try {
+            const double time_milliseconds = json_element.value("time_ms", 0.0);
+            // Played in the time line as any other pin, and kept apart as the tempo map
+            const std::string &tempo_message = message_writer.writeTempo(json_element["tempo"]);
+            if (before_pin && !before_pin(time_milliseconds)) {
+                return false;
+            }
+            talkie_pins->add(time_milliseconds, talkie_socket.getBroadcastId(talkie_socket.getPort()), tempo_message);
+            tempo_pins->add(time_milliseconds, TALKIE_NO_DEVICE, tempo_message);
+        } catch (const std::exception& e) {
+            std::cerr << "Fatal error while encoding Tempo: " << e.what() << std::endl;
+        }
+    }
+    return true;
+}
+
+
+
+
+TalkieStream::TalkieStream(TalkieSocket &talkie_socket, double look_ahead_ms, double coalesce_ms,
+        PlayReporting &play_reporting, bool verbose)
+            : loading_block(new Block()),
+              talkie_loader(talkie_socket, loading_block->talkie_pins, loading_block->tempo_pins,
+                  play_reporting, verbose),
+              talkie_socket(talkie_socket), play_reporting(play_reporting),
+              look_ahead_ms(look_ahead_ms), coalesce_ms(coalesce_ms) {
+    loading_block->talkie_pins.reserve(STREAM_BLOCK_PINS);
+    // Blocks are only cut between different times, so same time pins stay in a single batch
+    talkie_loader.setBeforePin([this](double time_ms) {
+        const TalkieSchedule &talkie_pins = loading_block->talkie_pins;
+        if (talkie_pins.size() >= STREAM_BLOCK_PINS && talkie_pins.getTime(talkie_pins.size() - 1) != time_ms)
+            handOver();
+        return true;
+    });
+}
+
+
+TalkieStream::~TalkieStream() {
+    join();
+}
+
+
+void TalkieStream::start(std::function<bool(TalkieLoader&)> load) {
+    loader_thread = std::thread([this, load]() {
+        // Never competes with the real time thread that created it
+        setBackgroundScheduling();
+        auto loading_start = std::chrono::high_resolution_clock::now();
+        bool load_ok;
+        {
+            TalkieTraceScope trace_scope("load");
+            load_ok = load(talkie_loader);
+            handOver();
+        }
+        auto loading_finish = std::chrono::high_resolution_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(blocks_mutex);
+            loading_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(loading_finish - loading_start).count();
+            loaded = load_ok;
+            finished = true;
+        }
+        blocks_condition.notify_all();
+    });
+}
+
+
+void TalkieStream::handOver() {
+    if (loading_block->talkie_pins.empty() && loading_block->tempo_pins.empty()) {
+        return;
+    }
+    const long long trace_start_ns = TalkieTracer::instance().isEnabled() ? TalkieTracer::now() : 0;
+    std::unique_ptr<Block> block = std::move(loading_block);
+    block->talkie_pins.sort();     // The tempos are played among them, their own pins are never read
+    play_reporting.total_coalesced += block->talkie_pins.coalesce(coalesce_ms, talkie_socket.getRegistry());
+    loading_block.reset(new Block());
+    loading_block->talkie_pins.reserve(STREAM_BLOCK_PINS);
+    talkie_loader.setSchedules(loading_block->talkie_pins, loading_block->tempo_pins);
+
+    const TalkieSchedule &talkie_pins = block->talkie_pins;
+    {
+        std::lock_guard<std::mutex> lock(blocks_mutex);
+        if (!talkie_pins.empty()) {
+            if (!any_handed) {
+                first_time_ms = handed_time_ms = talkie_pins.getTime(0);
+                any_handed = true;
+            }
+            // Already handed over pins can't be reordered anymore, these ones will be played late
+            for (size_t pin_i = 0; pin_i < talkie_pins.size() && talkie_pins.getTime(pin_i) < handed_time_ms; ++pin_i)
+                total_unordered++;
+            handed_time_ms = std::max(handed_time_ms, talkie_pins.getTime(talkie_pins.size() - 1));
+        }
+        TalkieTracer::instance().complete("hand over", trace_start_ns, TalkieTracer::now(),
+            "pins", static_cast<double>(talkie_pins.size()));
+        loaded_blocks.push_back(std::move(block));
+    }
+    blocks_condition.notify_all();
+}
+
+
+bool TalkieStream::waitLookAhead() {
+    std::unique_lock<std::mutex> lock(blocks_mutex);
+    blocks_condition.wait(lock, [this]() {
+        return finished || (any_handed && handed_time_ms - first_time_ms >= look_ahead_ms);
+    });
+    return any_handed;
+}
+
+
+TalkieStream::Block* TalkieStream::nextBlock() {
+    std::unique_lock<std::mutex> lock(blocks_mutex);
+    if (loaded_blocks.empty() && !finished) {
+        total_underruns++;
+        TalkieTracer::instance().instant("underrun");
+        blocks_condition.wait(lock, [this]() { return finished || !loaded_blocks.empty(); });
+    }
+    if (loaded_blocks.empty()) {
+        playing_block.reset();
+        return nullptr;
+    }
+    playing_block = std::move(loaded_blocks.front());
+    loaded_blocks.pop_front();
+    return playing_block.get();
+}
+
+
+bool TalkieStream::join() {
+    if (loader_thread.joinable()) {
+        loader_thread.join();
+    }
+    return loaded;
+}
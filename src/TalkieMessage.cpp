@@ -0,0 +1,216 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieMessage.hpp"
+#include "TalkieChecksum.hpp"
+
+#include <charconv>             // For std::to_chars
+#include <algorithm>            // For std::search
+#include <cmath>                // For std::llround
+
+
+// Strings nlohmann's dump() writes as they are, anything else is left for it to escape
+static bool is_plain(const char* data, size_t length) {
+    for (size_t byte_i = 0; byte_i < length; ++byte_i) {
+        const uint8_t byte = static_cast<uint8_t>(data[byte_i]);
+        if (byte < 0x20 || byte >= 0x80 || byte == '"' || byte == '\\')
+            return false;
+    }
+    return true;
+}
+
+
+void TalkieMessageWriter::begin() {
+    buffer.clear();
+    buffer += '{';
+}
+
+
+void TalkieMessageWriter::writeKey(const char* key, size_t length) {
+    if (buffer.size() > 1)
+        buffer += ',';
+    buffer += '"';
+    buffer.append(key, length);
+    buffer += "\":";
+}
+
+
+void TalkieMessageWriter::writeKey(const std::string& key) {
+    if (is_plain(key.data(), key.size())) {
+        writeKey(key.data(), key.size());
+    } else {
+        if (buffer.size() > 1)
+            buffer += ',';
+        buffer += nlohmann::json(key).dump();
+        buffer += ':';
+    }
+}
+
+
+void TalkieMessageWriter::writeNumber(uint64_t number) {
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    buffer.append(digits, result.ptr - digits);
+}
+
+
+void TalkieMessageWriter::writeNumber(int64_t number) {
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    buffer.append(digits, result.ptr - digits);
+}
+
+
+void TalkieMessageWriter::writeValue(const nlohmann::json& value) {
+    switch (value.type()) {
+        case nlohmann::json::value_t::string: {
+            const std::string& text = value.get_ref<const std::string&>();
+            if (is_plain(text.data(), text.size())) {
+                buffer += '"';
+                buffer += text;
+                buffer += '"';
+            } else {
+                buffer += value.dump();
+            }
+            break;
+        }
+        case nlohmann::json::value_t::number_unsigned:
+            writeNumber(value.get<uint64_t>());
+            break;
+        case nlohmann::json::value_t::number_integer:
+            writeNumber(value.get<int64_t>());
+            break;
+        case nlohmann::json::value_t::boolean:
+            buffer += value.get<bool>() ? "true" : "false";
+            break;
+        default:
+            // Floats keep nlohmann's shortest round trip format, the rest is rare
+            buffer += value.dump();
+            break;
+    }
+}
+
+
+void TalkieMessageWriter::writeChecksum() {
+    writeKey("c", 1);
+    checksum_position = buffer.size();
+    buffer += '0';      // The checksum is computed as if the "c" digits were a single '0'
+}
+
+
+const std::string& TalkieMessageWriter::finish() {
+    buffer += '}';
+    char digits[8];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), calculate_checksum(buffer));
+    buffer.replace(checksum_position, 1, digits, result.ptr - digits);
+    return buffer;
+}
+
+
+const std::string& TalkieMessageWriter::write(const nlohmann::json& talkie_message, uint32_t message_id) {
+    begin();
+    bool checksum_written = false;
+    bool id_written = false;
+    // Object keys are iterated sorted, "c" and "i" are merged in at their sorted place
+    for (auto item = talkie_message.begin(); item != talkie_message.end(); ++item) {
+        const std::string& key = item.key();
+        if (!checksum_written && key >= "c") {
+            writeChecksum();
+            checksum_written = true;
+            if (key == "c") continue;
+        }
+        if (!id_written && key >= "i") {
+            writeKey("i", 1);
+            writeNumber(static_cast<uint64_t>(message_id));
+            id_written = true;
+            if (key == "i") continue;
+        }
+        writeKey(key);
+        writeValue(item.value());
+    }
+    if (!checksum_written)
+        writeChecksum();
+    if (!id_written) {
+        writeKey("i", 1);
+        writeNumber(static_cast<uint64_t>(message_id));
+    }
+    return finish();
+}
+
+
+const std::string& TalkieMessageWriter::writeTempo(const nlohmann::json& json_talkie_clock) {
+    begin();
+    writeChecksum();                                        // checksum
+    writeKey("f", 1);
+    writeValue(json_talkie_clock.at("f"));                  // from
+    writeKey("i", 1);
+    writeNumber(static_cast<uint64_t>(0));                  // ID
+    writeKey("m", 1);
+    writeNumber(static_cast<uint64_t>(MessageCode::set));   // message type
+    writeKey("n", 1);
+    buffer += "\"bpm_10\"";                                 // parameter name
+    writeKey("v", 1);
+    writeValue(json_talkie_clock.at("bpm_10"));             // parameter value
+    return finish();
+}
+
+
+const std::string& TalkieMessageWriter::writeTempo(const char* tempo_message, size_t length, double time_scale) {
+    const nlohmann::json tempo = nlohmann::json::parse(tempo_message, tempo_message + length);
+    nlohmann::json json_talkie_clock;
+    json_talkie_clock["f"] = tempo.at("f");
+    // Tenths of a bpm already, rounding keeps it an integer
+    json_talkie_clock["bpm_10"] = static_cast<int64_t>(std::llround(tempo.at("v").get<double>() / time_scale));
+    return writeTempo(json_talkie_clock);
+}
+
+
+bool peekMessage(const char* talkie_message, size_t length, uint32_t &message_code, uint32_t &message_id) {
+    // The keys are written sorted and before any nested value of "v", so the first match is the top level one
+    auto peek_number = [talkie_message, length](const char* key, uint32_t &number) {
+        const char* last = talkie_message + length;
+        const char* found = std::search(talkie_message, last, key, key + 5);
+        if (found == last) {
+            return false;
+        }
+        const char* digit = found + 5;
+        if (digit == last || *digit < '0' || *digit > '9') {
+            return false;
+        }
+        number = 0;
+        for (; digit != last && *digit >= '0' && *digit <= '9'; ++digit)
+            number = number * 10 + static_cast<uint32_t>(*digit - '0');
+        return true;
+    };
+    return peek_number(",\"m\":", message_code) && peek_number(",\"i\":", message_id);
+}
+
+
+bool peekName(const char* talkie_message, size_t length, const char* &name, size_t &name_length) {
+    static const char key[] = ",\"n\":\"";
+    const char* last = talkie_message + length;
+    const char* found = std::search(talkie_message, last, key, key + sizeof(key) - 1);
+    if (found == last) {
+        return false;
+    }
+    name = found + sizeof(key) - 1;
+    const char* quote = std::find(name, last, '"');
+    if (quote == last || std::find(name, quote, '\\') != quote) {
+        return false;
+    }
+    name_length = static_cast<size_t>(quote - name);
+    return true;
+}
@@ -0,0 +1,220 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieRealTime.hpp"
+#include "TalkieSchedule.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <atomic>
+
+#ifdef _WIN32
+    #include <mmsystem.h>           // For timeBeginPeriod
+    #include <avrt.h>               // For the MMCSS registration
+    #pragma comment(lib, "winmm.lib")
+    #pragma comment(lib, "avrt.lib")
+#else
+    #include <pthread.h>
+    #include <sched.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>           // For mlockall
+#endif
+
+
+#ifndef _WIN32
+// Of the thread before it was pinned, only written before any thread is created by it
+static cpu_set_t unpinned_cpus;
+static std::atomic<bool> cpus_pinned{false};
+#endif
+
+
+
+TalkieRealTime::~TalkieRealTime() {
+#ifdef _WIN32
+    if (mmcss_task != nullptr) AvRevertMmThreadCharacteristics(mmcss_task);
+    if (timer_period_set) timeEndPeriod(1);
+    if (priority_saved) SetThreadPriority(GetCurrentThread(), saved_priority);
+    if (affinity_saved) SetThreadAffinityMask(GetCurrentThread(), saved_affinity);
+#else
+    if (memory_locked) munlockall();
+    if (latency_fd >= 0) close(latency_fd);
+    if (priority_saved) pthread_setschedparam(pthread_self(), saved_policy, &saved_param);
+    if (affinity_saved && pthread_setaffinity_np(pthread_self(), sizeof(saved_cpus), &saved_cpus) == 0)
+        cpus_pinned.store(false, std::memory_order_release);
+#endif
+}
+
+
+void TalkieRealTime::addStep(const std::string &name, bool applied, const std::string &detail) {
+    steps.push_back({name, applied, detail});
+    if (verbose) std::cout << "Real time " << name << ": " << (applied ? "" : "FAILED, ") << detail << std::endl;
+}
+
+
+bool TalkieRealTime::apply() {
+    bool all_applied = true;
+
+    if (options.cpu != REALTIME_NO_CPU) {
+        const int cpu = options.cpu == REALTIME_AUTO_CPU ? chooseRealTimeCpu() : options.cpu;
+#ifdef _WIN32
+        // The previous mask is returned, 0 if it failed
+        saved_affinity = cpu < 64 ? SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) : 0;
+        affinity_saved = saved_affinity != 0;
+        const bool pinned = affinity_saved;
+        addStep("affinity", pinned, pinned ? "core " + std::to_string(cpu)
+            : "core " + std::to_string(cpu) + ", error " + std::to_string(GetLastError()));
+#else
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        int error = EINVAL;
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpu_set);
+            affinity_saved = pthread_getaffinity_np(pthread_self(), sizeof(saved_cpus), &saved_cpus) == 0;
+            if (!cpus_pinned.load(std::memory_order_acquire))
+                unpinned_cpus = saved_cpus;
+            error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+            if (error == 0)
+                cpus_pinned.store(true, std::memory_order_release);
+            affinity_saved = affinity_saved && error == 0;
+        }
+        addStep("affinity", error == 0, error == 0 ? "core " + std::to_string(cpu)
+            : "core " + std::to_string(cpu) + ", " + strerror(error));
+#endif
+        all_applied = all_applied && steps.back().applied;
+    }
+
+    if (options.priority > 0) {
+#ifdef _WIN32
+        saved_priority = GetThreadPriority(GetCurrentThread());
+        const bool raised = SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+        priority_saved = raised && saved_priority != THREAD_PRIORITY_ERROR_RETURN;
+        addStep("priority", raised, raised ? "time critical" : "error " + std::to_string(GetLastError()));
+#else
+        // Clamped, the maximum would compete with the kernel threads that serve the network card
+        struct sched_param param;
+        param.sched_priority = std::max(sched_get_priority_min(SCHED_FIFO),
+            std::min(options.priority, sched_get_priority_max(SCHED_FIFO)));
+        const bool got_previous = pthread_getschedparam(pthread_self(), &saved_policy, &saved_param) == 0;
+        const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        priority_saved = got_previous && error == 0;
+        addStep("priority", error == 0, error == 0 ? "SCHED_FIFO " + std::to_string(param.sched_priority)
+            : "SCHED_FIFO " + std::to_string(param.sched_priority) + ", " + strerror(error));
+#endif
+        all_applied = all_applied && steps.back().applied;
+    }
+
+#ifdef _WIN32
+    if (options.timer_period) {
+        timer_period_set = timeBeginPeriod(1) == TIMERR_NOERROR;
+        addStep("timer period", timer_period_set, timer_period_set ? "1 ms" : "not available");
+        all_applied = all_applied && timer_period_set;
+    }
+    if (options.mmcss) {
+        DWORD task_index = 0;
+        mmcss_task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &task_index);
+        addStep("mmcss", mmcss_task != nullptr, mmcss_task != nullptr ? "Pro Audio task " + std::to_string(task_index)
+            : "error " + std::to_string(GetLastError()));
+        all_applied = all_applied && mmcss_task != nullptr;
+    }
+#else
+    if (options.low_latency) {
+        // Exit latency of the idle states, 0 keeps the cores awake for as long as the file is open
+        latency_fd = open("/dev/cpu_dma_latency", O_WRONLY | O_CLOEXEC);
+        const int32_t latency_us = 0;
+        bool requested = latency_fd >= 0 && write(latency_fd, &latency_us, sizeof(latency_us)) == sizeof(latency_us);
+        addStep("dma latency", requested, requested ? "0 us" : std::string(strerror(errno)));
+        if (!requested && latency_fd >= 0) {
+            close(latency_fd);
+            latency_fd = -1;
+        }
+        all_applied = all_applied && requested;
+    }
+#endif
+
+    return all_applied;
+}
+
+
+// Not inlined, so the touched frame is below the caller one, where the playing goes
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+static void prefaultStack() {
+    volatile char stack_pages[REALTIME_STACK_PREFAULT_KB * 1024];
+    for (size_t byte_i = 0; byte_i < sizeof(stack_pages); byte_i += SCHEDULE_PAGE_BYTES)
+        stack_pages[byte_i] = 0;
+}
+
+
+bool TalkieRealTime::lockMemory(const std::vector<const TalkieSchedule*> &talkie_schedules) {
+    if (!options.lock_memory) {
+        return true;
+    }
+    size_t total_bytes = 0;
+    for (const TalkieSchedule *talkie_schedule : talkie_schedules)
+        total_bytes += talkie_schedule->prefault();
+    prefaultStack();
+    const std::string prefaulted = std::to_string(total_bytes / 1024) + " KB of schedules and "
+        + std::to_string(REALTIME_STACK_PREFAULT_KB) + " KB of stack pre-faulted";
+#ifdef _WIN32
+    // The working set isn't locked, the pages are only made resident
+    addStep("memory", true, prefaulted + ", not locked");
+#else
+    // Only what is already mapped, MCL_FUTURE would make any later allocation fail past the lock limit
+    memory_locked = memory_locked || mlockall(MCL_CURRENT) == 0;
+    addStep("memory", memory_locked, memory_locked ? prefaulted + " and locked"
+        : prefaulted + ", not locked: " + strerror(errno));
+#endif
+    return steps.back().applied;
+}
+
+
+
+
+int chooseRealTimeCpu() {
+    const int last_cpu = std::max(1, static_cast<int>(std::thread::hardware_concurrency())) - 1;
+#ifndef _WIN32
+    // Like "2-3,7", the last one is taken
+    std::ifstream isolated_file("/sys/devices/system/cpu/isolated");
+    std::string isolated;
+    if (std::getline(isolated_file, isolated)) {
+        const size_t last_digits = isolated.find_last_of("0123456789");
+        if (last_digits != std::string::npos) {
+            size_t first_digit = last_digits;
+            while (first_digit > 0 && isdigit(static_cast<unsigned char>(isolated[first_digit - 1])))
+                first_digit--;
+            return std::stoi(isolated.substr(first_digit, last_digits - first_digit + 1));
+        }
+    }
+#endif
+    return last_cpu;
+}
+
+
+void unpinThread() {
+#ifndef _WIN32
+    if (cpus_pinned.load(std::memory_order_acquire))
+        pthread_setaffinity_np(pthread_self(), sizeof(unpinned_cpus), &unpinned_cpus);
+#endif
+    // Windows threads start with the process affinity, not with the one of their creator
+}
@@ -0,0 +1,97 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieRegistry.hpp"
+
+
+
+TalkieRegistry::TalkieRegistry(TalkieSocket * const socket, bool verbose)
+            : talkie_socket(socket), verbose(verbose) {
+    ids_by_channel.fill(TALKIE_NO_DEVICE);
+}
+
+
+TalkieRegistry::~TalkieRegistry() { }
+
+
+uint32_t TalkieRegistry::add(int target_port, const std::string* name, int channel) {
+    const uint32_t device_id = total_devices.load(std::memory_order_relaxed);
+    if (device_id >= REGISTRY_CHUNK_DEVICES * REGISTRY_MAXIMUM_CHUNKS) {
+        std::cerr << "Too many devices, the device registry is full!" << std::endl;
+        return TALKIE_NO_DEVICE;
+    }
+    auto &device_chunk = device_chunks[device_id / REGISTRY_CHUNK_DEVICES];
+    if (!device_chunk) {
+        device_chunk.reset(new DeviceSlot[REGISTRY_CHUNK_DEVICES]);
+    }
+    DeviceSlot &device_slot = device_chunk[device_id % REGISTRY_CHUNK_DEVICES];
+    device_slot.device.reset(new TalkieDevice(talkie_socket, target_port, verbose,
+        name != nullptr, channel == REGISTRY_BROADCAST));
+    device_slot.name = name;
+    device_slot.channel = channel;
+    // Published only once the slot is whole
+    total_devices.store(device_id + 1, std::memory_order_release);
+    return device_id;
+}
+
+
+uint32_t TalkieRegistry::addName(const std::string &name, int target_port) {
+    auto id_it = ids_by_name.find(name);
+    if (id_it != ids_by_name.end()) {
+        return id_it->second;
+    }
+    // Interned first, the slot points to the key, which never moves
+    auto interned = ids_by_name.emplace(name, TALKIE_NO_DEVICE).first;
+    const uint32_t device_id = add(target_port, &interned->first, REGISTRY_NAMED);
+    if (device_id != TALKIE_NO_DEVICE) {
+        interned->second = device_id;
+        total_named++;
+    } else {
+        ids_by_name.erase(interned);
+    }
+    return device_id;
+}
+
+
+uint32_t TalkieRegistry::addChannel(uint8_t channel, int target_port) {
+    if (ids_by_channel[channel] != TALKIE_NO_DEVICE) {
+        return ids_by_channel[channel];
+    }
+    const uint32_t device_id = add(target_port, nullptr, channel);
+    if (device_id != TALKIE_NO_DEVICE) {
+        ids_by_channel[channel] = device_id;
+    }
+    return device_id;
+}
+
+
+uint32_t TalkieRegistry::addBroadcast(int target_port) {
+    auto id_it = ids_by_broadcast_port.find(target_port);
+    if (id_it != ids_by_broadcast_port.end()) {
+        return id_it->second;
+    }
+    const uint32_t device_id = add(target_port, nullptr, REGISTRY_BROADCAST);
+    if (device_id != TALKIE_NO_DEVICE) {
+        ids_by_broadcast_port[target_port] = device_id;
+    }
+    return device_id;
+}
+
+
+uint32_t TalkieRegistry::findName(const std::string &name) const {
+    auto id_it = ids_by_name.find(name);
+    return id_it != ids_by_name.end() ? id_it->second : TALKIE_NO_DEVICE;
+}
@@ -0,0 +1,240 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieSchedule.hpp"
+#include "TalkieMessage.hpp"
+
+#include <numeric>              // For std::iota
+#include <algorithm>
+#include <queue>
+#include <functional>             // For std::greater
+#include <unordered_map>
+
+
+
+void TalkieSchedule::reserve(size_t total_pins, size_t total_bytes) {
+    times_ms.reserve(total_pins);
+    device_ids.reserve(total_pins);
+    message_offsets.reserve(total_pins);
+    message_lengths.reserve(total_pins);
+    if (external_arena == nullptr)
+        messages_arena.reserve(total_bytes);
+}
+
+
+void TalkieSchedule::clear() {
+    times_ms.clear();
+    device_ids.clear();
+    message_offsets.clear();
+    message_lengths.clear();
+    messages_arena.clear();
+    external_arena = nullptr;
+    external_size = 0;
+}
+
+
+void TalkieSchedule::add(double time_ms, uint32_t device_id, const char* message, size_t length) {
+    if (external_arena != nullptr) {
+        // Messages can't be appended to an arena that isn't owned, so it becomes owned
+        messages_arena.assign(external_arena, external_size);
+        external_arena = nullptr;
+        external_size = 0;
+    }
+    times_ms.push_back(time_ms);
+    device_ids.push_back(device_id);
+    message_offsets.push_back(messages_arena.size());
+    message_lengths.push_back(static_cast<uint32_t>(length));
+    messages_arena.append(message, length);
+}
+
+
+void TalkieSchedule::attachArena(const char* arena, size_t size) {
+    external_arena = arena;
+    external_size = size;
+}
+
+
+void TalkieSchedule::addOffset(double time_ms, uint32_t device_id, uint64_t offset, uint32_t length) {
+    times_ms.push_back(time_ms);
+    device_ids.push_back(device_id);
+    message_offsets.push_back(offset);
+    message_lengths.push_back(length);
+}
+
+
+void TalkieSchedule::sort() {
+    if (std::is_sorted(times_ms.begin(), times_ms.end())) {
+        return;
+    }
+
+    // Sorts a permutation once and then applies it to every array (messages stay in place)
+    std::vector<size_t> permutation(times_ms.size());
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::stable_sort(permutation.begin(), permutation.end(), [this](size_t a, size_t b) {
+        return times_ms[a] < times_ms[b];
+    });
+
+    auto apply = [&permutation](auto &array) {
+        typename std::remove_reference<decltype(array)>::type sorted_array;
+        sorted_array.reserve(array.size());
+        for (size_t pin_i : permutation)
+            sorted_array.push_back(array[pin_i]);
+        array.swap(sorted_array);
+    };
+    apply(times_ms);
+    apply(device_ids);
+    apply(message_offsets);
+    apply(message_lengths);
+}
+
+
+void TalkieSchedule::merge(const std::vector<const TalkieSchedule*> &sorted_schedules) {
+    size_t total_pins = size();
+    size_t total_bytes = messages_arena.size();
+    for (const TalkieSchedule *sorted_schedule : sorted_schedules) {
+        total_pins += sorted_schedule->size();
+        for (size_t pin_i = 0; pin_i < sorted_schedule->size(); ++pin_i)
+            total_bytes += sorted_schedule->getLength(pin_i);
+    }
+    reserve(total_pins, total_bytes);
+
+    // Heads ordered by time and then by schedule, so ties keep the schedules order
+    using Head = std::pair<double, size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    std::vector<size_t> cursors(sorted_schedules.size(), 0);
+    for (size_t schedule_i = 0; schedule_i < sorted_schedules.size(); ++schedule_i) {
+        if (!sorted_schedules[schedule_i]->empty())
+            heads.push({sorted_schedules[schedule_i]->getTime(0), schedule_i});
+    }
+    while (!heads.empty()) {
+        const size_t schedule_i = heads.top().second;
+        heads.pop();
+        const TalkieSchedule &sorted_schedule = *sorted_schedules[schedule_i];
+        const size_t pin_i = cursors[schedule_i]++;
+        add(sorted_schedule.getTime(pin_i), sorted_schedule.getDeviceId(pin_i),
+            sorted_schedule.getMessage(pin_i), sorted_schedule.getLength(pin_i));
+        if (pin_i + 1 < sorted_schedule.size())
+            heads.push({sorted_schedule.getTime(pin_i + 1), schedule_i});
+    }
+}
+
+
+size_t TalkieSchedule::coalesce(double window_ms, const TalkieRegistry &talkie_registry) {
+    if (window_ms <= 0) {
+        return 0;
+    }
+    struct Window {
+        double first_time_ms;
+        size_t last_pin_i;      // The one kept so far
+    };
+    std::unordered_map<std::string, Window> windows;  // By device id and "n"
+    std::vector<bool> superseded(times_ms.size(), false);
+    size_t total_superseded = 0;
+    std::string window_key;
+    for (size_t pin_i = 0; pin_i < times_ms.size(); ++pin_i) {
+        const uint32_t device_id = device_ids[pin_i];
+        uint32_t message_code, message_id;
+        const char* name;
+        size_t name_length;
+        // Tempos (broadcast set messages) are left alone, the tempo map keeps every one of them too
+        if (device_id == TALKIE_NO_DEVICE || talkie_registry.isBroadcast(device_id)
+                || !peekMessage(getMessage(pin_i), getLength(pin_i), message_code, message_id)
+                || message_code != MessageCode::set
+                || !peekName(getMessage(pin_i), getLength(pin_i), name, name_length)) {
+            continue;
+        }
+        window_key.assign(reinterpret_cast<const char*>(&device_id), sizeof(device_id));
+        window_key.append(name, name_length);
+        auto window = windows.find(window_key);
+        if (window != windows.end() && times_ms[pin_i] - window->second.first_time_ms < window_ms) {
+            superseded[window->second.last_pin_i] = true;
+            total_superseded++;
+            talkie_registry.getDevice(device_id).getCounters().countCoalesced();
+            window->second.last_pin_i = pin_i;
+        } else {
+            windows[window_key] = {times_ms[pin_i], pin_i};
+        }
+    }
+    if (total_superseded == 0) {
+        return 0;
+    }
+
+    // Compacted in place, the messages stay where they are in the arena (owned or not)
+    size_t kept_i = 0;
+    for (size_t pin_i = 0; pin_i < times_ms.size(); ++pin_i) {
+        if (superseded[pin_i])
+            continue;
+        times_ms[kept_i] = times_ms[pin_i];
+        device_ids[kept_i] = device_ids[pin_i];
+        message_offsets[kept_i] = message_offsets[pin_i];
+        message_lengths[kept_i] = message_lengths[pin_i];
+        kept_i++;
+    }
+    times_ms.resize(kept_i);
+    device_ids.resize(kept_i);
+    message_offsets.resize(kept_i);
+    message_lengths.resize(kept_i);
+    return total_superseded;
+}
+
+
+size_t TalkieSchedule::timePin(double time_ms) const {
+    return std::lower_bound(times_ms.begin(), times_ms.end(), time_ms) - times_ms.begin();
+}
+
+
+size_t TalkieSchedule::sameTimeEnd(size_t pin_i) const {
+    const double time_ms = times_ms[pin_i];
+    size_t pin_end = pin_i + 1;
+    while (pin_end < times_ms.size() && times_ms[pin_end] == time_ms)
+        pin_end++;
+    return pin_end;
+}
+
+
+size_t TalkieSchedule::largestSameTime() const {
+    size_t largest = 0;
+    for (size_t pin_i = 0; pin_i < times_ms.size(); ) {
+        const size_t pin_end = sameTimeEnd(pin_i);
+        largest = std::max(largest, pin_end - pin_i);
+        pin_i = pin_end;
+    }
+    return largest;
+}
+
+
+void TalkieSchedule::pluckTooth(size_t pin_i, const TalkieRegistry &talkie_registry) const {
+    if (device_ids[pin_i] != TALKIE_NO_DEVICE)
+        talkie_registry.getDevice(device_ids[pin_i]).sendMessage(getMessage(pin_i), getLength(pin_i));
+}
+
+
+size_t TalkieSchedule::prefault() const {
+    volatile char page_sink = 0;
+    size_t total_bytes = 0;
+    auto touch = [&page_sink, &total_bytes](const void* data, size_t bytes) {
+        const char* first_byte = static_cast<const char*>(data);
+        for (size_t byte_i = 0; byte_i < bytes; byte_i += SCHEDULE_PAGE_BYTES)
+            page_sink = page_sink + first_byte[byte_i];
+        total_bytes += bytes;
+    };
+    touch(times_ms.data(), times_ms.size() * sizeof(double));
+    touch(device_ids.data(), device_ids.size() * sizeof(uint32_t));
+    touch(message_offsets.data(), message_offsets.size() * sizeof(uint64_t));
+    touch(message_lengths.data(), message_lengths.size() * sizeof(uint32_t));
+    touch(arena(), external_arena != nullptr ? external_size : messages_arena.size());
+    return total_bytes;
+}
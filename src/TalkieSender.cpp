@@ -0,0 +1,182 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieSender.hpp"
+
+#include <algorithm>
+
+
+
+bool TalkieSendQueue::push(long long due_ns, const char* message, size_t length) {
+    const size_t push_i = tail.load(std::memory_order_relaxed);
+    if (push_i - head.load(std::memory_order_acquire) >= SEND_QUEUE_CAPACITY) {
+        return false;
+    }
+    Entry &entry = entries[push_i & (SEND_QUEUE_CAPACITY - 1)];
+    entry.due_ns = due_ns;
+    entry.length = static_cast<uint32_t>(length);
+    if (length > SEND_MESSAGE_BYTES) {
+        entry.long_message.assign(message, length);
+    } else {
+        std::memcpy(entry.message, message, length);
+    }
+    // Sequentially consistent, so the worker can't go to sleep missing it (it checks after flagging)
+    tail.store(push_i + 1, std::memory_order_seq_cst);
+    return true;
+}
+
+
+const TalkieSendQueue::Entry* TalkieSendQueue::front() const {
+    const size_t front_i = head.load(std::memory_order_relaxed);
+    if (front_i == tail.load(std::memory_order_seq_cst)) {
+        return nullptr;
+    }
+    return &entries[front_i & (SEND_QUEUE_CAPACITY - 1)];
+}
+
+
+
+TalkieSenders::TalkieSenders(TalkieSocket &talkie_socket, double late_drop_ms, double rate_limit, double burst)
+            : talkie_socket(talkie_socket), late_drop_ns(static_cast<long long>(late_drop_ms * 1000000)),
+              tokens_per_ns(std::max(0.0, rate_limit) / 1e9), burst_tokens(std::max(1.0, burst)) {
+    addLanes(talkie_socket.getRegistry().size());
+}
+
+
+TalkieSenders::~TalkieSenders() {
+    running.store(false, std::memory_order_seq_cst);
+    for (size_t worker_i = 0; worker_i < total_workers; ++worker_i) {
+        Worker &worker = *workers[worker_i];
+        {
+            std::lock_guard<std::mutex> lock(worker.worker_mutex);
+            worker.worker_condition.notify_one();
+        }
+        worker.worker_thread.join();
+    }
+}
+
+
+void TalkieSenders::addLanes(size_t total_devices) {
+    for (size_t device_i = total_lanes.load(std::memory_order_relaxed); device_i < total_devices; ++device_i) {
+        auto &lane_chunk = lane_chunks[device_i / REGISTRY_CHUNK_DEVICES];
+        if (!lane_chunk) {
+            lane_chunk.reset(new std::unique_ptr<Lane>[REGISTRY_CHUNK_DEVICES]);
+        }
+        Lane *lane = new Lane();
+        lane->token_bucket = {burst_tokens, TalkieCounters::clockNs(), false};
+        lane_chunk[device_i % REGISTRY_CHUNK_DEVICES].reset(lane);
+        // Published before its worker may look for it
+        total_lanes.store(static_cast<uint32_t>(device_i + 1), std::memory_order_release);
+        if (device_i < SEND_MAXIMUM_WORKERS) {
+            // Started here, they inherit the real time scheduling of the playing thread
+            workers[device_i].reset(new Worker(static_cast<uint32_t>(device_i)));
+            workers[device_i]->worker_thread = std::thread(&TalkieSenders::workerLoop, this, std::ref(*workers[device_i]));
+            total_workers++;
+        }
+    }
+}
+
+
+void TalkieSenders::send(uint32_t device_id, const char* message, size_t length) {
+    if (device_id >= total_lanes.load(std::memory_order_relaxed)) {
+        addLanes(device_id + 1);    // Added to the registry while playing
+    }
+    if (!getLane(device_id).send_queue.push(TalkieCounters::clockNs(), message, length)) {
+        talkie_socket.getDevice(device_id).getCounters().countFullDrop();   // The device is too far behind, it doesn't stop the others
+        return;
+    }
+    Worker &worker = *workers[device_id % SEND_MAXIMUM_WORKERS];
+    if (worker.sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(worker.worker_mutex);
+        worker.worker_condition.notify_one();
+    }
+}
+
+
+bool TalkieSenders::takeToken(uint32_t device_id, Lane &lane, long long now_ns, long long &ready_ns) {
+    TokenBucket &token_bucket = lane.token_bucket;
+    token_bucket.tokens = std::min(burst_tokens,
+        token_bucket.tokens + static_cast<double>(now_ns - token_bucket.refill_ns) * tokens_per_ns);
+    token_bucket.refill_ns = now_ns;
+    if (token_bucket.tokens >= 1.0) {
+        token_bucket.tokens -= 1.0;
+        token_bucket.front_deferred = false;
+        return true;
+    }
+    if (!token_bucket.front_deferred) {
+        talkie_socket.getDevice(device_id).getCounters().countDeferred();
+        token_bucket.front_deferred = true;
+    }
+    const long long token_ns = now_ns + static_cast<long long>((1.0 - token_bucket.tokens) / tokens_per_ns) + 1;
+    if (ready_ns == 0 || token_ns < ready_ns)
+        ready_ns = token_ns;
+    return false;
+}
+
+
+bool TalkieSenders::drainQueues(Worker &worker, long long &ready_ns) {
+    bool drained_any = false;
+    ready_ns = 0;
+    const uint32_t lanes = total_lanes.load(std::memory_order_acquire);
+    for (uint32_t device_id = worker.first_device; device_id < lanes; device_id += SEND_MAXIMUM_WORKERS) {
+        Lane &lane = getLane(device_id);
+        TalkieDevice &talkie_device = talkie_socket.getDevice(device_id);
+        while (const TalkieSendQueue::Entry *entry = lane.send_queue.front()) {
+            const long long now_ns = TalkieCounters::clockNs();
+            if (late_drop_ns > 0 && now_ns - entry->due_ns > late_drop_ns) {
+                talkie_device.getCounters().countLateDrop();
+                lane.token_bucket.front_deferred = false;
+            } else if (tokens_per_ns > 0 && !takeToken(device_id, lane, now_ns, ready_ns)) {
+                break;  // Left queued, the next devices of the worker aren't held by it
+            } else {
+                talkie_device.sendMessage(entry->data(), entry->length);
+            }
+            lane.send_queue.pop();
+            drained_any = true;
+        }
+    }
+    return drained_any;
+}
+
+
+void TalkieSenders::workerLoop(Worker &worker) {
+    unpinThread();  // Keeps the real time priority, but not the core of the play thread
+    long long ready_ns = 0;
+    while (true) {
+        if (drainQueues(worker, ready_ns)) {
+            continue;
+        }
+        if (ready_ns == 0 && !running.load(std::memory_order_seq_cst)) {
+            break;  // Nothing left to send
+        }
+        std::unique_lock<std::mutex> lock(worker.worker_mutex);
+        worker.sleeping.store(true, std::memory_order_seq_cst);
+        // The deferred ones are pending too, but they can only be sent once ready_ns is reached
+        bool pending = false;
+        const uint32_t lanes = total_lanes.load(std::memory_order_acquire);
+        for (uint32_t device_id = worker.first_device; !pending && device_id < lanes; device_id += SEND_MAXIMUM_WORKERS) {
+            const Lane &lane = getLane(device_id);
+            pending = !lane.send_queue.empty() && !lane.token_bucket.front_deferred;
+        }
+        if (!pending && ready_ns != 0) {
+            worker.worker_condition.wait_for(lock, std::chrono::nanoseconds(
+                std::max(0LL, ready_ns - TalkieCounters::clockNs())));
+        } else if (!pending && running.load(std::memory_order_seq_cst)) {
+            worker.worker_condition.wait_for(lock, std::chrono::milliseconds(SEND_IDLE_WAIT_MS));
+        }
+        worker.sleeping.store(false, std::memory_order_relaxed);
+    }
+}
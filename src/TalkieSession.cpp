@@ -0,0 +1,423 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieSession.hpp"
+#include "TalkieLoader.hpp"
+#include "TalkieTracer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+
+TalkieSession::TalkieSession(bool verbose, const PlayOptions &play_options)
+            : verbose(verbose), play_options(play_options), talkie_socket(verbose, play_options.talkie_port, play_options.interfaces), talkie_timer(play_options.timer_mode) {
+
+    if (verbose) std::cout << "JsonTalkiePlayer version: " << VERSION << std::endl;
+
+    socket_ready = talkie_socket.initialize();
+    if (socket_ready) {
+        disableBackgroundThrottling();
+        if (play_options.timer_mode == TimerMode::hybrid) {
+            talkie_timer.calibrate();
+        }
+        // Echoes keep updating the devices IPs between plays too
+        talkie_socket.startReceiver();
+    }
+}
+
+
+TalkieSession::~TalkieSession() {
+    stop();
+    if (transport_thread.joinable()) {
+        transport_thread.join();
+    }
+    talkie_socket.stopReceiver();
+}
+
+
+void TalkieSession::commit(std::unique_ptr<SessionList> session_list) {
+    {
+        // Sorted once, same time pins keep their file order
+        TalkieTraceScope trace_scope("sort");
+        session_list->talkie_pins.sort();
+        session_list->tempo_pins.sort();
+    }
+    if (play_options.coalesce_ms > 0) {
+        TalkieTraceScope trace_scope("coalesce");
+        session_list->play_reporting.total_coalesced =
+            session_list->talkie_pins.coalesce(play_options.coalesce_ms, talkie_socket.getRegistry());
+    }
+    session_list->tempo_map.build(session_list->tempo_pins);
+    if (verbose) std::cout << "Loaded " << session_list->talkie_pins.size() << " pins to be played" << std::endl;
+    std::lock_guard<std::mutex> lists_lock(lists_mutex);
+    loaded_list = std::move(session_list);
+}
+
+
+bool TalkieSession::load(const char* json_str, int delay_ms) {
+    return loadBuffer(json_str, std::strlen(json_str), delay_ms);
+}
+
+
+bool TalkieSession::loadBuffer(const char* json_data, size_t json_length, int delay_ms) {
+    std::unique_ptr<SessionList> session_list(new SessionList());
+    auto data_processing_start = std::chrono::high_resolution_clock::now();
+    {
+        TalkieLoader talkie_loader(talkie_socket, session_list->talkie_pins, session_list->tempo_pins,
+            session_list->play_reporting, verbose);
+        if (!talkie_loader.loadBuffer(json_data, json_length)) {
+            return false;
+        }
+    }
+    auto data_processing_finish = std::chrono::high_resolution_clock::now();
+    session_list->play_reporting.json_processing = std::chrono::duration_cast<std::chrono::milliseconds>(
+        data_processing_finish - data_processing_start).count();
+    session_list->delay_ms = delay_ms;
+    commit(std::move(session_list));
+    return true;
+}
+
+
+bool TalkieSession::loadFiles(const std::vector<std::string> &json_paths, int delay_ms) {
+    if (!play_options.cache_dir.empty()) {
+        TalkieCache talkie_cache(play_options.cache_dir, play_options.cache_mb, verbose);
+        const std::string compiled_path = talkie_cache.compiledPath(json_paths);
+        if (!compiled_path.empty()) {
+            return loadCompiled(compiled_path.c_str(), delay_ms);
+        }
+    }
+    std::unique_ptr<SessionList> session_list(new SessionList());
+    auto data_processing_start = std::chrono::high_resolution_clock::now();
+    {
+        TalkieLoader talkie_loader(talkie_socket, session_list->talkie_pins, session_list->tempo_pins,
+            session_list->play_reporting, verbose);
+        if (!talkie_loader.loadFiles(json_paths)) {
+            return false;
+        }
+    }
+    auto data_processing_finish = std::chrono::high_resolution_clock::now();
+    session_list->play_reporting.json_processing = std::chrono::duration_cast<std::chrono::milliseconds>(
+        data_processing_finish - data_processing_start).count();
+    session_list->delay_ms = delay_ms;
+    commit(std::move(session_list));
+    return true;
+}
+
+
+bool TalkieSession::loadCompiled(const char* compiled_path, int delay_ms) {
+    std::unique_ptr<SessionList> session_list(new SessionList());
+    auto data_processing_start = std::chrono::high_resolution_clock::now();
+    if (!session_list->compiled.open(compiled_path, verbose)
+            || !loadCompiledPins(session_list->compiled, talkie_socket,
+                session_list->talkie_pins, session_list->tempo_pins, verbose)) {
+        std::cerr << "Unable to load the compiled play list: " << compiled_path << std::endl;
+        return false;
+    }
+    session_list->play_reporting.total_validated = session_list->talkie_pins.size();
+    auto data_processing_finish = std::chrono::high_resolution_clock::now();
+    session_list->play_reporting.json_processing = std::chrono::duration_cast<std::chrono::milliseconds>(
+        data_processing_finish - data_processing_start).count();
+    session_list->delay_ms = delay_ms + session_list->compiled.header()->delay_ms;
+    commit(std::move(session_list));
+    return true;
+}
+
+
+bool TalkieSession::start() {
+    std::lock_guard<std::mutex> transport_lock(transport_mutex);
+    if (transport_state == TransportState::paused) {
+        pause_requested = false;
+        transport_state = TransportState::playing;
+        transport_condition.notify_all();
+        return true;
+    }
+    if (transport_state == TransportState::playing) {
+        return true;
+    }
+    if (!socket_ready) {
+        return false;
+    }
+    if (transport_thread.joinable()) {
+        transport_thread.join();    // Already done with the previous play list
+    }
+    {
+        std::lock_guard<std::mutex> lists_lock(lists_mutex);
+        if (loaded_list) {
+            playing_list = std::move(loaded_list);   // The previous one is released here
+        }
+    }
+    if (!playing_list) {
+        std::cerr << "Nothing was loaded to be played" << std::endl;
+        return false;
+    }
+    stop_requested = false;
+    pause_requested = false;
+    seek_time_ms = NAN;
+    transport_state = TransportState::playing;
+    transport_thread = std::thread(&TalkieSession::playTransport, this);
+    return true;
+}
+
+
+void TalkieSession::pause() {
+    std::lock_guard<std::mutex> transport_lock(transport_mutex);
+    if (transport_state == TransportState::playing) {
+        TalkieTracer::instance().instant("pause");
+        pause_requested = true;
+        talkie_timer.interrupt();
+    }
+}
+
+
+void TalkieSession::seek(double time_ms) {
+    std::lock_guard<std::mutex> transport_lock(transport_mutex);
+    time_ms = std::max(time_ms, 0.0);
+    if (transport_state == TransportState::stopped) {
+        position_ms = time_ms;
+    } else {
+        TalkieTracer::instance().instant("seek", "time_ms", time_ms);
+        seek_time_ms = time_ms;
+        talkie_timer.interrupt();
+        transport_condition.notify_all();
+    }
+}
+
+
+void TalkieSession::stop() {
+    std::lock_guard<std::mutex> transport_lock(transport_mutex);
+    if (transport_state == TransportState::stopped) {
+        position_ms = 0.0;
+    } else {
+        TalkieTracer::instance().instant("stop");
+        stop_requested = true;
+        talkie_timer.interrupt();
+        transport_condition.notify_all();
+    }
+}
+
+
+void TalkieSession::wait() {
+    std::unique_lock<std::mutex> transport_lock(transport_mutex);
+    transport_condition.wait(transport_lock, [this]() { return transport_state == TransportState::stopped; });
+}
+
+
+int TalkieSession::play() {
+    if (!start()) {
+        return 1;
+    }
+    wait();
+    return 0;
+}
+
+
+std::string TalkieSession::getReportJson() {
+    std::lock_guard<std::mutex> transport_lock(transport_mutex);
+    return reportJson(play_reporting).dump();
+}
+
+
+std::string TalkieSession::getDevicesJson() {
+    return talkie_socket.devicesJson().dump();
+}
+
+
+TransportState TalkieSession::getState() {
+    std::lock_guard<std::mutex> transport_lock(transport_mutex);
+    return transport_state;
+}
+
+
+double TalkieSession::getPosition() {
+    std::lock_guard<std::mutex> transport_lock(transport_mutex);
+    return currentPosition();
+}
+
+
+double TalkieSession::currentPosition() const {
+    if (transport_state == TransportState::playing && !pause_requested) {
+        return position_ms + std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - position_clock).count();
+    }
+    return position_ms;
+}
+
+
+TalkieSession::SessionList* TalkieSession::currentList() const {
+    // While stopped the next start() plays the last one loaded, if any
+    if (transport_state == TransportState::stopped && loaded_list) {
+        return loaded_list.get();
+    }
+    return playing_list.get();
+}
+
+
+PlayOptions TalkieSession::listOptions(const SessionList &session_list) const {
+    PlayOptions list_options = play_options;
+    list_options.delay_ms = session_list.delay_ms;
+    return list_options;
+}
+
+
+void TalkieSession::setDelay(double delay_ms) {
+    std::lock_guard<std::mutex> transport_lock(transport_mutex);
+    std::lock_guard<std::mutex> lists_lock(lists_mutex);
+    SessionList *session_list = currentList();
+    if (session_list != nullptr) {
+        session_list->delay_ms = delay_ms;
+    }
+}
+
+
+void TalkieSession::seekBeat(double beat) {
+    double time_ms = 0.0;
+    {
+        std::lock_guard<std::mutex> transport_lock(transport_mutex);
+        std::lock_guard<std::mutex> lists_lock(lists_mutex);
+        const SessionList *session_list = currentList();
+        if (session_list == nullptr) {
+            return;
+        }
+        time_ms = listOptions(*session_list).playTime(session_list->tempo_map.beatToMs(beat));
+    }
+    seek(time_ms);
+}
+
+
+double TalkieSession::getBeat() {
+    std::lock_guard<std::mutex> transport_lock(transport_mutex);
+    std::lock_guard<std::mutex> lists_lock(lists_mutex);
+    const SessionList *session_list = currentList();
+    if (session_list == nullptr) {
+        return 0.0;
+    }
+    const double score_ms = listOptions(*session_list).scoreTime(currentPosition());
+    return session_list->tempo_map.msToBeat(score_ms);     // Negative while the delay lasts
+}
+
+
+double TalkieSession::getBpm() {
+    std::lock_guard<std::mutex> transport_lock(transport_mutex);
+    std::lock_guard<std::mutex> lists_lock(lists_mutex);
+    const SessionList *session_list = currentList();
+    if (session_list == nullptr) {
+        return TEMPO_DEFAULT_BPM_10 / 10.0;
+    }
+    // As played, so a slower time scale gives fewer beats per minute
+    const double score_ms = listOptions(*session_list).scoreTime(currentPosition());
+    return session_list->tempo_map.getBpm(score_ms) / play_options.time_scale;
+}
+
+
+// The play thread, each pause or seek ends the current playSchedules and a later one resumes from there
+void TalkieSession::playTransport() {
+
+    // Set real-time scheduling, undone once this play ends
+    TalkieRealTime talkie_realtime(play_options.realtime, verbose);
+    talkie_realtime.apply();
+
+    TalkieSchedule &talkie_pins = playing_list->talkie_pins;
+    talkie_realtime.lockMemory({&talkie_pins});
+
+    PlayReporting session_reporting;
+    session_reporting.realtime = talkie_realtime.getSteps();
+    session_reporting.json_processing = playing_list->play_reporting.json_processing;
+    session_reporting.total_validated = playing_list->play_reporting.total_validated;
+    session_reporting.total_incorrect = playing_list->play_reporting.total_incorrect;
+    session_reporting.total_coalesced = playing_list->play_reporting.total_coalesced;
+
+    if (play_options.discovery_s > 0)   // Devices known from earlier plays aren't probed again
+        session_reporting.discovery = discoverDevices(talkie_socket, play_options.discovery_s, play_options.address_cache, verbose);
+    if (verbose) std::cout << std::endl;
+    reportData(session_reporting, talkie_pins.size(), verbose);
+    if (verbose) std::cout << "Devices with a known IP: " << talkie_socket.totalUpdates()
+        << " of " << talkie_socket.totalDevices() << std::endl;
+
+    std::unique_lock<std::mutex> transport_lock(transport_mutex);
+    double start_time_ms = position_ms;     // Of the play time line
+    size_t pin_i = 0;
+    bool first_play = true;
+    bool repositioned = true;           // Its first pin and tempo are the ones of start_time_ms
+
+    while (true) {
+        talkie_timer.clearInterrupt();
+        if (stop_requested) {
+            break;
+        }
+        // The delay may have changed meanwhile
+        const PlayOptions list_options = listOptions(*playing_list);
+        if (!std::isnan(seek_time_ms)) {
+            start_time_ms = seek_time_ms;
+            seek_time_ms = NAN;
+            repositioned = true;
+        }
+        if (repositioned) {
+            pin_i = talkie_pins.timePin(list_options.scoreTime(start_time_ms));
+        }
+        position_ms = start_time_ms;
+        if (pause_requested) {
+            transport_state = TransportState::paused;
+            transport_condition.wait(transport_lock, [this]() {
+                return !pause_requested || stop_requested || !std::isnan(seek_time_ms);
+            });
+            continue;
+        }
+        if (pin_i >= talkie_pins.size()) {
+            break;  // The end (or a seek past it)
+        }
+        transport_state = TransportState::playing;
+        position_clock = std::chrono::steady_clock::now();
+        transport_lock.unlock();
+
+        if (repositioned) {
+            // The earlier tempo pins were skipped over, later ones still play in the time line
+            broadcastStartTempo(talkie_socket, playing_list->tempo_pins, list_options.scoreTime(start_time_ms),
+                list_options.time_scale);
+            repositioned = false;
+        }
+        const double drag_ms = session_reporting.total_drag;
+        bool played = false;
+        pin_i = playSchedules(talkie_socket, talkie_timer, [&talkie_pins, &played]() -> TalkieSchedule* {
+            if (played) return nullptr;
+            played = true;
+            return &talkie_pins;
+        }, list_options, session_reporting, verbose && first_play, pin_i, start_time_ms);
+        first_play = false;
+
+        // Resuming keeps what was left to wait for the next pin, without the drag meanwhile
+        if (pin_i < talkie_pins.size()) {
+            const double reached_ms = start_time_ms + static_cast<double>(talkie_timer.now()) / 1000000
+                - (session_reporting.total_drag - drag_ms);
+            start_time_ms = std::min(std::max(reached_ms, start_time_ms), list_options.playTime(talkie_pins.getTime(pin_i)));
+        }
+        transport_lock.lock();
+    }
+    transport_lock.unlock();
+
+    reportPlay(session_reporting, verbose);
+    reportDevices(talkie_socket, verbose);
+    if (!play_options.report_path.empty())
+        writeReport(session_reporting, talkie_socket, play_options.report_path);
+
+    transport_lock.lock();
+    play_reporting = session_reporting;
+    stop_requested = false;
+    pause_requested = false;
+    seek_time_ms = NAN;
+    position_ms = 0.0;
+    transport_state = TransportState::stopped;
+    transport_condition.notify_all();
+}
@@ -0,0 +1,72 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieStatistics.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+
+
+void TalkieStatistics::add(double value_ms) {
+    if (total_values == 0) {
+        minimum_ms = maximum_ms = value_ms;
+    } else {
+        minimum_ms = std::min(minimum_ms, value_ms);
+        maximum_ms = std::max(maximum_ms, value_ms);
+    }
+    total_values++;
+    total_ms += value_ms;
+    const double difference_ms = value_ms - mean_ms;
+    mean_ms += difference_ms / total_values;
+    squares_ms += difference_ms * (value_ms - mean_ms);
+
+    size_t bucket_i = 0;
+    if (value_ms >= STATISTICS_MINIMUM_MS) {
+        const double octaves = std::log2(value_ms / STATISTICS_MINIMUM_MS);
+        bucket_i = std::min(static_cast<size_t>(octaves * STATISTICS_BUCKETS_PER_OCTAVE) + 1,
+            static_cast<size_t>(STATISTICS_BUCKETS - 1));
+    }
+    buckets[bucket_i]++;
+}
+
+
+double TalkieStatistics::getDeviation() const {
+    if (total_values == 0) {
+        return 0.0;
+    }
+    return std::sqrt(squares_ms / total_values);
+}
+
+
+double TalkieStatistics::bucketEdge(size_t bucket_i) {
+    return STATISTICS_MINIMUM_MS * std::exp2(static_cast<double>(bucket_i) / STATISTICS_BUCKETS_PER_OCTAVE);
+}
+
+
+double TalkieStatistics::getPercentile(double fraction) const {
+    if (total_values == 0) {
+        return 0.0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * total_values)));
+    uint64_t counted = 0;
+    for (size_t bucket_i = 0; bucket_i < buckets.size(); ++bucket_i) {
+        counted += buckets[bucket_i];
+        if (counted >= rank) {
+            return std::min(std::max(bucketEdge(bucket_i), minimum_ms), maximum_ms);
+        }
+    }
+    return maximum_ms;
+}
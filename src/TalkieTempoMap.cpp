@@ -0,0 +1,96 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "JsonTalkiePlayer.hpp"
+#include "TalkieTempoMap.hpp"
+
+#include <algorithm>
+
+
+
+void TalkieTempoMap::clear() {
+    starts_ms.clear();
+    starts_beat.clear();
+    beats_ms.clear();
+}
+
+
+void TalkieTempoMap::add(double time_ms, double bpm_10) {
+    if (!(bpm_10 > 0)) {
+        return;
+    }
+    const double beat_ms = 600000.0 / bpm_10;
+    if (!starts_ms.empty() && time_ms <= starts_ms.back()) {
+        // Same time, the last one wins
+        time_ms = starts_ms.back();
+        starts_ms.pop_back();
+        starts_beat.pop_back();
+        beats_ms.pop_back();
+    }
+    // The first tempo stands for the time before it too
+    const double start_beat = starts_ms.empty() ? time_ms / beat_ms
+        : starts_beat.back() + (time_ms - starts_ms.back()) / beats_ms.back();
+    starts_ms.push_back(time_ms);
+    starts_beat.push_back(start_beat);
+    beats_ms.push_back(beat_ms);
+}
+
+
+void TalkieTempoMap::build(const TalkieSchedule &tempo_pins) {
+    clear();
+    for (size_t pin_i = 0; pin_i < tempo_pins.size(); ++pin_i) {
+        try {
+            const nlohmann::json tempo = nlohmann::json::parse(tempo_pins.getMessage(pin_i),
+                tempo_pins.getMessage(pin_i) + tempo_pins.getLength(pin_i));
+            add(tempo_pins.getTime(pin_i), tempo.at("v").get<double>());
+        } catch (const nlohmann::json::exception&) {
+            continue;
+        }
+    }
+}
+
+
+size_t TalkieTempoMap::segmentAtMs(double time_ms) const {
+    // The last segment starting at or before time_ms, the first one for any earlier time
+    const size_t segment_end = std::upper_bound(starts_ms.begin(), starts_ms.end(), time_ms) - starts_ms.begin();
+    return segment_end > 0 ? segment_end - 1 : 0;
+}
+
+
+double TalkieTempoMap::beatToMs(double beat) const {
+    if (empty()) {
+        return beat * 600000.0 / TEMPO_DEFAULT_BPM_10;
+    }
+    const size_t segment_end = std::upper_bound(starts_beat.begin(), starts_beat.end(), beat) - starts_beat.begin();
+    const size_t segment_i = segment_end > 0 ? segment_end - 1 : 0;
+    return starts_ms[segment_i] + (beat - starts_beat[segment_i]) * beats_ms[segment_i];
+}
+
+
+double TalkieTempoMap::msToBeat(double time_ms) const {
+    if (empty()) {
+        return time_ms * TEMPO_DEFAULT_BPM_10 / 600000.0;
+    }
+    const size_t segment_i = segmentAtMs(time_ms);
+    return starts_beat[segment_i] + (time_ms - starts_ms[segment_i]) / beats_ms[segment_i];
+}
+
+
+double TalkieTempoMap::getBpm(double time_ms) const {
+    if (empty()) {
+        return TEMPO_DEFAULT_BPM_10 / 10.0;
+    }
+    return 60000.0 / beats_ms[segmentAtMs(time_ms)];
+}
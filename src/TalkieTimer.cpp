@@ -0,0 +1,237 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieTimer.hpp"
+#include "TalkieTracer.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+
+#ifndef _WIN32
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/timerfd.h>
+    #include <sys/eventfd.h>
+#endif
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+    #define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002   // Windows 10 1803 or later
+#endif
+
+
+
+TalkieTimer::TalkieTimer(TimerMode mode) : timer_mode(mode) {
+#ifdef _WIN32
+    QueryPerformanceFrequency(&frequency);
+    waitable_timer = CreateWaitableTimerExW(nullptr, nullptr,
+        CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (waitable_timer == nullptr) {
+        // Older Windows, the regular timer has the system tick resolution
+        waitable_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+    interrupt_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);   // Manual reset
+#else
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    interrupt_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+    start();
+}
+
+
+TalkieTimer::~TalkieTimer() {
+#ifdef _WIN32
+    if (waitable_timer != nullptr) CloseHandle(waitable_timer);
+    if (interrupt_event != nullptr) CloseHandle(interrupt_event);
+#else
+    if (timer_fd >= 0) close(timer_fd);
+    if (interrupt_fd >= 0) close(interrupt_fd);
+#endif
+}
+
+
+void TalkieTimer::interrupt() {
+    interrupted.store(true, std::memory_order_release);
+#ifdef _WIN32
+    if (interrupt_event != nullptr) SetEvent(interrupt_event);
+#else
+    if (interrupt_fd >= 0) {
+        const uint64_t one = 1;
+        ssize_t written = write(interrupt_fd, &one, sizeof(one));
+        (void)written;  // Only fails if the counter is already set
+    }
+#endif
+}
+
+
+void TalkieTimer::clearInterrupt() {
+    interrupted.store(false, std::memory_order_release);
+#ifdef _WIN32
+    if (interrupt_event != nullptr) ResetEvent(interrupt_event);
+#else
+    if (interrupt_fd >= 0) {
+        uint64_t count;
+        ssize_t taken = read(interrupt_fd, &count, sizeof(count));
+        (void)taken;    // Fails with EAGAIN when there was nothing to clear
+    }
+#endif
+}
+
+
+void TalkieTimer::start() {
+#ifdef _WIN32
+    QueryPerformanceCounter(&epoch);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &epoch);
+#endif
+}
+
+
+long long TalkieTimer::now() const {
+#ifdef _WIN32
+    LARGE_INTEGER current;
+    QueryPerformanceCounter(&current);
+    const long long ticks = current.QuadPart - epoch.QuadPart;
+    // Split to avoid overflowing the multiplication on long runs
+    return (ticks / frequency.QuadPart) * 1000000000LL
+        + (ticks % frequency.QuadPart) * 1000000000LL / frequency.QuadPart;
+#else
+    struct timespec current;
+    clock_gettime(CLOCK_MONOTONIC, &current);
+    return (current.tv_sec - epoch.tv_sec) * 1000000000LL + (current.tv_nsec - epoch.tv_nsec);
+#endif
+}
+
+
+bool TalkieTimer::spinUntil(long long deadline_ns) const {
+    while (now() < deadline_ns) {
+        if (isInterrupted())
+            return false;
+    }
+    return true;
+}
+
+
+bool TalkieTimer::sleepUntil(long long deadline_ns) {
+    if (isInterrupted()) {
+        return false;
+    }
+#ifdef _WIN32
+    const long long remaining_ns = deadline_ns - now();
+    if (remaining_ns <= 0) {
+        return true;
+    }
+    if (waitable_timer != nullptr && interrupt_event != nullptr) {
+        LARGE_INTEGER due_time;
+        due_time.QuadPart = -(remaining_ns / 100);  // Relative, in 100 ns units
+        if (SetWaitableTimerEx(waitable_timer, &due_time, 0, nullptr, nullptr, nullptr, 0)) {
+            HANDLE handles[2] = {waitable_timer, interrupt_event};
+            return WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0;
+        }
+    }
+    if (interrupt_event != nullptr) {
+        return WaitForSingleObject(interrupt_event, static_cast<DWORD>(remaining_ns / 1000000)) == WAIT_TIMEOUT;
+    }
+    Sleep(static_cast<DWORD>(remaining_ns / 1000000));
+    return true;
+#else
+    // Absolute deadline, immune to the time lost between computing and sleeping
+    struct timespec deadline = epoch;
+    deadline.tv_sec += deadline_ns / 1000000000LL;
+    deadline.tv_nsec += deadline_ns % 1000000000LL;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    if (timer_fd >= 0 && interrupt_fd >= 0) {
+        // Arming resets the expirations, so the timer never has to be read
+        struct itimerspec timer_value = {};
+        timer_value.it_value = deadline;
+        if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer_value, nullptr) == 0) {
+            struct pollfd handles[2] = {{timer_fd, POLLIN, 0}, {interrupt_fd, POLLIN, 0}};
+            while (true) {
+                if (poll(handles, 2, -1) > 0) {
+                    return (handles[1].revents & POLLIN) == 0;
+                } else if (errno != EINTR) {
+                    break;
+                }
+            }
+        }
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) { }
+    return !isInterrupted();
+#endif
+}
+
+
+bool TalkieTimer::waitUntil(long long deadline_ns) {
+    switch (timer_mode) {
+        case TimerMode::spin:
+            return spinUntil(deadline_ns);
+        case TimerMode::hybrid:
+            if (deadline_ns - now() > spin_tail_ns && !sleepUntil(deadline_ns - spin_tail_ns))
+                return false;
+            return spinUntil(deadline_ns);
+        case TimerMode::sleep:
+            return sleepUntil(deadline_ns);
+    }
+    return true;
+}
+
+
+long long TalkieTimer::calibrate() {
+    TalkieTraceScope trace_scope("calibrate");
+    std::vector<long long> latencies_ns;
+    latencies_ns.reserve(TIMER_CALIBRATION_RUNS);
+
+    for (int run = 0; run < TIMER_CALIBRATION_RUNS; ++run) {
+        const long long deadline_ns = now() + 1000000LL;    // 1 ms ahead
+        sleepUntil(deadline_ns);
+        latencies_ns.push_back(std::max(0LL, now() - deadline_ns));
+    }
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+
+    // The worst but one wake up plus a margin, the spin absorbs the rest
+    const long long latency_ns = latencies_ns[latencies_ns.size() - 2];
+    spin_tail_ns = std::min(std::max(latency_ns + latency_ns / 4 + TIMER_MINIMUM_TAIL_NS / 2,
+        TIMER_MINIMUM_TAIL_NS), TIMER_MAXIMUM_TAIL_NS);
+    return spin_tail_ns;
+}
+
+
+
+
+bool parseTimerMode(const std::string &mode_name, TimerMode &timer_mode) {
+    if (mode_name == "spin") {
+        timer_mode = TimerMode::spin;
+    } else if (mode_name == "hybrid") {
+        timer_mode = TimerMode::hybrid;
+    } else if (mode_name == "sleep") {
+        timer_mode = TimerMode::sleep;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+const char* timerModeName(TimerMode timer_mode) {
+    switch (timer_mode) {
+        case TimerMode::spin:   return "spin";
+        case TimerMode::hybrid: return "hybrid";
+        case TimerMode::sleep:  return "sleep";
+    }
+    return "unknown";
+}
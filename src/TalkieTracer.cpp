@@ -0,0 +1,107 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieTracer.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+
+
+
+TalkieTracer& TalkieTracer::instance() {
+    static TalkieTracer talkie_tracer;
+    return talkie_tracer;
+}
+
+
+void TalkieTracer::enable(size_t capacity) {
+    if (isEnabled()) {
+        return;
+    }
+    events.assign(std::max<size_t>(capacity, 1), Event());
+    total_events.store(0, std::memory_order_relaxed);
+    epoch_ns = now();
+    enabled.store(true, std::memory_order_release);
+}
+
+
+long long TalkieTracer::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void TalkieTracer::record(const Event &event) {
+    static std::atomic<uint32_t> total_threads{0};
+    thread_local const uint32_t thread_id = ++total_threads;   // Small and stable ids for the viewer
+
+    const uint64_t event_i = total_events.fetch_add(1, std::memory_order_relaxed);
+    Event &slot = events[event_i % events.size()];
+    slot = event;
+    slot.thread_id = thread_id;
+}
+
+
+void TalkieTracer::complete(const char* name, long long start_ns, long long finish_ns,
+        const char* arg_name, double arg_value) {
+    if (isEnabled())
+        record({name, arg_name, arg_value, start_ns, finish_ns - start_ns, 0});
+}
+
+
+void TalkieTracer::instant(const char* name, const char* arg_name, double arg_value) {
+    if (isEnabled())
+        record({name, arg_name, arg_value, now(), -1, 0});
+}
+
+
+bool TalkieTracer::write(const std::string &trace_path) const {
+    std::ofstream trace_file(trace_path);
+    if (!trace_file) {
+        std::cerr << "Unable to write the trace: " << trace_path << std::endl;
+        return false;
+    }
+
+    const uint64_t recorded_events = totalEvents();
+    const uint64_t first_event = recorded_events > events.size() ? recorded_events - events.size() : 0;
+    nlohmann::json trace_events = nlohmann::json::array();
+    for (uint64_t event_i = first_event; event_i < recorded_events; ++event_i) {
+        const Event &event = events[event_i % events.size()];
+        nlohmann::json trace_event = {
+            {"name", event.name},
+            {"pid", 1},
+            {"tid", event.thread_id},
+            {"ts", static_cast<double>(event.start_ns - epoch_ns) / 1000}     // Microseconds
+        };
+        if (event.duration_ns < 0) {
+            trace_event["ph"] = "i";
+            trace_event["s"] = "t";
+        } else {
+            trace_event["ph"] = "X";
+            trace_event["dur"] = static_cast<double>(event.duration_ns) / 1000;
+        }
+        if (event.arg_name != nullptr)
+            trace_event["args"] = {{event.arg_name, event.arg_value}};
+        trace_events.push_back(trace_event);
+    }
+
+    trace_file << nlohmann::json{{"traceEvents", trace_events}, {"displayTimeUnit", "ms"},
+        {"otherData", {{"overwritten_events", first_event}}}}.dump() << std::endl;
+    return true;
+}
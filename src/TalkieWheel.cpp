@@ -0,0 +1,344 @@
+/*
+JsonTalkiePlayer - Json Talkie Player is intended to be used
+in conjugation with the Json Midi Creator to Play its composed Elements
+Original Copyright (c) 2025 Rui Seixas Monteiro. All right reserved.
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+https://github.com/ruiseixasm/JsonMidiCreator
+https://github.com/ruiseixasm/JsonTalkiePlayer
+*/
+#include "TalkieWheel.hpp"
+#include "TalkieTracer.hpp"
+
+#include <algorithm>
+#include <limits>
+
+
+#define WHEEL_SLOT_MASK     (WHEEL_SLOTS - 1)
+
+
+int64_t TalkieWheel::tickOf(double time_ms) {
+    // Far enough from the limits for the tick arithmetic to never overflow
+    const double tick = std::floor(time_ms / WHEEL_TICK_MS);
+    const double bound = static_cast<double>(int64_t(1) << 62);
+    return static_cast<int64_t>(std::max(-bound, std::min(bound, tick)));
+}
+
+
+void TalkieWheel::add(double time_ms, uint32_t device_id, const char* message, size_t length) {
+    uint32_t slot_i;
+    if (!free_slots.empty()) {
+        slot_i = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot_i = static_cast<uint32_t>(slots.size());
+        slots.emplace_back();
+    }
+    Slot &slot = slots[slot_i];
+    slot.time_ms = time_ms;
+    slot.sequence = next_sequence++;
+    slot.device_id = device_id;
+    slot.length = static_cast<uint32_t>(length);
+    if (length > SEND_MESSAGE_BYTES) {
+        slot.long_message.assign(message, length);
+    } else {
+        std::memcpy(slot.message, message, length);
+    }
+    total_pins++;
+    maximum_pins = std::max(maximum_pins, total_pins);
+    place(slot_i);
+}
+
+
+void TalkieWheel::place(uint32_t slot_i) {
+    const int64_t tick = tickOf(slots[slot_i].time_ms);
+    if (tick < cursor_tick) {
+        late.push_back(slot_i);
+        total_late++;
+        return;
+    }
+    // The lowest level whose span still reaches the tick from the cursor
+    for (int level = 0; level < WHEEL_LEVELS; ++level) {
+        const int shift = WHEEL_SLOT_BITS * level;
+        if ((tick >> shift) - (cursor_tick >> shift) < WHEEL_SLOTS) {
+            levels[level][(tick >> shift) & WHEEL_SLOT_MASK].push_back(slot_i);
+            level_pins[level]++;
+            return;
+        }
+    }
+    overflow.push_back(slot_i);
+}
+
+
+void TalkieWheel::cascade() {
+    // Highest level first, its pins may land on the lower slots reached at the same tick
+    for (int level = WHEEL_LEVELS; level > 0; --level) {
+        const int shift = WHEEL_SLOT_BITS * level;
+        if ((cursor_tick & ((int64_t(1) << shift) - 1)) != 0) {
+            continue;
+        }
+        if (level == WHEEL_LEVELS) {
+            cascading.swap(overflow);
+        } else {
+            cascading.swap(levels[level][(cursor_tick >> shift) & WHEEL_SLOT_MASK]);
+            level_pins[level] -= cascading.size();
+        }
+        for (uint32_t slot_i : cascading)
+            place(slot_i);
+        cascading.clear();
+    }
+}
+
+
+void TalkieWheel::append(std::vector<uint32_t> &slot_indexes, TalkieSchedule &batch) {
+    std::sort(slot_indexes.begin(), slot_indexes.end(), [this](uint32_t slot_a, uint32_t slot_b) {
+        const Slot &a = slots[slot_a];
+        const Slot &b = slots[slot_b];
+        return a.time_ms < b.time_ms || (a.time_ms == b.time_ms && a.sequence < b.sequence);
+    });
+    for (uint32_t slot_i : slot_indexes) {
+        Slot &slot = slots[slot_i];
+        batch.add(slot.time_ms, slot.device_id, slot.data(), slot.length);
+        slot.long_message.clear();
+        free_slots.push_back(slot_i);
+    }
+    total_pins -= slot_indexes.size();
+    slot_indexes.clear();
+}
+
+
+bool TalkieWheel::take(double limit_ms, TalkieSchedule &batch) {
+    // Ticks from this one on may still get pins
+    const int64_t limit_tick = limit_ms == std::numeric_limits<double>::infinity()
+        ? std::numeric_limits<int64_t>::max() : tickOf(limit_ms);
+    while (total_pins > 0) {
+        if (!late.empty()) {
+            append(late, batch);
+            return true;
+        }
+        if (cursor_tick >= limit_tick) {
+            return false;
+        }
+        std::vector<uint32_t> &tick_pins = levels[0][cursor_tick & WHEEL_SLOT_MASK];
+        if (!tick_pins.empty()) {
+            level_pins[0] -= tick_pins.size();
+            append(tick_pins, batch);
+            cursor_tick++;
+            cascade();
+            return true;
+        }
+        // Empty levels are skipped up to the next slot of the first one with pins
+        int empty_levels = 0;
+        while (empty_levels < WHEEL_LEVELS && level_pins[empty_levels] == 0)
+            empty_levels++;
+        const int shift = WHEEL_SLOT_BITS * empty_levels;
+        const int64_t next_tick = ((cursor_tick >> shift) + 1) << shift;
+        cursor_tick = std::min(next_tick, limit_tick);
+        cascade();
+    }
+    return false;
+}
+
+
+
+TalkieWheelStream::TalkieWheelStream(TalkieSocket &talkie_socket, double ahead_ms, double coalesce_ms,
+        PlayReporting &play_reporting, bool verbose)
+            : talkie_socket(talkie_socket), play_reporting(play_reporting), verbose(verbose),
+              ahead_ms(ahead_ms), coalesce_ms(coalesce_ms) {
+    feeding_pins.reserve(WHEEL_FEED_PINS);
+}
+
+
+TalkieWheelStream::~TalkieWheelStream() {
+    join();
+}
+
+
+void TalkieWheelStream::start(std::function<bool(TalkieLoader&)> load) {
+    run([this, load]() {
+        TalkieLoader talkie_loader(talkie_socket, feeding_pins, feeding_tempos, play_reporting, verbose);
+        // Fed only between different times, so same time pins are coalesced together
+        bool joined = false;
+        talkie_loader.setBeforePin([this, &joined](double time_ms) {
+            if (feeding_pins.size() >= WHEEL_FEED_PINS && feeding_pins.getTime(feeding_pins.size() - 1) != time_ms)
+                joined = !feed();
+            return !joined;     // The rest of the content isn't even parsed
+        });
+        return load(talkie_loader) || joined;
+    });
+}
+
+
+bool TalkieWheelStream::start(const CompiledPlayList &compiled) {
+    std::vector<uint32_t> device_ids;
+    if (!loadCompiledDevices(compiled, talkie_socket, device_ids, verbose)) {
+        return false;
+    }
+    run([this, &compiled, device_ids]() {
+        const CompiledHeader* compiled_header = compiled.header();
+        const CompiledPin* compiled_pins = compiled.pins();
+        const char* payload = compiled.payload();
+        uint32_t released_i = 0;
+        uint64_t released_offset = 0;
+        for (uint32_t pin_i = 0; pin_i < compiled_header->pin_count; ++pin_i) {
+            const CompiledPin &compiled_pin = compiled_pins[pin_i];
+            uint32_t device_id;
+            if (!compiledPinDevice(compiled, compiled_pin, device_ids, device_id, verbose)) {
+                return false;
+            }
+            if (feeding_pins.size() >= WHEEL_FEED_PINS && feeding_pins.getTime(feeding_pins.size() - 1) != compiled_pin.time_ms) {
+                if (!feed()) {
+                    return true;
+                }
+                // Pins and their messages are laid out in time order, the ones fed are never read again
+                if (pin_i - released_i >= WHEEL_RELEASE_PINS) {
+                    compiled.releasePages(reinterpret_cast<const char*>(compiled_pins + released_i),
+                        reinterpret_cast<const char*>(compiled_pins + pin_i));
+                    compiled.releasePages(payload + released_offset, payload + compiled_pin.offset);
+                    released_i = pin_i;
+                    released_offset = compiled_pin.offset;
+                }
+            }
+            if (feeding_pins.empty()) {
+                feeding_pins.attachArena(payload, compiled_header->payload_size);
+            }
+            feeding_pins.addOffset(compiled_pin.time_ms, device_id, compiled_pin.offset, compiled_pin.length);
+        }
+        return true;
+    });
+    return true;
+}
+
+
+void TalkieWheelStream::run(std::function<bool()> load) {
+    loader_thread = std::thread([this, load]() {
+        // Never competes with the real time thread that created it
+        setBackgroundScheduling();
+        auto loading_start = std::chrono::high_resolution_clock::now();
+        bool load_ok;
+        {
+            TalkieTraceScope trace_scope("load");
+            load_ok = load();
+            feed();
+        }
+        auto loading_finish = std::chrono::high_resolution_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(wheel_mutex);
+            loading_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(loading_finish - loading_start).count();
+            loaded = load_ok;
+            finished = true;
+        }
+        wheel_condition.notify_all();
+    });
+}
+
+
+bool TalkieWheelStream::feed() {
+    if (feeding_pins.empty()) {
+        feeding_tempos.clear();
+        std::lock_guard<std::mutex> lock(wheel_mutex);
+        return !stopping;
+    }
+    const long long trace_start_ns = TalkieTracer::instance().isEnabled() ? TalkieTracer::now() : 0;
+    if (coalesce_ms > 0) {
+        feeding_pins.sort();
+        play_reporting.total_coalesced += feeding_pins.coalesce(coalesce_ms, talkie_socket.getRegistry());
+    }
+    double earliest_ms = feeding_pins.getTime(0);
+    double latest_ms = feeding_pins.getTime(0);
+    for (size_t pin_i = 1; pin_i < feeding_pins.size(); ++pin_i) {
+        earliest_ms = std::min(earliest_ms, feeding_pins.getTime(pin_i));
+        latest_ms = std::max(latest_ms, feeding_pins.getTime(pin_i));
+    }
+    const size_t fed_pins = feeding_pins.size();
+
+    std::unique_lock<std::mutex> lock(wheel_mutex);
+    if (!stopping) {
+        for (size_t pin_i = 0; pin_i < feeding_pins.size(); ++pin_i)
+            talkie_wheel.add(feeding_pins.getTime(pin_i), feeding_pins.getDeviceId(pin_i),
+                feeding_pins.getMessage(pin_i), feeding_pins.getLength(pin_i));
+        if (!any_fed) {
+            first_ms = earliest_ms;
+            loaded_ms = latest_ms;
+            any_fed = true;
+        }
+        loaded_ms = std::max(loaded_ms, latest_ms);
+    }
+    TalkieTracer::instance().complete("feed wheel", trace_start_ns, TalkieTracer::now(),
+        "pins", static_cast<double>(fed_pins));
+    lock.unlock();
+    wheel_condition.notify_all();
+    feeding_pins.clear();
+    feeding_tempos.clear();
+
+    // Until the play gets close enough, a play list that starts late is waited for from its first pin.
+    // From the end of the cursor tick, as the play waits there for the pins that end it, whatever the window
+    lock.lock();
+    wheel_condition.wait(lock, [this]() {
+        return stopping || loaded_ms <= std::max(talkie_wheel.cursorMs() + WHEEL_TICK_MS, first_ms) + ahead_ms;
+    });
+    return !stopping;
+}
+
+
+bool TalkieWheelStream::waitAhead() {
+    std::unique_lock<std::mutex> lock(wheel_mutex);
+    wheel_condition.wait(lock, [this]() {
+        return finished || (any_fed && loaded_ms - first_ms >= ahead_ms);
+    });
+    return talkie_wheel.size() > 0;
+}
+
+
+TalkieSchedule* TalkieWheelStream::nextSchedule() {
+    std::unique_lock<std::mutex> lock(wheel_mutex);
+    playing_batch.clear();
+    bool underrun = false;
+    // A tick is only complete once the loader fed past it (or finished)
+    while (!talkie_wheel.take(finished ? std::numeric_limits<double>::infinity() : loaded_ms, playing_batch)) {
+        if (finished) {
+            return nullptr;
+        }
+        if (!underrun) {
+            total_underruns++;
+            TalkieTracer::instance().instant("underrun");
+            underrun = true;
+        }
+        wheel_condition.notify_all();   // The cursor may have moved on, freeing the loader
+        wheel_condition.wait(lock);
+    }
+    lock.unlock();
+    wheel_condition.notify_all();
+    return &playing_batch;
+}
+
+
+bool TalkieWheelStream::join() {
+    {
+        std::lock_guard<std::mutex> lock(wheel_mutex);
+        stopping = true;
+    }
+    wheel_condition.notify_all();
+    if (loader_thread.joinable()) {
+        loader_thread.join();
+    }
+    return loaded;
+}
+
+
+size_t TalkieWheelStream::totalLate() {
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+    return talkie_wheel.totalLate();
+}
+
+
+size_t TalkieWheelStream::maximumPins() {
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+    return talkie_wheel.maximumPins();
+}